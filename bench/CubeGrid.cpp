@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CubeGrid.h"
+#include <cstdint>
+#include <initializer_list>
+#include <fstream>
+
+namespace triangle {
+
+static void appendUint32(std::string &out, uint32_t value) {
+  out.append(reinterpret_cast<const char *>(&value), 4);
+}
+
+template <typename T>
+static void appendValues(std::string &out, std::initializer_list<T> values) {
+  for (auto value : values) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+}
+
+std::string writeCubeGrid(int gridSize, const std::string &path,
+                          bool sharedMesh) {
+  std::string positions, texCoords, indices;
+  const float corners[6][4][3] = {
+      {{-1, -1, 1}, {1, -1, 1}, {1, 1, 1}, {-1, 1, 1}},
+      {{1, -1, -1}, {-1, -1, -1}, {-1, 1, -1}, {1, 1, -1}},
+      {{1, -1, 1}, {1, -1, -1}, {1, 1, -1}, {1, 1, 1}},
+      {{-1, -1, -1}, {-1, -1, 1}, {-1, 1, 1}, {-1, 1, -1}},
+      {{-1, 1, 1}, {1, 1, 1}, {1, 1, -1}, {-1, 1, -1}},
+      {{-1, -1, -1}, {1, -1, -1}, {1, -1, 1}, {-1, -1, 1}}};
+  for (auto face = 0; face < 6; ++face) {
+    for (auto corner = 0; corner < 4; ++corner) {
+      appendValues<float>(positions, {corners[face][corner][0] * 0.5f,
+                                      corners[face][corner][1] * 0.5f,
+                                      corners[face][corner][2] * 0.5f});
+      appendValues<float>(texCoords,
+                          {float(corner == 1 || corner == 2),
+                           float(corner >= 2)});
+    }
+    uint16_t base = face * 4;
+    appendValues<uint16_t>(indices, {base, uint16_t(base + 1),
+                                     uint16_t(base + 2), base,
+                                     uint16_t(base + 2), uint16_t(base + 3)});
+  }
+  auto bin = positions + texCoords + indices;
+  bin.resize((bin.size() + 3) & ~size_t(3), '\0');
+  std::string nodes, sceneNodes, meshes;
+  auto spacing = 4.0f / gridSize, scale = spacing * 0.5f;
+  auto index = 0;
+  for (auto x = 0; x < gridSize; ++x) {
+    for (auto y = 0; y < gridSize; ++y) {
+      for (auto z = 0; z < gridSize; ++z, ++index) {
+        auto separator = index == 0 ? "" : ",";
+        nodes += separator + std::string("{\"mesh\":") +
+                 std::to_string(sharedMesh ? 0 : index) +
+                 ",\"translation\":[" +
+                 std::to_string((x + 0.5f) * spacing - 2.0f) + "," +
+                 std::to_string((y + 0.5f) * spacing - 2.0f) + "," +
+                 std::to_string((z + 0.5f) * spacing - 2.0f) +
+                 "],\"scale\":[" + std::to_string(scale) + "," +
+                 std::to_string(scale) + "," + std::to_string(scale) + "]}";
+        sceneNodes += separator + std::to_string(index);
+        if (index == 0 || !sharedMesh) {
+          meshes += separator +
+                    std::string("{\"primitives\":[{\"attributes\":{"
+                                "\"POSITION\":0,\"TEXCOORD_0\":1},"
+                                "\"indices\":2,\"material\":0}]}");
+        }
+      }
+    }
+  }
+  auto json =
+      "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" +
+      sceneNodes + "]}],\"nodes\":[" + nodes +
+      "],\"meshes\":[" + meshes +
+      "],\"materials\":[{}],\"buffers\":[{\"byteLength\":" +
+      std::to_string(bin.size()) +
+      "}],\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" +
+      std::to_string(positions.size()) +
+      "},{\"buffer\":0,\"byteOffset\":" + std::to_string(positions.size()) +
+      ",\"byteLength\":" + std::to_string(texCoords.size()) +
+      "},{\"buffer\":0,\"byteOffset\":" +
+      std::to_string(positions.size() + texCoords.size()) +
+      ",\"byteLength\":" + std::to_string(indices.size()) +
+      "}],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,"
+      "\"count\":24,\"type\":\"VEC3\",\"min\":[-0.5,-0.5,-0.5],"
+      "\"max\":[0.5,0.5,0.5]},{\"bufferView\":1,\"componentType\":5126,"
+      "\"count\":24,\"type\":\"VEC2\"},{\"bufferView\":2,"
+      "\"componentType\":5123,\"count\":36,\"type\":\"SCALAR\"}]}";
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+  std::string glb;
+  appendUint32(glb, 0x46546C67);
+  appendUint32(glb, 2);
+  appendUint32(glb, 12 + 8 + json.size() + 8 + bin.size());
+  appendUint32(glb, json.size());
+  appendUint32(glb, 0x4E4F534A);
+  glb += json;
+  appendUint32(glb, bin.size());
+  appendUint32(glb, 0x004E4942);
+  glb += bin;
+  std::ofstream(path, std::ios::binary).write(glb.data(), glb.size());
+  return path;
+}
+
+} // namespace triangle
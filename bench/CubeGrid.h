@@ -0,0 +1,30 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace triangle {
+
+// Writes a .glb with gridSize^3 nodes of a unit cube (24 vertices so each
+// face has its own UVs), filling [-2, 2]^3. The nodes share one mesh, or
+// with sharedMesh false each gets its own mesh over the same accessors so
+// that every cube is a separate draw. Returns path.
+std::string writeCubeGrid(int gridSize, const std::string &path,
+                          bool sharedMesh = true);
+
+} // namespace triangle
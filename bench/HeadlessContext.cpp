@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HeadlessContext.h"
+#include <EGL/eglext.h>
+#include <cstring>
+#include <iostream>
+
+namespace triangle {
+
+static bool hasExtension(const char *extensions, const char *name) {
+  return extensions != nullptr && strstr(extensions, name) != nullptr;
+}
+
+HeadlessContext::HeadlessContext(unsigned int width, unsigned int height) {
+  if (!initDisplay() || !initContext()) {
+    std::cout << "EGL error = " << std::hex << eglGetError() << std::dec
+              << std::endl;
+    return;
+  }
+  initFramebuffer(width, height);
+}
+
+HeadlessContext::~HeadlessContext() {
+  if (valid_) {
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteRenderbuffers(1, &colorRenderbuffer_);
+    glDeleteRenderbuffers(1, &depthRenderbuffer_);
+  }
+  if (display_ != EGL_NO_DISPLAY) {
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface_ != EGL_NO_SURFACE) {
+      eglDestroySurface(display_, surface_);
+    }
+    if (context_ != EGL_NO_CONTEXT) {
+      eglDestroyContext(display_, context_);
+    }
+    eglTerminate(display_);
+  }
+}
+
+bool HeadlessContext::isValid() { return valid_; }
+
+void HeadlessContext::bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+}
+
+bool HeadlessContext::initDisplay() {
+  auto clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (getPlatformDisplay != nullptr &&
+      hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+    display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                  EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display_ == EGL_NO_DISPLAY ||
+      !eglInitialize(display_, nullptr, nullptr)) {
+    display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    return display_ != EGL_NO_DISPLAY &&
+           eglInitialize(display_, nullptr, nullptr);
+  }
+  return true;
+}
+
+bool HeadlessContext::initContext() {
+  auto surfaceless = hasExtension(eglQueryString(display_, EGL_EXTENSIONS),
+                                  "EGL_KHR_surfaceless_context");
+  const EGLint configAttributes[] = {
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+      EGL_SURFACE_TYPE,    surfaceless ? EGL_DONT_CARE : EGL_PBUFFER_BIT,
+      EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglBindAPI(EGL_OPENGL_ES_API) ||
+      !eglChooseConfig(display_, configAttributes, &config, 1,
+                       &configCount) ||
+      configCount == 0) {
+    return false;
+  }
+  const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+  context_ =
+      eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttributes);
+  if (context_ == EGL_NO_CONTEXT) {
+    return false;
+  }
+  if (!surfaceless) {
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surfaceAttributes);
+    if (surface_ == EGL_NO_SURFACE) {
+      return false;
+    }
+  }
+  return eglMakeCurrent(display_, surface_, surface_, context_);
+}
+
+void HeadlessContext::initFramebuffer(unsigned int width,
+                                      unsigned int height) {
+  glGenRenderbuffers(1, &colorRenderbuffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenRenderbuffers(1, &depthRenderbuffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, colorRenderbuffer_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depthRenderbuffer_);
+  valid_ = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+} // namespace triangle
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+
+namespace triangle {
+
+// Offscreen GLES3 context for desktop Linux. Prefers Mesa's surfaceless
+// platform and falls back to the default display with a pbuffer, frames are
+// rendered into an FBO of the requested size.
+class HeadlessContext {
+
+public:
+  HeadlessContext(unsigned int width, unsigned int height);
+  ~HeadlessContext();
+  bool isValid();
+  void bind();
+
+private:
+  bool initDisplay();
+  bool initContext();
+  void initFramebuffer(unsigned int width, unsigned int height);
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLContext context_ = EGL_NO_CONTEXT;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+  GLuint framebuffer_ = 0;
+  GLuint colorRenderbuffer_ = 0;
+  GLuint depthRenderbuffer_ = 0;
+  bool valid_ = false;
+};
+
+} // namespace triangle
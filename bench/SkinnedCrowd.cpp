@@ -0,0 +1,181 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SkinnedCrowd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+template <typename T> static void appendValue(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static std::string bufferView(size_t offset, size_t length) {
+  return "{\"buffer\":0,\"byteOffset\":" + std::to_string(offset) +
+         ",\"byteLength\":" + std::to_string(length) + "}";
+}
+
+static std::string accessor(int bufferView, int componentType, int count,
+                            const char *type,
+                            const std::string &bounds = "") {
+  return "{\"bufferView\":" + std::to_string(bufferView) +
+         ",\"componentType\":" + std::to_string(componentType) +
+         ",\"count\":" + std::to_string(count) + ",\"type\":\"" + type +
+         "\"" + bounds + "}";
+}
+
+std::string writeSkinnedCrowd(int characters, int joints,
+                              const std::string &path,
+                              const std::string &interpolation) {
+  const auto sides = 8, ringsPerJoint = 4;
+  const auto segment = 0.5f, radius = 0.15f, angle = 0.3f;
+  const auto rings = joints * ringsPerJoint + 1;
+  std::string positions, jointIndices, weights, indices;
+  for (auto ring = 0; ring < rings; ++ring) {
+    const auto y = ring * segment / ringsPerJoint;
+    const auto joint = std::min(ring / ringsPerJoint, joints - 1);
+    const auto next = std::min(joint + 1, joints - 1);
+    const auto t = next == joint ? 0.0f
+                                 : float(ring % ringsPerJoint) / ringsPerJoint;
+    for (auto side = 0; side < sides; ++side) {
+      const auto phi = 2.0f * float(M_PI) * side / sides;
+      appendValue(positions, glm::vec3(radius * std::cos(phi), y,
+                                       radius * std::sin(phi)));
+      for (auto index : {joint, next, 0, 0}) {
+        appendValue(jointIndices, uint16_t(index));
+      }
+      appendValue(weights, glm::vec4(1.0f - t, t, 0.0f, 0.0f));
+    }
+  }
+  auto indexCount = 0;
+  for (auto ring = 0; ring + 1 < rings; ++ring) {
+    for (auto side = 0; side < sides; ++side) {
+      const uint32_t a = ring * sides + side,
+                     b = ring * sides + (side + 1) % sides;
+      for (auto index : {a, a + sides, b, b, a + sides, b + sides}) {
+        appendValue(indices, index);
+      }
+      indexCount += 6;
+    }
+  }
+  std::string inverseBindMatrices;
+  for (auto joint = 0; joint < joints; ++joint) {
+    glm::mat4 matrix(1.0f);
+    matrix[3].y = -joint * segment;
+    appendValue(inverseBindMatrices, matrix);
+  }
+  const auto cubic = interpolation == "CUBICSPLINE";
+  const float angles[] = {0.0f, angle, 0.0f, -angle, 0.0f};
+  std::string times, rotations;
+  for (auto key = 0; key < 5; ++key) {
+    appendValue(times, key * 0.5f);
+    const glm::vec4 rotation(0.0f, 0.0f, std::sin(angles[key] * 0.5f),
+                             std::cos(angles[key] * 0.5f));
+    if (cubic) {
+      appendValue(rotations, glm::vec4(0.0f));
+    }
+    appendValue(rotations, rotation);
+    if (cubic) {
+      appendValue(rotations, glm::vec4(0.0f));
+    }
+  }
+  const std::string *parts[] = {&positions, &jointIndices,
+                                &weights,   &indices,
+                                &inverseBindMatrices, &times,
+                                &rotations};
+  std::string bin, bufferViews;
+  for (auto part : parts) {
+    bufferViews += (bin.empty() ? "" : ",") + bufferView(bin.size(),
+                                                         part->size());
+    bin += *part;
+  }
+  const auto vertexCount = rings * sides;
+  const auto columns = int(std::ceil(std::sqrt(float(characters))));
+  std::string nodes, sceneNodes, skins, animations;
+  for (auto c = 0; c < characters; ++c) {
+    const auto separator = c == 0 ? "" : ",";
+    const auto base = c * (joints + 2);
+    const auto x = (c % columns - (columns - 1) * 0.5f) * 1.5f;
+    const auto z = (c / columns - (columns - 1) * 0.5f) * 1.5f;
+    nodes += separator + std::string("{\"translation\":[") +
+             std::to_string(x) + ",0," + std::to_string(z) +
+             "],\"children\":[" + std::to_string(base + 1) + "," +
+             std::to_string(base + 2) + "]},{\"mesh\":0,\"skin\":" +
+             std::to_string(c) + "}";
+    std::string skinJoints, channels;
+    for (auto joint = 0; joint < joints; ++joint) {
+      const auto node = std::to_string(base + 2 + joint);
+      nodes += ",{\"translation\":[0," +
+               std::to_string(joint == 0 ? 0.0f : segment) + ",0]" +
+               (joint + 1 < joints ? ",\"children\":[" +
+                                         std::to_string(base + 3 + joint) +
+                                         "]"
+                                   : "") +
+               "}";
+      skinJoints += (joint == 0 ? "" : ",") + node;
+      channels += (joint == 0 ? "" : ",") +
+                  std::string("{\"sampler\":0,\"target\":{\"node\":") + node +
+                  ",\"path\":\"rotation\"}}";
+    }
+    sceneNodes += separator + std::to_string(base);
+    skins += separator + std::string("{\"inverseBindMatrices\":4,") +
+             "\"joints\":[" + skinJoints + "]}";
+    animations += separator +
+                  std::string("{\"samplers\":[{\"input\":5,\"output\":6,") +
+                  "\"interpolation\":\"" + interpolation +
+                  "\"}],\"channels\":[" + channels + "]}";
+  }
+  const auto positionBounds =
+      ",\"min\":[" + std::to_string(-radius) + ",0," +
+      std::to_string(-radius) + "],\"max\":[" + std::to_string(radius) + "," +
+      std::to_string(joints * segment) + "," + std::to_string(radius) + "]";
+  auto json =
+      "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[" +
+      sceneNodes + "]}],\"nodes\":[" + nodes +
+      "],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,"
+      "\"JOINTS_0\":1,\"WEIGHTS_0\":2},\"indices\":3,\"material\":0}]}],"
+      "\"materials\":[{}],\"skins\":[" +
+      skins + "],\"animations\":[" + animations +
+      "],\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) +
+      "}],\"bufferViews\":[" + bufferViews + "],\"accessors\":[" +
+      accessor(0, 5126, vertexCount, "VEC3", positionBounds) + "," +
+      accessor(1, 5123, vertexCount, "VEC4") + "," +
+      accessor(2, 5126, vertexCount, "VEC4") + "," +
+      accessor(3, 5125, indexCount, "SCALAR") + "," +
+      accessor(4, 5126, joints, "MAT4") + "," +
+      accessor(5, 5126, 5, "SCALAR", ",\"min\":[0],\"max\":[2]") + "," +
+      accessor(6, 5126, cubic ? 15 : 5, "VEC4") + "]}";
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+  std::string glb;
+  appendValue<uint32_t>(glb, 0x46546C67);
+  appendValue<uint32_t>(glb, 2);
+  appendValue<uint32_t>(glb, 12 + 8 + json.size() + 8 + bin.size());
+  appendValue<uint32_t>(glb, json.size());
+  appendValue<uint32_t>(glb, 0x4E4F534A);
+  glb += json;
+  appendValue<uint32_t>(glb, bin.size());
+  appendValue<uint32_t>(glb, 0x004E4942);
+  glb += bin;
+  std::ofstream(path, std::ios::binary).write(glb.data(), glb.size());
+  return path;
+}
+
+} // namespace triangle
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace triangle {
+
+// Writes a .glb with characters tubes on the XZ plane, each skinned to its
+// own chain of joints stacked along Y and bent back and forth by its own
+// looping two second animation with the given glTF interpolation. The tubes
+// share one mesh, the skins one inverse bind matrix accessor. Returns path.
+std::string writeSkinnedCrowd(int characters, int joints,
+                              const std::string &path,
+                              const std::string &interpolation = "LINEAR");
+
+} // namespace triangle
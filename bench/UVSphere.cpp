@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UVSphere.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <glm/glm.hpp>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace triangle {
+
+template <typename T> static void appendValue(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static std::string bufferView(size_t offset, size_t length, int stride) {
+  return "{\"buffer\":0,\"byteOffset\":" + std::to_string(offset) +
+         ",\"byteLength\":" + std::to_string(length) +
+         (stride > 0 ? ",\"byteStride\":" + std::to_string(stride) : "") +
+         "}";
+}
+
+static std::string accessor(int bufferView, int componentType, bool normalized,
+                            int count, const char *type,
+                            const std::string &bounds = "") {
+  return "{\"bufferView\":" + std::to_string(bufferView) +
+         ",\"componentType\":" + std::to_string(componentType) +
+         (normalized ? ",\"normalized\":true" : "") +
+         ",\"count\":" + std::to_string(count) + ",\"type\":\"" + type +
+         "\"" + bounds + "}";
+}
+
+std::string writeUVSphere(int segments, const std::string &path,
+                          bool shuffled, bool quantized, int gridSize,
+                          int variant) {
+  const auto rings = segments / 2;
+  const auto vertexCount = (rings + 1) * (segments + 1);
+  std::vector<uint32_t> order(vertexCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937 random(1);
+  if (shuffled) {
+    std::shuffle(order.begin(), order.end(), random);
+  }
+  std::vector<uint32_t> position(vertexCount);
+  for (auto i = 0; i < vertexCount; ++i) {
+    position[order[i]] = i;
+  }
+  std::string positions, normals, texCoords, indices;
+  for (auto i = 0; i < vertexCount; ++i) {
+    auto ring = order[i] / (segments + 1), segment = order[i] % (segments + 1);
+    auto theta = float(M_PI) * ring / rings;
+    auto phi = 2.0f * float(M_PI) * segment / segments;
+    glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta),
+                     std::sin(theta) * std::sin(phi));
+    glm::vec2 texCoord(float(segment) / segments, float(ring) / rings);
+    if (!quantized) {
+      appendValue(positions, normal);
+      appendValue(normals, normal);
+      appendValue(texCoords, texCoord + glm::vec2(variant / 1024.0f, 0.0f));
+      continue;
+    }
+    for (auto c = 0; c < 4; ++c) {
+      appendValue(positions,
+                  int16_t(c < 3 ? std::round(normal[c] * 32767.0f) : 0));
+      appendValue(normals,
+                  int8_t(c < 3 ? std::round(normal[c] * 127.0f) : 0));
+    }
+    for (auto c = 0; c < 2; ++c) {
+      appendValue(texCoords, uint16_t(std::round(texCoord[c] * 65535.0f)));
+    }
+  }
+  std::vector<glm::uvec3> triangles;
+  for (auto ring = 0; ring < rings; ++ring) {
+    for (auto segment = 0; segment < segments; ++segment) {
+      auto a = ring * (segments + 1) + segment, b = a + segments + 1;
+      triangles.emplace_back(position[a], position[a + 1], position[b]);
+      triangles.emplace_back(position[b], position[a + 1], position[b + 1]);
+    }
+  }
+  if (shuffled) {
+    std::shuffle(triangles.begin(), triangles.end(), random);
+  }
+  for (auto &triangle : triangles) {
+    appendValue(indices, triangle);
+  }
+  auto bin = positions + normals + texCoords + indices;
+  auto count = vertexCount;
+  std::string nodes, sceneNodes;
+  for (auto i = 0; i < gridSize * gridSize; ++i) {
+    auto separator = i == 0 ? "" : ",";
+    auto x = (i % gridSize - (gridSize - 1) * 0.5f) * 3.0f;
+    auto z = (i / gridSize - (gridSize - 1) * 0.5f) * 3.0f;
+    nodes += separator + std::string("{\"mesh\":0,\"translation\":[") +
+             std::to_string(x) + ",0," + std::to_string(z) + "]}";
+    sceneNodes += separator + std::to_string(i);
+  }
+  auto positionBounds = quantized ? ",\"min\":[-32767,-32767,-32767],"
+                                    "\"max\":[32767,32767,32767]"
+                                  : ",\"min\":[-1,-1,-1],\"max\":[1,1,1]";
+  auto json =
+      "{\"asset\":{\"version\":\"2.0\"}," +
+      std::string(quantized ? "\"extensionsUsed\":[\"KHR_mesh_quantization\"],"
+                              "\"extensionsRequired\":[\"KHR_mesh_"
+                              "quantization\"],"
+                            : "") +
+      "\"scene\":0,\"scenes\":[{\"nodes\":[" +
+      sceneNodes + "]}],\"nodes\":[" + nodes +
+      "],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,"
+      "\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3,\"material\":0}]}],"
+      "\"materials\":[{}],\"buffers\":[{\"byteLength\":" +
+      std::to_string(bin.size()) + "}],\"bufferViews\":[" +
+      bufferView(0, positions.size(), quantized ? 8 : 0) + "," +
+      bufferView(positions.size(), normals.size(), quantized ? 4 : 0) + "," +
+      bufferView(positions.size() + normals.size(), texCoords.size(), 0) +
+      "," +
+      bufferView(positions.size() + normals.size() + texCoords.size(),
+                 indices.size(), 0) +
+      "],\"accessors\":[" +
+      accessor(0, quantized ? 5122 : 5126, quantized, count, "VEC3",
+               positionBounds) +
+      "," + accessor(1, quantized ? 5120 : 5126, quantized, count, "VEC3") +
+      "," + accessor(2, quantized ? 5123 : 5126, quantized, count, "VEC2") +
+      "," + accessor(3, 5125, false, triangles.size() * 3, "SCALAR") + "]}";
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+  std::string glb;
+  appendValue<uint32_t>(glb, 0x46546C67);
+  appendValue<uint32_t>(glb, 2);
+  appendValue<uint32_t>(glb, 12 + 8 + json.size() + 8 + bin.size());
+  appendValue<uint32_t>(glb, json.size());
+  appendValue<uint32_t>(glb, 0x4E4F534A);
+  glb += json;
+  appendValue<uint32_t>(glb, bin.size());
+  appendValue<uint32_t>(glb, 0x004E4942);
+  glb += bin;
+  std::ofstream(path, std::ios::binary).write(glb.data(), glb.size());
+  return path;
+}
+
+} // namespace triangle
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace triangle {
+
+// Writes a .glb with one unit sphere of segments x segments / 2 quads with
+// normals and texture coordinates and 32-bit indices. With shuffled the
+// triangles and vertices are in a fixed random order, like an exporter
+// writing faces in arbitrary order. With quantized the attributes use
+// KHR_mesh_quantization: normalized int16 positions, int8 normals and uint16
+// texture coordinates. With gridSize above 1, gridSize^2 nodes share the mesh
+// on the XZ plane, 3 units apart and centred on the origin. Spheres of
+// different variants offset their float texture coordinates by variant /
+// 1024, different bytes that look alike with the default texture. Returns
+// path.
+std::string writeUVSphere(int segments, const std::string &path,
+                          bool shuffled = false, bool quantized = false,
+                          int gridSize = 1, int variant = 0);
+
+} // namespace triangle
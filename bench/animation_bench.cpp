@@ -0,0 +1,151 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Plays one looping animation per character of a skinned crowd and reports
+// drawFrame + glFinish per frame with its animation and skinning scopes, then
+// times the joint matrix products of the skinning scope with the SIMD
+// helpers against plain glm on the same random matrices.
+// Usage: animation_bench [characters] [joints] [frames] [LINEAR|STEP|
+//                        CUBICSPLINE] [size]
+
+#include "HeadlessContext.h"
+#include "SkinnedCrowd.h"
+#include <Engine.h>
+#include <SimdMatrix.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto characters = argc > 1 ? std::atoi(argv[1]) : 256;
+  auto joints = argc > 2 ? std::atoi(argv[2]) : 32;
+  auto frames = argc > 3 ? std::atoi(argv[3]) : 120;
+  std::string interpolation = argc > 4 ? argv[4] : "LINEAR";
+  unsigned int size = argc > 5 ? std::atoi(argv[5]) : 512;
+  auto path = writeSkinnedCrowd(characters, joints, "animation_bench.glb",
+                                interpolation);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames < 1) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+  const auto extent = std::sqrt(float(characters)) * 1.5f;
+  Engine engine(size, size);
+  engine.setDefaultCamera(std::make_shared<Camera>(
+      glm::vec3(0.0f, extent * 0.6f, extent), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, extent * 4.0f));
+  auto handle = engine.loadGLTF(path);
+  engine.drawFrame();
+  if (!engine.playAnimation(handle, -1)) {
+    std::cout << "Failed to start the animations" << std::endl;
+    return 1;
+  }
+
+  double frameTime = 0.0, animationTime = 0.0, skinningTime = 0.0;
+  uint64_t triangles = 0;
+  for (auto frame = 0; frame < frames; ++frame) {
+    engine.advanceAnimations(1.0f / 60.0f);
+    auto frameStart = std::chrono::steady_clock::now();
+    engine.drawFrame();
+    glFinish();
+    frameTime += millisecondsSince(frameStart);
+    const auto &stats = engine.getFrameStats();
+    triangles += stats.triangles;
+    for (auto &timing : stats.cpuTimings) {
+      if (timing.name == std::string("animation")) {
+        animationTime += timing.milliseconds;
+      } else if (timing.name == std::string("skinning")) {
+        skinningTime += timing.milliseconds;
+      }
+    }
+  }
+  std::cout << characters << " characters x " << joints << " joints, "
+            << interpolation << ", " << triangles / frames
+            << " triangles per frame" << std::endl;
+  std::cout << "per frame: drawFrame + glFinish " << frameTime / frames
+            << " ms, animation " << animationTime / frames << " ms, skinning "
+            << skinningTime / frames << " ms" << std::endl;
+
+  // The products Skin::update forms per joint, mesh^-1 * joint * inverse bind,
+  // stored as the three rows the shader reads.
+  const auto count = characters * joints;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> values(-1.0f, 1.0f);
+  std::vector<glm::mat4> jointMatrices(count), inverseBindMatrices(count);
+  for (auto i = 0; i < count; ++i) {
+    for (auto c = 0; c < 16; ++c) {
+      jointMatrices[i][c / 4][c % 4] = values(random);
+      inverseBindMatrices[i][c / 4][c % 4] = values(random);
+    }
+  }
+  const auto inverseMeshMatrix = glm::inverse(jointMatrices[0]);
+  std::vector<float> simdRows(count * 12), scalarRows(count * 12);
+  // Best of several interleaved rounds, so neither side runs on a colder
+  // cache.
+  const auto rounds = 5, iterations = 10;
+  auto simdTime = 1e30, scalarTime = 1e30;
+  for (auto round = 0; round < rounds; ++round) {
+    auto simdStart = std::chrono::steady_clock::now();
+    for (auto iteration = 0; iteration < iterations; ++iteration) {
+      for (auto i = 0; i < count; ++i) {
+        glm::mat4 matrix;
+        multiplyMatrices(jointMatrices[i], inverseBindMatrices[i], matrix);
+        multiplyMatrices(inverseMeshMatrix, matrix, matrix);
+        storeAffineRows(matrix, &simdRows[i * 12]);
+      }
+    }
+    simdTime = std::min(simdTime, millisecondsSince(simdStart));
+    auto scalarStart = std::chrono::steady_clock::now();
+    for (auto iteration = 0; iteration < iterations; ++iteration) {
+      for (auto i = 0; i < count; ++i) {
+        const auto matrix =
+            inverseMeshMatrix * (jointMatrices[i] * inverseBindMatrices[i]);
+        for (auto row = 0; row < 3; ++row) {
+          for (auto column = 0; column < 4; ++column) {
+            scalarRows[i * 12 + row * 4 + column] = matrix[column][row];
+          }
+        }
+      }
+    }
+    scalarTime = std::min(scalarTime, millisecondsSince(scalarStart));
+  }
+  auto mismatches = 0;
+  for (auto i = 0; i < simdRows.size(); ++i) {
+    mismatches += simdRows[i] != scalarRows[i];
+  }
+  std::cout << "joint matrices: simd " << simdTime * 1e6 / iterations / count
+            << " ns, glm " << scalarTime * 1e6 / iterations / count
+            << " ns per joint, " << mismatches << " of " << simdRows.size()
+            << " values differ" << std::endl;
+  return 0;
+}
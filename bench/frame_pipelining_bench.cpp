@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Plays a skinned crowd with frames recorded and replayed inline, then
+// pipelined (frame N+1 recorded on the job system while frame N is replayed
+// on the GL thread), each with 1 and 2 job threads. Reports the wall time
+// per frame over the run, the record and submit scopes, and whether the last
+// frame's pixels match the inline run once the pipelined one is flushed.
+// Usage: frame_pipelining_bench [characters] [joints] [frames] [size]
+
+#include "HeadlessContext.h"
+#include "SkinnedCrowd.h"
+#include <Engine.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto characters = argc > 1 ? std::atoi(argv[1]) : 512;
+  auto joints = argc > 2 ? std::atoi(argv[2]) : 32;
+  auto frames = argc > 3 ? std::atoi(argv[3]) : 60;
+  unsigned int size = argc > 4 ? std::atoi(argv[4]) : 256;
+  auto path =
+      writeSkinnedCrowd(characters, joints, "frame_pipelining_bench.glb");
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames < 1) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << characters << " characters x " << joints << " joints"
+            << std::endl;
+
+  const auto extent = std::sqrt(float(characters)) * 1.5f;
+  std::vector<unsigned char> inlinePixels;
+  for (auto pipelined : {false, true}) {
+    for (auto threads : {1u, 2u}) {
+      Engine engine(size, size);
+      engine.setJobThreads(threads);
+      engine.setFramePipelining(pipelined);
+      engine.setDefaultCamera(std::make_shared<Camera>(
+          glm::vec3(0.0f, extent * 0.6f, extent), glm::vec3(0.0f, 0.0f, 0.0f),
+          glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, extent * 4.0f));
+      auto handle = engine.loadGLTF(path);
+      engine.drawFrame();
+      engine.playAnimation(handle, -1);
+      engine.flushFrame();
+      glFinish();
+
+      std::map<std::string, double> scopeTimes;
+      auto start = std::chrono::steady_clock::now();
+      for (auto frame = 0; frame < frames; ++frame) {
+        engine.advanceAnimations(1.0f / 60.0f);
+        engine.drawFrame();
+        for (auto &timing : engine.getFrameStats().cpuTimings) {
+          scopeTimes[timing.name] += timing.milliseconds;
+        }
+      }
+      engine.flushFrame();
+      glFinish();
+      auto frameTime = millisecondsSince(start) / frames;
+
+      std::vector<unsigned char> pixels(size * size * 4);
+      glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                   pixels.data());
+      if (inlinePixels.empty()) {
+        inlinePixels = pixels;
+      }
+      std::cout << (pipelined ? "pipelined" : "inline") << ", " << threads
+                << " job threads: " << frameTime << " ms per frame, record "
+                << (scopeTimes["transforms"] + scopeTimes["cull"] +
+                    scopeTimes["sort"] + scopeTimes["record"]) /
+                       frames
+                << " ms, submit " << scopeTimes["submit"] / frames
+                << " ms, last frame "
+                << (pixels == inlinePixels ? "matches" : "differs from")
+                << " inline" << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loads copies of a glTF into one engine and compares what the geometry
+// arenas hold with the glTF buffers, which used to be uploaded whole as one
+// buffer object each. Then unloads every other copy, compacts the arenas and
+// checks that the frames rendered from the moved ranges match the one
+// rendered before, the copies all drawing the same picture. The generated
+// copies are sphere variants so that each gets its own geometry; copies of a
+// given path are identical and share one allocation, which leaves nothing to
+// compact.
+// Usage: geometry_arena_bench [path|-] [copies] [size] [segments]
+
+#include "HeadlessContext.h"
+#include "UVSphere.h"
+#include <Engine.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static void printStats(const char *label, Engine &engine) {
+  const auto &stats = engine.getGeometryStats();
+  std::cout << label << ": " << stats.vertices.pages + stats.indices.pages
+            << " buffers, "
+            << stats.vertices.capacityBytes + stats.indices.capacityBytes
+            << " bytes allocated, "
+            << stats.vertices.usedBytes + stats.indices.usedBytes
+            << " used, " << stats.vertexArrays << " vertex arrays"
+            << std::endl;
+}
+
+int main(int argc, char **argv) {
+  auto copies = argc > 2 ? std::atoi(argv[2]) : 32;
+  unsigned int size = argc > 3 ? std::atoi(argv[3]) : 128;
+  auto segments = argc > 4 ? std::atoi(argv[4]) : 256;
+  auto generated = argc <= 1 || std::strcmp(argv[1], "-") == 0;
+  std::vector<std::string> paths;
+  for (auto i = 0; i < copies; ++i) {
+    paths.push_back(
+        generated ? writeUVSphere(segments,
+                                  "geometry_arena_bench_" + std::to_string(i) +
+                                      ".glb",
+                                  false, false, 1, i)
+                  : std::string(argv[1]));
+  }
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || copies <= 0) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  const auto &path = paths[0];
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path
+            << (generated ? ", one variant per copy"
+                          : ", identical copies share one geometry allocation")
+            << std::endl;
+
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string error, warning;
+  auto binary =
+      path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+  if (!(binary ? loader.LoadBinaryFromFile(&model, &error, &warning, path)
+               : loader.LoadASCIIFromFile(&model, &error, &warning, path))) {
+    std::cout << "Failed to load " << path << ": " << error << std::endl;
+    return 1;
+  }
+  size_t bufferBytes = 0;
+  for (auto &buffer : model.buffers) {
+    bufferBytes += buffer.data.size();
+  }
+  std::cout << copies << " copies, glTF buffers: "
+            << model.buffers.size() * copies << " buffers, "
+            << bufferBytes * copies << " bytes" << std::endl;
+
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 3.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 1.0f, 20.0f);
+  Engine engine(size, size);
+  engine.setDefaultCamera(camera);
+  std::vector<std::shared_ptr<LoadHandle>> handles;
+  auto loadStart = std::chrono::steady_clock::now();
+  for (auto i = 0; i < copies; ++i) {
+    handles.push_back(engine.loadGLTF(paths[i]));
+  }
+  engine.drawFrame();
+  glFinish();
+  std::cout << "load: " << millisecondsSince(loadStart) << " ms" << std::endl;
+  printStats("loaded", engine);
+  std::vector<unsigned char> expected(size * size * 4), actual(expected);
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, expected.data());
+  auto mismatches = 0;
+
+  for (auto i = 0; i < copies; i += 2) {
+    engine.unloadGLTF(handles[i]);
+  }
+  auto compactions = engine.getGeometryStats().vertices.compactions +
+                     engine.getGeometryStats().indices.compactions;
+  printStats("unloaded every other copy", engine);
+  engine.drawFrame();
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, actual.data());
+  mismatches += actual != expected;
+
+  auto compactStart = std::chrono::steady_clock::now();
+  auto moved = engine.compactGeometry();
+  glFinish();
+  auto compactTime = millisecondsSince(compactStart);
+  printStats("compacted", engine);
+  std::cout << "compaction: " << (moved ? "moved" : "nothing to move")
+            << " in " << compactTime << " ms, " << compactions
+            << " automatic before" << std::endl;
+  engine.drawFrame();
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, actual.data());
+  mismatches += actual != expected;
+  std::cout << "frames after unloading and compaction match: "
+            << (mismatches == 0 ? "yes" : "no") << std::endl;
+
+  for (auto i = 1; i < copies; i += 2) {
+    engine.unloadGLTF(handles[i]);
+  }
+  printStats("unloaded all", engine);
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the CPU cost of each GL error checking mode. Renders an orbit with
+// the mode switching every frame and reports the drawFrame p50/mean per mode
+// with the glGetError calls it made, plus the cost of a bare glGetError.
+// Without a path the scene is a cube grid with one mesh per node, so every
+// cube is its own draw and the per-call checks add up.
+// Usage: gl_error_bench [path|-] [frames] [size] [grid]
+
+#include "CubeGrid.h"
+#include "HeadlessContext.h"
+#include <Engine.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static const char *MODE_NAMES[] = {"off", "per-frame", "per-call",
+                                   "debug-callback"};
+
+int main(int argc, char **argv) {
+  auto frames = argc > 2 ? std::atoi(argv[2]) : 100;
+  unsigned int size = argc > 3 ? std::atoi(argv[3]) : 64;
+  auto grid = argc > 4 ? std::atoi(argv[4]) : 10;
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeCubeGrid(grid, "gl_error_bench.glb", false);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames <= 0) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path << std::endl;
+
+  const auto radius = 5.0f;
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 0.0f, radius), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 70.0f, 1.0f, 1.0f, radius * 2.0f);
+  Engine engine(size, size);
+  engine.setDefaultCamera(camera);
+  engine.loadGLTF(path);
+  engine.drawFrame();
+
+  // Modes rotate every frame so that drift in the driver's own cost spreads
+  // evenly over them.
+  const GLErrorMode modes[] = {GLErrorMode::OFF, GLErrorMode::PER_FRAME,
+                               GLErrorMode::PER_CALL,
+                               GLErrorMode::DEBUG_CALLBACK};
+  std::vector<double> cpuTimes[4];
+  uint64_t queries[4] = {0};
+  for (auto i = 0; i < 4; ++i) {
+    if (setGLErrorMode(modes[i]) != modes[i]) {
+      std::cout << MODE_NAMES[i] << " unavailable" << std::endl;
+    }
+  }
+  for (auto frame = 0; frame < frames * 4; ++frame) {
+    auto mode = frame % 4;
+    setGLErrorMode(modes[mode]);
+    auto theta = -2.0f * float(M_PI) * (frame / 4) / frames;
+    camera->setPosition(
+        glm::vec3(radius * std::cos(theta), 0.0f, radius * std::sin(theta)));
+    auto firstQuery = getGLErrorQueryCount();
+    auto frameStart = std::chrono::steady_clock::now();
+    engine.drawFrame();
+    cpuTimes[mode].push_back(millisecondsSince(frameStart));
+    queries[mode] += getGLErrorQueryCount() - firstQuery;
+    glFinish();
+  }
+  setGLErrorMode(GLErrorMode::OFF);
+
+  const auto callCount = 100000;
+  auto callStart = std::chrono::steady_clock::now();
+  for (auto i = 0; i < callCount; ++i) {
+    glGetError();
+  }
+  auto callTime = millisecondsSince(callStart) * 1e6 / callCount;
+
+  std::cout << frames << " frames per mode at " << size << "x" << size << ", "
+            << engine.getRenderQueueStats().draws << " draws per frame"
+            << std::endl;
+  std::cout << "glGetError: " << callTime << " ns per call" << std::endl;
+  double means[4];
+  for (auto i = 0; i < 4; ++i) {
+    std::sort(cpuTimes[i].begin(), cpuTimes[i].end());
+    means[i] = 0.0;
+    for (auto time : cpuTimes[i]) {
+      means[i] += time / frames;
+    }
+    std::cout << MODE_NAMES[i] << ": cpu ms p50 "
+              << cpuTimes[i][frames / 2] << " mean " << means[i] << " (+"
+              << means[i] - means[0] << "), glGetError per frame "
+              << double(queries[i]) / frames << std::endl;
+  }
+  return 0;
+}
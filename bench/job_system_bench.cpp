@@ -0,0 +1,153 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loads and plays a skinned crowd with 1, 2, 4 and hardware concurrency job
+// threads and reports the load stages and the per frame scopes that run on
+// the job system, then times a bare JobSystem::parallelFor over a dependent
+// chain of batches against a plain loop.
+// Usage: job_system_bench [characters] [joints] [frames] [size]
+
+#include "HeadlessContext.h"
+#include "SkinnedCrowd.h"
+#include <Engine.h>
+#include <JobSystem.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// A few hundred nanoseconds of arithmetic the compiler cannot fold.
+static float work(unsigned int index) {
+  auto value = float(index);
+  for (auto i = 0; i < 64; ++i) {
+    value = std::sqrt(value * 1.0001f + 1.0f);
+  }
+  return value;
+}
+
+int main(int argc, char **argv) {
+  auto characters = argc > 1 ? std::atoi(argv[1]) : 1024;
+  auto joints = argc > 2 ? std::atoi(argv[2]) : 32;
+  auto frames = argc > 3 ? std::atoi(argv[3]) : 60;
+  unsigned int size = argc > 4 ? std::atoi(argv[4]) : 256;
+  auto path = writeSkinnedCrowd(characters, joints, "job_system_bench.glb");
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames < 1) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER)
+            << ", hardware threads: " << std::thread::hardware_concurrency()
+            << std::endl;
+  std::cout << characters << " characters x " << joints << " joints"
+            << std::endl;
+
+  std::vector<unsigned int> threadCounts = {1, 2, 4};
+  if (std::thread::hardware_concurrency() > 4) {
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  }
+  const auto extent = std::sqrt(float(characters)) * 1.5f;
+  const char *scopes[] = {"animation", "skinning", "transforms", "cull",
+                          "sort"};
+  for (auto threads : threadCounts) {
+    Engine engine(size, size);
+    engine.setJobThreads(threads);
+    engine.setDefaultCamera(std::make_shared<Camera>(
+        glm::vec3(0.0f, extent * 0.6f, extent), glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, extent * 4.0f));
+    auto handle = engine.loadGLTF(path);
+    engine.drawFrame();
+    engine.playAnimation(handle, -1);
+    const auto &loads = engine.getFrameStats().completedLoads;
+    LoadTimings load;
+    if (!loads.empty()) {
+      load = loads[0];
+    }
+
+    double frameTime = 0.0;
+    std::map<std::string, double> scopeTimes;
+    for (auto frame = 0; frame < frames; ++frame) {
+      engine.advanceAnimations(1.0f / 60.0f);
+      auto frameStart = std::chrono::steady_clock::now();
+      engine.drawFrame();
+      glFinish();
+      frameTime += millisecondsSince(frameStart);
+      for (auto &timing : engine.getFrameStats().cpuTimings) {
+        scopeTimes[timing.name] += timing.milliseconds;
+      }
+    }
+    std::cout << threads << " threads: load " << load.totalMilliseconds
+              << " ms (collision " << load.collisionMilliseconds
+              << ", optimize " << load.optimizeMilliseconds << ", build "
+              << load.buildMilliseconds << "), frame "
+              << frameTime / frames << " ms";
+    for (auto scope : scopes) {
+      std::cout << ", " << scope << " " << scopeTimes[scope] / frames;
+    }
+    std::cout << std::endl;
+  }
+
+  // Each batch depends on the previous one, like the stages of a frame.
+  const unsigned int items = 1 << 16, batches = 16;
+  std::vector<float> results(items);
+  auto serialStart = std::chrono::steady_clock::now();
+  for (auto batch = 0; batch < batches; ++batch) {
+    for (auto i = 0; i < items; ++i) {
+      results[i] = work(i + batch);
+    }
+  }
+  std::cout << "plain loop: " << millisecondsSince(serialStart) << " ms"
+            << std::endl;
+  for (auto threads : threadCounts) {
+    JobSystem jobSystem(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<Job> previous;
+    for (auto batch = 0; batch < batches; ++batch) {
+      std::vector<std::shared_ptr<Job>> dependencies;
+      if (previous) {
+        dependencies.push_back(previous);
+      }
+      previous = jobSystem.schedule(
+          [&, batch]() {
+            jobSystem.parallelFor(items, 1024, [&](unsigned int begin,
+                                                   unsigned int end) {
+              for (auto i = begin; i < end; ++i) {
+                results[i] = work(i + batch);
+              }
+            });
+          },
+          dependencies);
+    }
+    jobSystem.wait(previous);
+    std::cout << threads << " threads: " << millisecondsSince(start) << " ms"
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Flies a camera away over a grid of dense spheres, drawn with the full
+// meshes and with generated levels of detail at the default 1 pixel error
+// threshold, the frames of the two engines interleaved. Reports the time the
+// simplification adds to the load, triangles drawn and drawFrame + glFinish
+// per frame at the near, middle and far end of the path, how often the
+// triangle count changed between frames, and how many pixels differ from the
+// full meshes at those points.
+// Usage: lod_bench [frames] [size] [segments] [grid]
+
+#include "HeadlessContext.h"
+#include "UVSphere.h"
+#include <Engine.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto frames = argc > 1 ? std::atoi(argv[1]) : 90;
+  unsigned int size = argc > 2 ? std::atoi(argv[2]) : 256;
+  auto segments = argc > 3 ? std::atoi(argv[3]) : 192;
+  auto gridSize = argc > 4 ? std::atoi(argv[4]) : 4;
+  auto path = writeUVSphere(segments, "lod_bench.glb", false, false, gridSize);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames < 3) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+  const auto extent = gridSize * 3.0f;
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 2.0f, extent), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, extent * 20.0f);
+  const char *names[] = {"full", "lod"};
+  std::vector<std::shared_ptr<Engine>> engines;
+  for (auto i = 0; i < 2; ++i) {
+    engines.push_back(std::make_shared<Engine>(size, size));
+    engines[i]->setDefaultCamera(camera);
+    engines[i]->setLodGeneration(i == 1);
+    engines[i]->loadGLTF(path);
+    engines[i]->drawFrame();
+    const auto &loads = engines[i]->getFrameStats().completedLoads;
+    std::cout << names[i] << " load: simplify and rewrite "
+              << (loads.empty() ? 0.0 : loads[0].optimizeMilliseconds)
+              << " ms" << std::endl;
+  }
+
+  const int checkpoints[] = {0, frames / 2, frames - 1};
+  std::vector<unsigned char> pixels[2];
+  std::vector<double> frameTimes[2];
+  std::vector<uint64_t> triangles[2];
+  for (auto frame = 0; frame < frames * 2; ++frame) {
+    auto engine = frame % 2;
+    auto distance = extent * (0.2f + 9.8f * (frame / 2) / (frames - 1));
+    camera->setPosition(glm::vec3(0.0f, distance * 0.3f, distance));
+    auto frameStart = std::chrono::steady_clock::now();
+    engines[engine]->drawFrame();
+    glFinish();
+    frameTimes[engine].push_back(millisecondsSince(frameStart));
+    triangles[engine].push_back(engines[engine]->getFrameStats().triangles);
+    for (auto checkpoint : checkpoints) {
+      if (frame / 2 != checkpoint) {
+        continue;
+      }
+      std::vector<unsigned char> framePixels(size * size * 4);
+      glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                   framePixels.data());
+      if (engine == 0) {
+        pixels[0] = framePixels;
+        continue;
+      }
+      auto differing = 0;
+      for (auto p = 0; p < framePixels.size(); p += 4) {
+        differing += memcmp(&framePixels[p], &pixels[0][p], 4) != 0;
+      }
+      std::cout << "distance " << distance << ": triangles "
+                << triangles[0].back() << " -> " << triangles[1].back()
+                << ", frame ms " << frameTimes[0].back() << " -> "
+                << frameTimes[1].back() << ", pixels differing " << differing
+                << std::endl;
+    }
+  }
+  for (auto i = 0; i < 2; ++i) {
+    auto changes = 0;
+    uint64_t total = 0;
+    double time = 0.0;
+    for (auto frame = 0; frame < frames; ++frame) {
+      changes += frame > 0 && triangles[i][frame] != triangles[i][frame - 1];
+      total += triangles[i][frame];
+      time += frameTimes[i][frame];
+    }
+    std::cout << names[i] << ": " << total / frames
+              << " triangles per frame, " << time / frames
+              << " ms per frame, triangle count changed in " << changes
+              << " of " << frames - 1 << " frames" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Renders a glTF from a ring of cameras, once as one setDefaultCamera +
+// drawFrame per view and once as a single Engine::drawViews into an atlas or
+// layered target, and reports the time per set of views along with the
+// engine's CPU time from FrameStats. Setup sums the loads, transforms, cull
+// and sort scopes, the part drawViews does once per set, submit is the rest.
+// Every view of the multi-view target is compared against its drawFrame
+// render first.
+// Usage: multiview_bench [path|-] [views] [size] [iterations]
+//                        [atlas|layered]
+
+#include "CubeGrid.h"
+#include "HeadlessContext.h"
+#include <Engine.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double getSetupMilliseconds(const FrameStats &stats) {
+  auto milliseconds = 0.0;
+  for (auto &timing : stats.cpuTimings) {
+    if (std::strcmp(timing.name, "submit") != 0) {
+      milliseconds += timing.milliseconds;
+    }
+  }
+  return milliseconds;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto viewCount = argc > 2 ? std::atoi(argv[2]) : 36;
+  unsigned int size = argc > 3 ? std::atoi(argv[3]) : 128;
+  auto iterations = argc > 4 ? std::atoi(argv[4]) : 10;
+  std::string layout = argc > 5 ? argv[5] : "atlas";
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeCubeGrid(12, "multiview_bench.glb");
+
+  HeadlessContext context(size, size);
+  if (!context.isValid()) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path << std::endl;
+
+  // Thumbnail style ring: around the Y axis, alternating above and below.
+  const auto radius = 5.0f;
+  std::vector<std::shared_ptr<Camera>> cameras;
+  for (auto view = 0; view < viewCount; ++view) {
+    auto theta = 2.0f * float(M_PI) * view / viewCount;
+    auto elevation = view % 2 == 0 ? 1.5f : -1.5f;
+    cameras.push_back(std::make_shared<Camera>(
+        glm::vec3(radius * std::cos(theta), elevation,
+                  radius * std::sin(theta)),
+        glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f,
+        1.0f, radius * 2.0f));
+  }
+  Engine engine(size, size);
+  engine.setDefaultCamera(cameras[0]);
+  engine.loadGLTF(path);
+  engine.drawFrame();
+  MultiViewTarget target(size, size, viewCount,
+                         layout == "layered" ? ViewLayout::LAYERED
+                                             : ViewLayout::ATLAS);
+  if (!target.isComplete()) {
+    std::cout << "Multi-view target is incomplete" << std::endl;
+    return 1;
+  }
+
+  engine.drawViews(cameras, target);
+  std::vector<unsigned char> expected(size * size * 4), actual;
+  unsigned int mismatchedViews = 0;
+  for (auto view = 0; view < viewCount; ++view) {
+    engine.setDefaultCamera(cameras[view]);
+    engine.drawFrame();
+    glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                 expected.data());
+    target.readView(view, actual);
+    mismatchedViews += actual != expected;
+  }
+  std::cout << "views matching drawFrame: " << viewCount - mismatchedViews
+            << "/" << viewCount << std::endl;
+
+  uint64_t singleDraws = 0, singleStateChanges = 0;
+  double singleCpuTime = 0.0, singleSetupTime = 0.0;
+  auto singleStart = std::chrono::steady_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    for (auto &camera : cameras) {
+      engine.setDefaultCamera(camera);
+      engine.drawFrame();
+      singleDraws += engine.getRenderQueueStats().draws;
+      singleStateChanges += engine.getRenderQueueStats().stateChanges;
+      singleCpuTime += engine.getFrameStats().cpuMilliseconds;
+      singleSetupTime += getSetupMilliseconds(engine.getFrameStats());
+    }
+    glFinish();
+  }
+  auto singleTime = millisecondsSince(singleStart);
+
+  uint64_t multiDraws = 0, multiStateChanges = 0;
+  double multiCpuTime = 0.0, multiSetupTime = 0.0;
+  auto multiStart = std::chrono::steady_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    engine.drawViews(cameras, target);
+    multiDraws += engine.getRenderQueueStats().draws;
+    multiStateChanges += engine.getRenderQueueStats().stateChanges;
+    multiCpuTime += engine.getFrameStats().cpuMilliseconds;
+    multiSetupTime += getSetupMilliseconds(engine.getFrameStats());
+    glFinish();
+  }
+  auto multiTime = millisecondsSince(multiStart);
+
+  if (iterations <= 0) {
+    return 0;
+  }
+  std::cout << viewCount << " views at " << size << "x" << size << ", "
+            << layout << std::endl;
+  std::cout << "drawFrame per view: " << singleTime / iterations
+            << " ms per set, engine cpu " << singleCpuTime / iterations
+            << " ms, setup " << singleSetupTime / iterations << " ms, submit "
+            << (singleCpuTime - singleSetupTime) / iterations << " ms, draws "
+            << double(singleDraws) / iterations << " state changes "
+            << double(singleStateChanges) / iterations << std::endl;
+  std::cout << "drawViews: " << multiTime / iterations
+            << " ms per set, engine cpu " << multiCpuTime / iterations
+            << " ms, setup " << multiSetupTime / iterations << " ms, submit "
+            << (multiCpuTime - multiSetupTime) / iterations << " ms, draws "
+            << double(multiDraws) / iterations << " state changes "
+            << double(multiStateChanges) / iterations << std::endl;
+  std::cout << "drawViews time relative to drawFrame per view: "
+            << multiTime / singleTime << " ("
+            << (multiTime < singleTime ? "faster" : "slower") << ")"
+            << std::endl;
+  return mismatchedViews == 0 ? 0 : 1;
+}
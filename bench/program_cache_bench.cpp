@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times building every shader permutation with the driver's own shader cache
+// pointed at an empty directory, so that the first compile of each is cold.
+// "binary" compiles them on the GL thread into an empty program binary cache
+// and then loads them from it in a second engine. "foreground" and
+// "background" compile them before loading a cube grid, on the GL thread or
+// on a shared context, and report how long the GL thread was held up until
+// the first frame was done. Run the modes as separate processes.
+// Usage: program_cache_bench [binary|foreground|background] [size]
+
+#include "CubeGrid.h"
+#include "HeadlessContext.h"
+#include <Engine.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  std::string mode = argc > 1 ? argv[1] : "binary";
+  unsigned int size = argc > 2 ? std::atoi(argv[2]) : 128;
+  char driverCache[] = "/tmp/program_cache_bench_driverXXXXXX";
+  char binaryCache[] = "/tmp/program_cache_bench_binaryXXXXXX";
+  if (mkdtemp(driverCache) == nullptr || mkdtemp(binaryCache) == nullptr) {
+    return 1;
+  }
+  setenv("MESA_SHADER_CACHE_DIR", driverCache, 1);
+  auto path = writeCubeGrid(8, "program_cache_bench.glb");
+
+  HeadlessContext context(size, size);
+  if (!context.isValid()) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+  const std::vector<uint32_t> permutations = {0, SHADER_FEATURE_VERTEX_COLOR};
+  std::cout << permutations.size() << " permutations, " << mode << std::endl;
+  if (mode == "binary") {
+    for (auto pass = 0; pass < 2; ++pass) {
+      Engine engine(size, size);
+      engine.setProgramCacheDirectory(binaryCache);
+      auto start = std::chrono::steady_clock::now();
+      engine.precompilePrograms(permutations, false);
+      glFinish();
+      auto time = millisecondsSince(start);
+      const auto &stats = engine.getProgramCacheStats();
+      std::cout << (pass == 0 ? "compiled: " : "from binary cache: ") << time
+                << " ms, " << stats.compiled << " compiled, " << stats.loaded
+                << " loaded, " << stats.stored << " stored" << std::endl;
+    }
+  } else {
+    Engine engine(size, size);
+    auto start = std::chrono::steady_clock::now();
+    engine.precompilePrograms(permutations, mode == "background");
+    auto precompileTime = millisecondsSince(start);
+    engine.loadGLTF(path);
+    engine.drawFrame();
+    glFinish();
+    std::cout << "precompilePrograms returned after " << precompileTime
+              << " ms, first frame done after " << millisecondsSince(start)
+              << " ms" << std::endl;
+  }
+  auto command = std::string("rm -rf ") + driverCache + " " + binaryCache;
+  return std::system(command.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how many program/material/VAO changes a frame needs when draw
+// items are submitted in hierarchy order versus sorted by the render queue.
+// Usage: render_queue_bench [items] [materials] [vaos] [iterations]
+
+#include <RenderQueue.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace triangle;
+
+int main(int argc, char **argv) {
+  auto itemCount = argc > 1 ? std::atoi(argv[1]) : 10000;
+  auto materialCount = argc > 2 ? std::atoi(argv[2]) : 64;
+  auto vaoCount = argc > 3 ? std::atoi(argv[3]) : 256;
+  auto iterations = argc > 4 ? std::atoi(argv[4]) : 100;
+
+  std::mt19937 random(1);
+  std::vector<std::shared_ptr<Material>> materials;
+  for (auto i = 0; i < materialCount; ++i) {
+    materials.push_back(std::make_shared<Material>(1, i + 1, 0));
+  }
+  std::vector<std::shared_ptr<Primitive>> primitives;
+  for (auto i = 0; i < vaoCount; ++i) {
+    auto primitive =
+        std::make_shared<Primitive>(i + 1, GL_TRIANGLES, 3, GL_UNSIGNED_SHORT);
+    primitive->setMaterial(materials[random() % materials.size()]);
+    primitives.push_back(primitive);
+  }
+  std::vector<std::pair<Primitive *, float>> items;
+  std::uniform_real_distribution<float> depths(0.0f, 1.0f);
+  for (auto i = 0; i < itemCount; ++i) {
+    items.emplace_back(primitives[random() % primitives.size()].get(),
+                       depths(random));
+  }
+
+  RenderQueue renderQueue;
+  auto fill = [&]() {
+    renderQueue.clear();
+    for (auto &item : items) {
+      renderQueue.push(item.first, 1, glm::mat4(1.0f), item.second);
+    }
+  };
+
+  fill();
+  auto unsortedStateChanges = renderQueue.countStateChanges();
+
+  auto begin = std::chrono::steady_clock::now();
+  for (auto i = 0; i < iterations; ++i) {
+    fill();
+    renderQueue.sort();
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto sortedStateChanges = renderQueue.countStateChanges();
+  auto microseconds =
+      std::chrono::duration<double, std::micro>(end - begin).count() /
+      iterations;
+
+  std::cout << "items: " << itemCount << ", materials: " << materialCount
+            << ", vaos: " << vaoCount << std::endl;
+  std::cout << "state changes per frame (hierarchy order): "
+            << unsortedStateChanges << std::endl;
+  std::cout << "state changes per frame (sorted): " << sortedStateChanges
+            << std::endl;
+  std::cout << "fill + sort time per frame: " << microseconds << " us"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Loads the same glTF into several engines on one context, first with a
+// resource cache per engine and then with one cache shared by all of them,
+// and reports the load time, the GPU bytes and GL objects behind the
+// engines, the bytes the shared cache saved and the state changes of a
+// frame. Then unloads the asset from the first engine, compacts the shared
+// arenas and checks that the second engine still renders the same pixels.
+// Usage: resource_cache_bench [path|-] [engines] [grid] [size]
+
+#include "CubeGrid.h"
+#include "HeadlessContext.h"
+#include <Engine.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto engineCount = argc > 2 ? std::max(2, std::atoi(argv[2])) : 4;
+  auto gridSize = argc > 3 ? std::atoi(argv[3]) : 8;
+  unsigned int size = argc > 4 ? std::atoi(argv[4]) : 256;
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeCubeGrid(gridSize, "resource_cache_bench.glb", false);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid()) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path << ", " << engineCount << " engines"
+            << std::endl;
+
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 3.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, 50.0f);
+  const char *names[] = {"separate", "shared"};
+  std::vector<std::shared_ptr<Engine>> engines;
+  std::vector<std::shared_ptr<LoadHandle>> handles;
+  for (auto shared = 0; shared < 2; ++shared) {
+    engines.clear();
+    handles.clear();
+    auto cache = std::make_shared<ResourceCache>();
+    auto loadStart = std::chrono::steady_clock::now();
+    for (auto i = 0; i < engineCount; ++i) {
+      engines.push_back(std::make_shared<Engine>(size, size));
+      engines[i]->setDefaultCamera(camera);
+      if (shared) {
+        engines[i]->setResourceCache(cache);
+      }
+      handles.push_back(engines[i]->loadGLTF(path));
+      engines[i]->drawFrame();
+    }
+    glFinish();
+    auto loadTime = millisecondsSince(loadStart);
+    ResourceCacheStats total;
+    for (auto i = 0; i < (shared ? 1 : engineCount); ++i) {
+      const auto &stats = engines[i]->getResourceCacheStats();
+      total.textures += stats.textures;
+      total.geometries += stats.geometries;
+      total.materials += stats.materials;
+      total.textureBytes += stats.textureBytes;
+      total.geometryBytes += stats.geometryBytes;
+      total.savedTextureBytes += stats.savedTextureBytes;
+      total.savedGeometryBytes += stats.savedGeometryBytes;
+    }
+    engines[0]->drawFrame();
+    std::cout << names[shared] << ": load + first frame " << loadTime
+              << " ms, textures " << total.textures << " ("
+              << total.textureBytes << " bytes), geometry "
+              << total.geometries << " (" << total.geometryBytes
+              << " bytes), materials " << total.materials << ", saved "
+              << total.savedTextureBytes << " texture and "
+              << total.savedGeometryBytes << " geometry bytes, "
+              << "state changes per frame "
+              << engines[0]->getFrameStats().stateChanges << std::endl;
+  }
+
+  std::vector<unsigned char> before(size * size * 4), after(size * size * 4);
+  engines[1]->drawFrame();
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, before.data());
+  engines[0]->unloadGLTF(handles[0]);
+  engines[0]->loadGLTF(writeCubeGrid(2, "resource_cache_bench_small.glb"));
+  engines[0]->drawFrame();
+  engines[0]->compactGeometry();
+  engines[1]->drawFrame();
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, after.data());
+  std::cout << "after unload and compaction by another engine: "
+            << (before == after ? "same pixels" : "pixels differ")
+            << std::endl;
+  return before == after ? 0 : 1;
+}
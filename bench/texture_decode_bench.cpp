@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures glTF load time against the number of image decode threads. Without
+// a path it writes a .glb with generated PNG textures and loads that.
+// Usage: texture_decode_bench [path|-] [images] [size] [iterations] [threads]
+
+#include <GLTFLoader.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stb_image_write.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triangle;
+
+static void appendPNG(void *context, void *data, int size) {
+  auto *out = static_cast<std::vector<unsigned char> *>(context);
+  auto *bytes = static_cast<unsigned char *>(data);
+  out->insert(out->end(), bytes, bytes + size);
+}
+
+static void appendUint32(std::string &out, uint32_t value) {
+  out.append(reinterpret_cast<const char *>(&value), 4);
+}
+
+static std::string writeSyntheticGLB(int imageCount, int imageSize) {
+  std::mt19937 random(1);
+  std::vector<unsigned char> bin;
+  std::string images, bufferViews, textures;
+  std::vector<unsigned char> pixels(imageSize * imageSize * 4);
+  for (auto i = 0; i < imageCount; ++i) {
+    for (auto p = 0; p < imageSize * imageSize; ++p) {
+      auto x = p % imageSize, y = p / imageSize;
+      pixels[p * 4 + 0] = (x + i * 16) & 0xFF;
+      pixels[p * 4 + 1] = (y * 3) & 0xFF;
+      pixels[p * 4 + 2] = random() & 0x3F;
+      pixels[p * 4 + 3] = 0xFF;
+    }
+    auto offset = bin.size();
+    stbi_write_png_to_func(&appendPNG, &bin, imageSize, imageSize, 4,
+                           pixels.data(), imageSize * 4);
+    auto length = bin.size() - offset;
+    bin.resize((bin.size() + 3) & ~size_t(3));
+    auto separator = i == 0 ? "" : ",";
+    images += separator + std::string("{\"bufferView\":") +
+              std::to_string(i) + ",\"mimeType\":\"image/png\"}";
+    bufferViews += separator + std::string("{\"buffer\":0,\"byteOffset\":") +
+                   std::to_string(offset) +
+                   ",\"byteLength\":" + std::to_string(length) + "}";
+    textures += separator + std::string("{\"source\":") + std::to_string(i) +
+                "}";
+  }
+  auto json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" +
+              std::to_string(bin.size()) + "}],\"bufferViews\":[" +
+              bufferViews + "],\"images\":[" + images + "],\"textures\":[" +
+              textures + "]}";
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+  std::string glb;
+  appendUint32(glb, 0x46546C67);
+  appendUint32(glb, 2);
+  appendUint32(glb, 12 + 8 + json.size() + 8 + bin.size());
+  appendUint32(glb, json.size());
+  appendUint32(glb, 0x4E4F534A);
+  glb += json;
+  appendUint32(glb, bin.size());
+  appendUint32(glb, 0x004E4942);
+  glb.append(bin.begin(), bin.end());
+  std::string path = "texture_decode_bench.glb";
+  std::ofstream(path, std::ios::binary).write(glb.data(), glb.size());
+  return path;
+}
+
+int main(int argc, char **argv) {
+  auto imageCount = argc > 2 ? std::atoi(argv[2]) : 32;
+  auto imageSize = argc > 3 ? std::atoi(argv[3]) : 1024;
+  auto iterations = argc > 4 ? std::atoi(argv[4]) : 3;
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeSyntheticGLB(imageCount, imageSize);
+
+  std::vector<unsigned int> threadCounts = {0};
+  auto maxThreads =
+      argc > 5 ? unsigned(std::atoi(argv[5]))
+               : std::max(1u, std::thread::hardware_concurrency());
+  for (auto threads = 1u; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::cout << "asset: " << path << std::endl;
+  std::cout << "threads\tload ms\tspeedup" << std::endl;
+  auto baseline = 0.0;
+  for (auto threads : threadCounts) {
+    auto best = 1e30;
+    for (auto i = 0; i < iterations; ++i) {
+      GLTFLoader loader;
+      tinygltf::Model model;
+      std::string err, warn;
+      loader.setImageDecodeThreads(threads);
+      auto start = std::chrono::steady_clock::now();
+      if (!loader.load(path, &model, &err, &warn)) {
+        std::cout << "load failed: " << err << std::endl;
+        return 1;
+      }
+      best = std::min(best, std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+    }
+    if (threads == 0) {
+      baseline = best;
+    }
+    std::cout << (threads == 0 ? std::string("inline")
+                               : std::to_string(threads))
+              << "\t" << best << "\t"
+              << baseline / best << std::endl;
+  }
+  return 0;
+}
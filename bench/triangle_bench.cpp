@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Renders a glTF offscreen while orbiting the camera like the Android
+// example and reports load time, CPU frame time percentiles and draw calls.
+// Without a path it writes a grid of cubes sharing one mesh and loads that.
+// The readback mode reads every frame back with a blocking glReadPixels
+// (sync), through the engine's pack buffer ring (async) or saves it as PNG.
+// With a trace path the run is also written as a Chrome trace.
+// Usage: triangle_bench [path|-] [frames] [width] [height] [radius]
+//                       [none|sync|async|save] [trace.json]
+
+#include "CubeGrid.h"
+#include "HeadlessContext.h"
+#include <Engine.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double percentile(const std::vector<double> &sorted, double p) {
+  return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto frames = argc > 2 ? std::atoi(argv[2]) : 300;
+  unsigned int width = argc > 3 ? std::atoi(argv[3]) : 1280;
+  unsigned int height = argc > 4 ? std::atoi(argv[4]) : 720;
+  auto radius = argc > 5 ? float(std::atof(argv[5])) : 5.0f;
+  std::string readback = argc > 6 ? argv[6] : "none";
+  std::string tracePath = argc > 7 ? argv[7] : "";
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeCubeGrid(20, "triangle_bench.glb");
+
+  HeadlessContext context(width, height);
+  if (!context.isValid()) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path << std::endl;
+
+  Engine engine(width, height);
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 0.0f, radius), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 70.0f, float(width) / height, 1.0f,
+      radius * 2.0f);
+  engine.setDefaultCamera(camera);
+
+  if (!tracePath.empty() && !engine.startTrace(tracePath)) {
+    std::cout << "Tracing unavailable: " << tracePath << std::endl;
+  }
+  auto loadStart = std::chrono::steady_clock::now();
+  engine.loadGLTF(path);
+  engine.drawFrame();
+  glFinish();
+  auto loadTime = millisecondsSince(loadStart);
+  auto loads = engine.getFrameStats().completedLoads;
+
+  std::vector<double> cpuTimes, frameTimes, gpuTimes;
+  std::vector<ProfileTiming> scopeTimes;
+  uint64_t triangles = 0, lastGpuFrame = 0;
+  uint64_t draws = 0, instances = 0, stateChanges = 0, visible = 0;
+  uint64_t readbacks = 0;
+  std::vector<unsigned char> pixels(width * height * 4);
+  std::vector<std::future<bool>> saves;
+  for (auto frame = 0; frame < frames; ++frame) {
+    // One full orbit over the run, stepped per frame so runs are repeatable.
+    auto theta = -2.0f * float(M_PI) * frame / frames;
+    camera->setPosition(
+        glm::vec3(radius * std::cos(theta), 0.0f, radius * std::sin(theta)));
+    auto frameStart = std::chrono::steady_clock::now();
+    engine.drawFrame();
+    cpuTimes.push_back(millisecondsSince(frameStart));
+    if (readback == "sync") {
+      glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                   pixels.data());
+      ++readbacks;
+    } else if (readback == "async") {
+      engine.readbackFrameAsync(
+          [&readbacks](const ReadbackFrame &frame) { ++readbacks; });
+    } else if (readback == "save") {
+      char name[32];
+      snprintf(name, sizeof(name), "triangle_bench_%04d.png", frame);
+      saves.push_back(engine.saveFrameAsync(name));
+    }
+    glFinish();
+    frameTimes.push_back(millisecondsSince(frameStart));
+    draws += engine.getRenderQueueStats().draws;
+    instances += engine.getRenderQueueStats().instances;
+    stateChanges += engine.getRenderQueueStats().stateChanges;
+    visible += engine.getCullStats().visible;
+    const auto &stats = engine.getFrameStats();
+    triangles += stats.triangles;
+    if (stats.gpuMilliseconds >= 0.0 && stats.gpuFrameIndex != lastGpuFrame) {
+      gpuTimes.push_back(stats.gpuMilliseconds);
+      lastGpuFrame = stats.gpuFrameIndex;
+    }
+    for (auto &timing : stats.cpuTimings) {
+      auto iterator = std::find_if(
+          scopeTimes.begin(), scopeTimes.end(), [&](const ProfileTiming &t) {
+            return std::strcmp(t.name, timing.name) == 0;
+          });
+      if (iterator == scopeTimes.end()) {
+        scopeTimes.push_back(timing);
+      } else {
+        iterator->milliseconds += timing.milliseconds;
+      }
+    }
+  }
+  engine.stopTrace();
+  engine.finishReadbacks();
+  for (auto &save : saves) {
+    readbacks += save.get();
+  }
+  if (frames <= 0) {
+    std::cout << "load: " << loadTime << " ms" << std::endl;
+    return 0;
+  }
+  std::sort(cpuTimes.begin(), cpuTimes.end());
+  std::sort(frameTimes.begin(), frameTimes.end());
+  std::cout << "load: " << loadTime << " ms (including first frame)"
+            << std::endl;
+  for (auto &load : loads) {
+    std::cout << "  parse " << load.parseMilliseconds << " decode "
+              << load.decodeMilliseconds << " collision "
+              << load.collisionMilliseconds << " optimize "
+              << load.optimizeMilliseconds << " upload "
+              << load.uploadMilliseconds << " build "
+              << load.buildMilliseconds << " total " << load.totalMilliseconds
+              << " ms" << std::endl;
+  }
+  std::cout << "frames: " << frames << " at " << width << "x" << height
+            << std::endl;
+  std::cout << "cpu ms: p50 " << percentile(cpuTimes, 0.5) << " p90 "
+            << percentile(cpuTimes, 0.9) << " p99 "
+            << percentile(cpuTimes, 0.99) << " max " << cpuTimes.back()
+            << std::endl;
+  std::cout << "frame ms (after glFinish): p50 " << percentile(frameTimes, 0.5)
+            << " p90 " << percentile(frameTimes, 0.9) << " p99 "
+            << percentile(frameTimes, 0.99) << " max " << frameTimes.back()
+            << std::endl;
+  if (!gpuTimes.empty()) {
+    std::sort(gpuTimes.begin(), gpuTimes.end());
+    std::cout << "gpu ms (" << gpuTimes.size() << " timed): p50 "
+              << percentile(gpuTimes, 0.5) << " p90 "
+              << percentile(gpuTimes, 0.9) << " max " << gpuTimes.back()
+              << std::endl;
+  }
+  if (!scopeTimes.empty()) {
+    std::cout << "cpu scopes (mean ms):";
+    for (auto &timing : scopeTimes) {
+      std::cout << " " << timing.name << " " << timing.milliseconds / frames;
+    }
+    std::cout << std::endl;
+  }
+  const auto &stats = engine.getFrameStats();
+  std::cout << "resident: buffers " << stats.residentBufferBytes
+            << " bytes, textures " << stats.residentTextureBytes << " bytes"
+            << std::endl;
+  std::cout << "per frame: draws " << double(draws) / frames << " instances "
+            << double(instances) / frames << " triangles "
+            << double(triangles) / frames << " state changes "
+            << double(stateChanges) / frames << " visible primitives "
+            << double(visible) / frames << std::endl;
+  if (readback != "none") {
+    std::cout << "readback: " << readback << ", " << readbacks
+              << " frames delivered" << std::endl;
+  }
+  return 0;
+}
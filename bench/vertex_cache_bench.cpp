@@ -0,0 +1,204 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the import-time geometry optimization. For every indexed triangle
+// list it reports the ACMR of 16 and 32 entry FIFO caches as authored and
+// after the vertex cache and overdraw passes, and the time optimizeGeometry
+// takes. Then renders an orbit with the asset loaded as authored, optimized,
+// and optimized but read back from the geometry cache, one engine each with
+// the frames interleaved, and reports drawFrame + glFinish p50 per engine
+// and whether the first frames match.
+// Without a path the asset is a UV sphere whose triangles and vertices are
+// shuffled, like an exporter writing faces in arbitrary order.
+// Usage: vertex_cache_bench [path|-] [frames] [size] [segments]
+
+#include "HeadlessContext.h"
+#include "UVSphere.h"
+#include <Engine.h>
+#include <GeometryOptimizer.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <tiny_gltf.h>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static void reportACMR(const std::string &path) {
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string error, warning;
+  auto binary =
+      path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+  if (!(binary ? loader.LoadBinaryFromFile(&model, &error, &warning, path)
+               : loader.LoadASCIIFromFile(&model, &error, &warning, path))) {
+    std::cout << "Failed to load " << path << ": " << error << std::endl;
+    return;
+  }
+  double triangles = 0.0, before16 = 0.0, before32 = 0.0, after16 = 0.0,
+         after32 = 0.0, milliseconds = 0.0;
+  for (auto &mesh : model.meshes) {
+    for (auto &primitive : mesh.primitives) {
+      auto position = primitive.attributes.find("POSITION");
+      if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 ||
+          position == primitive.attributes.end()) {
+        continue;
+      }
+      const auto &positionAccessor = model.accessors[position->second];
+      const auto &positionView =
+          model.bufferViews[positionAccessor.bufferView];
+      if (positionAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+          positionAccessor.type != TINYGLTF_TYPE_VEC3) {
+        continue;
+      }
+      std::vector<glm::vec3> positions(positionAccessor.count);
+      const auto *positionData =
+          model.buffers[positionView.buffer].data.data() +
+          positionView.byteOffset + positionAccessor.byteOffset;
+      auto stride = positionAccessor.ByteStride(positionView);
+      for (auto i = 0; i < positions.size(); ++i) {
+        float values[3];
+        memcpy(values, positionData + i * stride, sizeof(values));
+        positions[i] = glm::make_vec3(values);
+      }
+      const auto &indexAccessor = model.accessors[primitive.indices];
+      const auto &indexView = model.bufferViews[indexAccessor.bufferView];
+      const auto *indexData = model.buffers[indexView.buffer].data.data() +
+                              indexView.byteOffset + indexAccessor.byteOffset;
+      std::vector<uint32_t> indices(indexAccessor.count);
+      for (auto i = 0; i < indices.size(); ++i) {
+        auto componentSize =
+            tinygltf::GetComponentSizeInBytes(indexAccessor.componentType);
+        indices[i] = componentSize == 1   ? indexData[i]
+                     : componentSize == 2 ? ((const uint16_t *)indexData)[i]
+                                          : ((const uint32_t *)indexData)[i];
+      }
+      auto count = indices.size() / 3;
+      triangles += count;
+      before16 += computeACMR(indices, positions.size(), 16) * count;
+      before32 += computeACMR(indices, positions.size(), 32) * count;
+      auto optimizeStart = std::chrono::steady_clock::now();
+      optimizeGeometry(indices, positions,
+                       {{0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                         (const unsigned char *)positions.data(),
+                         sizeof(glm::vec3)}});
+      milliseconds += millisecondsSince(optimizeStart);
+      optimizeVertexCache(indices, positions.size());
+      optimizeOverdraw(indices, positions);
+      after16 += computeACMR(indices, positions.size(), 16) * count;
+      after32 += computeACMR(indices, positions.size(), 32) * count;
+    }
+  }
+  if (triangles == 0.0) {
+    std::cout << "no indexed triangle lists with float positions"
+              << std::endl;
+    return;
+  }
+  std::cout << "triangles: " << triangles << std::endl;
+  std::cout << "ACMR fifo16 " << before16 / triangles << " -> "
+            << after16 / triangles << ", fifo32 " << before32 / triangles
+            << " -> " << after32 / triangles << std::endl;
+  std::cout << "optimizeGeometry: " << milliseconds << " ms" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  auto frames = argc > 2 ? std::atoi(argv[2]) : 60;
+  unsigned int size = argc > 3 ? std::atoi(argv[3]) : 256;
+  auto segments = argc > 4 ? std::atoi(argv[4]) : 512;
+  auto path = argc > 1 && std::strcmp(argv[1], "-") != 0
+                  ? std::string(argv[1])
+                  : writeUVSphere(segments, "vertex_cache_bench.glb", true);
+  const std::string cacheDirectory = "vertex_cache_bench.cache";
+  mkdir(cacheDirectory.c_str(), 0755);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames <= 0) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "asset: " << path << std::endl;
+  reportACMR(path);
+
+  const auto radius = 3.0f;
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 0.0f, radius), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, radius * 2.0f);
+  const char *names[] = {"authored", "optimized", "cached"};
+  std::vector<std::shared_ptr<Engine>> engines;
+  for (auto i = 0; i < 3; ++i) {
+    engines.push_back(std::make_shared<Engine>(size, size));
+    engines[i]->setDefaultCamera(camera);
+    engines[i]->setGeometryOptimization(i > 0, i == 2 ? cacheDirectory : "");
+    // The cached engine loads twice so that the second load reads the entry
+    // the first one wrote.
+    if (i == 2) {
+      engines[i]->unloadGLTF(engines[i]->loadGLTF(path));
+      engines[i]->drawFrame();
+    }
+    auto loadStart = std::chrono::steady_clock::now();
+    engines[i]->loadGLTF(path);
+    engines[i]->drawFrame();
+    glFinish();
+    auto loadTime = millisecondsSince(loadStart);
+    const auto &loads = engines[i]->getFrameStats().completedLoads;
+    std::cout << names[i] << " load: " << loadTime << " ms, optimize "
+              << (loads.empty() ? 0.0 : loads[0].optimizeMilliseconds)
+              << " ms" << std::endl;
+  }
+
+  std::vector<unsigned char> pixels[3];
+  std::vector<double> frameTimes[3];
+  for (auto frame = 0; frame < frames * 3; ++frame) {
+    auto engine = frame % 3;
+    auto theta = -2.0f * float(M_PI) * (frame / 3) / frames;
+    camera->setPosition(
+        glm::vec3(radius * std::cos(theta), 0.0f, radius * std::sin(theta)));
+    auto frameStart = std::chrono::steady_clock::now();
+    engines[engine]->drawFrame();
+    glFinish();
+    frameTimes[engine].push_back(millisecondsSince(frameStart));
+    if (frame < 3) {
+      pixels[engine].resize(size * size * 4);
+      glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                   pixels[engine].data());
+    }
+  }
+  for (auto i = 0; i < 3; ++i) {
+    std::sort(frameTimes[i].begin(), frameTimes[i].end());
+    auto differing = 0;
+    for (auto p = 0; p < pixels[i].size(); p += 4) {
+      differing += memcmp(&pixels[i][p], &pixels[0][p], 4) != 0;
+    }
+    std::cout << names[i] << ": frame ms p50 " << frameTimes[i][frames / 2]
+              << ", first frame pixels differing from authored " << differing
+              << std::endl;
+  }
+  return 0;
+}
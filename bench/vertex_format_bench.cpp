@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares vertex formats of the same sphere: float attributes as authored,
+// the same quantized at import time, and a KHR_mesh_quantization copy as
+// authored and through the geometry optimization. Reports the vertex bytes
+// each keeps on the GPU, drawFrame + glFinish p50 over an orbit with the
+// engines' frames interleaved, how many pixels of the first frame differ
+// from the float one and the distance a ray from the camera hits at.
+// Usage: vertex_format_bench [frames] [size] [segments]
+
+#include "HeadlessContext.h"
+#include "UVSphere.h"
+#include <Engine.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace triangle;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  auto frames = argc > 1 ? std::atoi(argv[1]) : 60;
+  unsigned int size = argc > 2 ? std::atoi(argv[2]) : 256;
+  auto segments = argc > 3 ? std::atoi(argv[3]) : 512;
+  auto floatPath = writeUVSphere(segments, "vertex_format_bench.glb");
+  auto quantizedPath = writeUVSphere(
+      segments, "vertex_format_bench_quantized.glb", false, true);
+
+  HeadlessContext context(size, size);
+  if (!context.isValid() || frames <= 0) {
+    std::cout << "Failed to create a headless GLES3 context" << std::endl;
+    return 1;
+  }
+  context.bind();
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+  const auto radius = 3.0f;
+  auto camera = std::make_shared<Camera>(
+      glm::vec3(0.0f, 0.0f, radius), glm::vec3(0.0f, 0.0f, 0.0f),
+      glm::vec3(0.0f, 1.0f, 0.0f), 60.0f, 1.0f, 0.5f, radius * 2.0f);
+  struct Configuration {
+    const char *name;
+    std::string path;
+    bool quantize;
+    bool optimize;
+  };
+  const Configuration configurations[] = {
+      {"float", floatPath, false, false},
+      {"quantized on import", floatPath, true, false},
+      {"KHR_mesh_quantization", quantizedPath, false, false},
+      {"KHR_mesh_quantization optimized", quantizedPath, false, true}};
+  const auto count = sizeof(configurations) / sizeof(configurations[0]);
+  std::vector<std::shared_ptr<Engine>> engines;
+  for (auto &configuration : configurations) {
+    engines.push_back(std::make_shared<Engine>(size, size));
+    engines.back()->setDefaultCamera(camera);
+    engines.back()->setVertexQuantization(configuration.quantize);
+    engines.back()->setGeometryOptimization(configuration.optimize);
+    engines.back()->loadGLTF(configuration.path);
+    engines.back()->drawFrame();
+  }
+
+  std::vector<unsigned char> pixels[count];
+  std::vector<double> frameTimes[count];
+  for (auto frame = 0; frame < frames * count; ++frame) {
+    auto engine = frame % count;
+    auto theta = -2.0f * float(M_PI) * (frame / count) / frames;
+    camera->setPosition(
+        glm::vec3(radius * std::cos(theta), 0.0f, radius * std::sin(theta)));
+    auto frameStart = std::chrono::steady_clock::now();
+    engines[engine]->drawFrame();
+    glFinish();
+    frameTimes[engine].push_back(millisecondsSince(frameStart));
+    if (frame < count) {
+      pixels[engine].resize(size * size * 4);
+      glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                   pixels[engine].data());
+    }
+  }
+  for (auto i = 0; i < count; ++i) {
+    const auto &stats = engines[i]->getGeometryStats();
+    std::sort(frameTimes[i].begin(), frameTimes[i].end());
+    auto differing = 0;
+    for (auto p = 0; p < pixels[i].size(); p += 4) {
+      differing += memcmp(&pixels[i][p], &pixels[0][p], 4) != 0;
+    }
+    auto hit = engines[i]->raycast(glm::vec3(0.0f, 0.0f, radius),
+                                   glm::vec3(0.0f, 0.0f, -1.0f));
+    std::cout << configurations[i].name << ": vertex bytes "
+              << stats.vertices.usedBytes << ", index bytes "
+              << stats.indices.usedBytes << ", frame ms p50 "
+              << frameTimes[i][frames / 2] << ", pixels differing "
+              << differing << ", ray hit at "
+              << (hit.node != nullptr ? hit.distance : -1.0f) << std::endl;
+  }
+  return 0;
+}
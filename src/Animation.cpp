@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Animation.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace triangle {
+
+Animation::Animation(std::string name, std::vector<AnimationSampler> samplers,
+                     std::vector<AnimationChannel> channels,
+                     std::vector<int> targetNodes)
+    : name_(std::move(name)), samplers_(std::move(samplers)),
+      channels_(std::move(channels)), targetNodes_(std::move(targetNodes)) {
+  for (auto &sampler : samplers_) {
+    if (!sampler.times.empty()) {
+      duration_ = std::max(duration_, sampler.times.back());
+    }
+  }
+}
+
+const std::string &Animation::getName() const { return name_; }
+
+float Animation::getDuration() const { return duration_; }
+
+const std::vector<int> &Animation::getTargetNodes() const {
+  return targetNodes_;
+}
+
+unsigned int Animation::getSamplerCount() const { return samplers_.size(); }
+
+// Overwrites the animated parts of the poses, indexed like the target nodes.
+// cursors keeps the key each sampler was last at, one per sampler.
+void Animation::sample(float time, std::vector<NodePose> &poses,
+                       std::vector<unsigned int> &cursors) const {
+  cursors.resize(samplers_.size(), 0);
+  for (auto &channel : channels_) {
+    const auto rotation = channel.path == AnimationPath::ROTATION;
+    const auto value = sample(samplers_[channel.sampler], time,
+                              cursors[channel.sampler], rotation);
+    auto &pose = poses[channel.target];
+    switch (channel.path) {
+    case AnimationPath::TRANSLATION:
+      pose.translation = glm::vec3(value);
+      break;
+    case AnimationPath::ROTATION:
+      pose.rotation = glm::quat(value.w, value.x, value.y, value.z);
+      break;
+    case AnimationPath::SCALE:
+      pose.scale = glm::vec3(value);
+      break;
+    }
+  }
+}
+
+static glm::vec4 slerp(const glm::vec4 &a, glm::vec4 b, float t) {
+  auto cosine = glm::dot(a, b);
+  if (cosine < 0.0f) {
+    b = -b;
+    cosine = -cosine;
+  }
+  if (cosine > 0.9995f) {
+    return glm::normalize(glm::mix(a, b, t));
+  }
+  const auto angle = std::acos(cosine);
+  return (std::sin((1.0f - t) * angle) * a + std::sin(t * angle) * b) /
+         std::sin(angle);
+}
+
+// Times outside the keys clamp to the first or last value. The cursor is
+// tried before searching, playback mostly stays on a key or moves to the
+// next.
+glm::vec4 Animation::sample(const AnimationSampler &sampler, float time,
+                            unsigned int &cursor, bool rotation) const {
+  const auto &times = sampler.times;
+  const auto cubic = sampler.interpolation == Interpolation::CUBICSPLINE;
+  auto value = [&](unsigned int key) {
+    return sampler.values[cubic ? key * 3 + 1 : key];
+  };
+  if (times.size() == 1 || time <= times.front()) {
+    return value(0);
+  }
+  if (time >= times.back()) {
+    return value(times.size() - 1);
+  }
+  if (cursor + 1 >= times.size() || times[cursor] > time ||
+      times[cursor + 1] <= time) {
+    if (cursor + 2 < times.size() && times[cursor] <= time &&
+        times[cursor + 2] > time) {
+      ++cursor;
+    } else {
+      cursor = std::upper_bound(times.begin(), times.end(), time) -
+               times.begin() - 1;
+    }
+  }
+  const auto key = cursor;
+  if (sampler.interpolation == Interpolation::STEP) {
+    return value(key);
+  }
+  const auto delta = times[key + 1] - times[key];
+  const auto t = (time - times[key]) / delta;
+  if (!cubic) {
+    return rotation ? slerp(value(key), value(key + 1), t)
+                    : glm::mix(value(key), value(key + 1), t);
+  }
+  const auto t2 = t * t, t3 = t2 * t;
+  const auto result =
+      (2.0f * t3 - 3.0f * t2 + 1.0f) * value(key) +
+      (t3 - 2.0f * t2 + t) * delta * sampler.values[key * 3 + 2] +
+      (-2.0f * t3 + 3.0f * t2) * value(key + 1) +
+      (t3 - t2) * delta * sampler.values[(key + 1) * 3];
+  return rotation ? glm::normalize(result) : result;
+}
+
+} // namespace triangle
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+
+namespace triangle {
+
+enum class Interpolation { LINEAR, STEP, CUBICSPLINE };
+
+enum class AnimationPath { TRANSLATION, ROTATION, SCALE };
+
+// Keyframe times in seconds and their values, rotations as x, y, z, w.
+// CUBICSPLINE keys hold an in-tangent, the value and an out-tangent each.
+struct AnimationSampler {
+  Interpolation interpolation = Interpolation::LINEAR;
+  std::vector<float> times;
+  std::vector<glm::vec4> values;
+};
+
+// target indexes the animation's target nodes.
+struct AnimationChannel {
+  unsigned int sampler;
+  unsigned int target;
+  AnimationPath path;
+};
+
+struct NodePose {
+  glm::vec3 translation{0.0f};
+  glm::quat rotation;
+  glm::vec3 scale{1.0f};
+};
+
+// The sampled data of one glTF animation. Each target node is listed once,
+// by glTF node index, however many channels drive it. Immutable once built,
+// so instances playing it can sample it from any thread.
+class Animation {
+
+public:
+  Animation(std::string name, std::vector<AnimationSampler> samplers,
+            std::vector<AnimationChannel> channels,
+            std::vector<int> targetNodes);
+  const std::string &getName() const;
+  float getDuration() const;
+  const std::vector<int> &getTargetNodes() const;
+  unsigned int getSamplerCount() const;
+  void sample(float time, std::vector<NodePose> &poses,
+              std::vector<unsigned int> &cursors) const;
+
+private:
+  glm::vec4 sample(const AnimationSampler &sampler, float time,
+                   unsigned int &cursor, bool rotation) const;
+  std::string name_;
+  std::vector<AnimationSampler> samplers_;
+  std::vector<AnimationChannel> channels_;
+  std::vector<int> targetNodes_;
+  float duration_ = 0.0f;
+};
+
+} // namespace triangle
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AnimationInstance.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace triangle {
+
+// targets holds the transform store index of each of the animation's target
+// nodes, -1 for nodes that are in no scene.
+AnimationInstance::AnimationInstance(
+    std::shared_ptr<const Animation> animation, std::vector<int> targets,
+    std::vector<NodePose> restPoses)
+    : animation_(std::move(animation)), targets_(std::move(targets)),
+      restPoses_(std::move(restPoses)),
+      matrices_(targets_.size(), glm::mat4(1.0f)) {}
+
+const std::shared_ptr<const Animation> &
+AnimationInstance::getAnimation() const {
+  return animation_;
+}
+
+// Restarts from the first key. Negative speeds play backwards from the end.
+void AnimationInstance::play(float speed, bool loop) {
+  speed_ = speed;
+  loop_ = loop;
+  time_ = speed < 0.0f ? animation_->getDuration() : 0.0f;
+  changed_ = true;
+}
+
+// Looping wraps the time into the animation, otherwise it stops at either
+// end and later calls leave the pose alone.
+void AnimationInstance::advance(float seconds) {
+  const auto duration = animation_->getDuration();
+  auto time = time_ + seconds * speed_;
+  if (loop_ && duration > 0.0f) {
+    time = std::fmod(time, duration);
+    if (time < 0.0f) {
+      time += duration;
+    }
+  } else {
+    time = std::min(std::max(time, 0.0f), duration);
+  }
+  changed_ |= time != time_;
+  time_ = time;
+}
+
+void AnimationInstance::evaluate() {
+  if (!changed_) {
+    return;
+  }
+  poses_ = restPoses_;
+  animation_->sample(time_, poses_, cursors_);
+  for (auto i = 0; i < poses_.size(); ++i) {
+    const auto &pose = poses_[i];
+    auto &matrix = matrices_[i];
+    matrix = glm::mat4_cast(pose.rotation);
+    matrix[0] *= pose.scale.x;
+    matrix[1] *= pose.scale.y;
+    matrix[2] *= pose.scale.z;
+    matrix[3] = glm::vec4(pose.translation, 1.0f);
+  }
+  changed_ = false;
+  evaluated_ = true;
+}
+
+void AnimationInstance::apply(TransformStore &transformStore) {
+  if (!evaluated_) {
+    return;
+  }
+  for (auto i = 0; i < targets_.size(); ++i) {
+    if (targets_[i] >= 0) {
+      transformStore.setLocalMatrix(targets_[i], matrices_[i]);
+    }
+  }
+  evaluated_ = false;
+}
+
+} // namespace triangle
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Animation.h"
+#include "TransformStore.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace triangle {
+
+// One playback of an Animation on the nodes of one loaded asset. Poses start
+// from the nodes' rest transforms, so parts a channel does not drive keep
+// their loaded value. evaluate() only touches the instance itself and may run
+// on any thread, apply() writes the results into the transform store.
+class AnimationInstance {
+
+public:
+  AnimationInstance(std::shared_ptr<const Animation> animation,
+                    std::vector<int> targets, std::vector<NodePose> restPoses);
+  const std::shared_ptr<const Animation> &getAnimation() const;
+  void play(float speed, bool loop);
+  void advance(float seconds);
+  void evaluate();
+  void apply(TransformStore &transformStore);
+
+private:
+  std::shared_ptr<const Animation> animation_;
+  std::vector<int> targets_;
+  std::vector<NodePose> restPoses_;
+  std::vector<NodePose> poses_;
+  std::vector<unsigned int> cursors_;
+  std::vector<glm::mat4> matrices_;
+  float time_ = 0.0f;
+  float speed_ = 1.0f;
+  bool loop_ = true;
+  bool changed_ = true;
+  bool evaluated_ = false;
+};
+
+} // namespace triangle
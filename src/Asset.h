@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Animation.h"
+#include "AnimationInstance.h"
+#include "GLTFLoader.h"
+#include "GeometryArena.h"
+#include "GeometryOptimizer.h"
+#include "JobSystem.h"
+#include "LoadHandle.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include <GLES3/gl3.h>
+#include <future>
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tiny_gltf.h>
+#include <utility>
+#include <vector>
+
+namespace triangle {
+
+struct CollisionGeometry {
+  std::shared_ptr<std::vector<glm::vec3>> positions;
+  std::shared_ptr<std::vector<uint32_t>> indices;
+};
+
+// Bytes [begin, end) of a glTF buffer that the renderer reads through one
+// buffer view, or of the vertices or indices of an optimized geometry,
+// copied to offset in the asset's vertex or index allocation.
+struct GeometryRange {
+  int buffer;
+  size_t begin;
+  size_t end;
+  size_t offset;
+  bool indices;
+  int optimizedGeometry;
+};
+
+struct VertexAttributeBinding {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  GLsizei stride;
+  size_t offset;
+};
+
+// Vertex array state shared by the primitives that read the same accessors,
+// with offsets relative to the asset's allocations so that it can be
+// re-applied after the arenas compact.
+struct GeometryBinding {
+  GLuint vao = 0;
+  std::vector<VertexAttributeBinding> attributes;
+  bool indexed = false;
+};
+
+struct IndexBinding {
+  std::shared_ptr<Primitive> primitive;
+  size_t offset;
+  unsigned int lod;
+};
+
+struct LoadPhase {
+  const char *name;
+  ProfileClock::time_point start;
+  ProfileClock::time_point end;
+  std::thread::id thread;
+};
+
+// A glTF file on its way into the engine. The worker-side fields are filled
+// before parsed becomes ready, everything after that belongs to the GL thread.
+// Once built the asset stays around as the record of what unloading frees.
+struct Asset {
+  std::shared_ptr<LoadHandle> handle;
+  std::string path;
+  ProfileClock::time_point queued;
+  GLTFLoader loader;
+  tinygltf::Model model;
+  std::future<void> parsed;
+  bool parseSucceeded = false;
+  bool timeSliced = false;
+  std::string error;
+  std::vector<std::vector<CollisionGeometry>> collisionGeometries;
+  std::vector<std::shared_ptr<const Animation>> animations;
+  std::vector<std::vector<glm::mat4>> inverseBindMatrices;
+  std::vector<std::vector<float>> jointRadii;
+  std::shared_ptr<JobSystem> jobSystem;
+  size_t totalBytes = 0;
+  std::vector<LoadPhase> phases;
+  bool optimizeGeometry = false;
+  bool quantizeVertices = false;
+  bool generateLods = false;
+  std::string geometryCacheDirectory;
+  std::vector<std::vector<int>> primitiveGeometries;
+  std::vector<OptimizedGeometry> optimizedGeometries;
+  std::vector<int> optimizedRanges;
+  std::vector<GeometryRange> geometryRanges;
+  std::vector<int> vertexRanges;
+  std::vector<int> indexRanges;
+  size_t vertexBytes = 0;
+  size_t indexBytes = 0;
+  uint64_t geometryKey = 0;
+  bool sharedGeometry = false;
+  uint32_t vertexAllocation = GeometryArena::NO_ALLOCATION;
+  uint32_t indexAllocation = GeometryArena::NO_ALLOCATION;
+  std::map<std::vector<int>, GLuint> vertexArrays;
+  std::vector<GeometryBinding> geometryBindings;
+  std::vector<IndexBinding> indexBindings;
+  std::vector<uint64_t> textureKeys;
+  std::shared_ptr<std::vector<GLuint>> textures;
+  std::vector<std::shared_ptr<Scene>> scenes;
+  std::vector<glm::mat4> nodeMatrices;
+  std::vector<int> nodeTransforms;
+  std::vector<std::pair<std::shared_ptr<Node>, int>> skinnedNodes;
+  std::vector<std::shared_ptr<AnimationInstance>> animationInstances;
+  unsigned int uploadedRanges = 0;
+  size_t uploadedRangeBytes = 0;
+  unsigned int uploadedTextures = 0;
+  size_t uploadedBytes = 0;
+  double uploadMilliseconds = 0.0;
+  unsigned int uploadFrames = 0;
+};
+
+} // namespace triangle
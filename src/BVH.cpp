@@ -0,0 +1,279 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace triangle {
+
+static const int BIN_COUNT = 12;
+static const uint32_t MAX_LEAF_ITEMS = 4;
+static const float MIN_DIRECTION = 1e-30f;
+
+// Reciprocal of a ray direction that stays finite, so a slab the ray runs
+// along yields a huge distance with the right sign instead of 0 * inf = NaN.
+static glm::vec3 inverseOf(const glm::vec3 &direction) {
+  glm::vec3 inverse;
+  for (auto i = 0; i < 3; ++i) {
+    inverse[i] = 1.0f / (std::fabs(direction[i]) < MIN_DIRECTION
+                             ? std::copysign(MIN_DIRECTION, direction[i])
+                             : direction[i]);
+  }
+  return inverse;
+}
+
+static float surfaceArea(const glm::vec3 &min, const glm::vec3 &max) {
+  auto size = glm::max(max - min, glm::vec3(0.0f));
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void BVH::build(const std::vector<glm::vec3> &mins,
+                const std::vector<glm::vec3> &maxs) {
+  nodes_.clear();
+  items_.resize(mins.size());
+  centroids_.resize(mins.size());
+  for (uint32_t i = 0; i < mins.size(); ++i) {
+    items_[i] = i;
+    centroids_[i] = (mins[i] + maxs[i]) * 0.5f;
+  }
+  if (items_.empty()) {
+    return;
+  }
+  nodes_.reserve(items_.size() * 2);
+  nodes_.push_back({glm::vec3(0.0f), 0, glm::vec3(0.0f),
+                    uint32_t(items_.size())});
+  subdivide(0, mins, maxs);
+}
+
+void BVH::subdivide(uint32_t nodeIndex, const std::vector<glm::vec3> &mins,
+                    const std::vector<glm::vec3> &maxs) {
+  auto first = nodes_[nodeIndex].leftOrFirst;
+  auto count = nodes_[nodeIndex].count;
+  glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX);
+  glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+  for (auto i = first; i < first + count; ++i) {
+    nodeMin = glm::min(nodeMin, mins[items_[i]]);
+    nodeMax = glm::max(nodeMax, maxs[items_[i]]);
+    centroidMin = glm::min(centroidMin, centroids_[items_[i]]);
+    centroidMax = glm::max(centroidMax, centroids_[items_[i]]);
+  }
+  nodes_[nodeIndex].min = nodeMin;
+  nodes_[nodeIndex].max = nodeMax;
+  if (count <= MAX_LEAF_ITEMS) {
+    return;
+  }
+
+  auto bestAxis = -1;
+  auto bestSplit = 0;
+  auto bestCost = FLT_MAX;
+  for (auto axis = 0; axis < 3; ++axis) {
+    auto extent = centroidMax[axis] - centroidMin[axis];
+    if (extent <= 0.0f) {
+      continue;
+    }
+    glm::vec3 binMins[BIN_COUNT], binMaxs[BIN_COUNT];
+    uint32_t binCounts[BIN_COUNT] = {0};
+    std::fill(binMins, binMins + BIN_COUNT, glm::vec3(FLT_MAX));
+    std::fill(binMaxs, binMaxs + BIN_COUNT, glm::vec3(-FLT_MAX));
+    auto scale = BIN_COUNT / extent;
+    for (auto i = first; i < first + count; ++i) {
+      auto item = items_[i];
+      auto bin = std::min(
+          BIN_COUNT - 1,
+          int((centroids_[item][axis] - centroidMin[axis]) * scale));
+      ++binCounts[bin];
+      binMins[bin] = glm::min(binMins[bin], mins[item]);
+      binMaxs[bin] = glm::max(binMaxs[bin], maxs[item]);
+    }
+    float leftAreas[BIN_COUNT - 1];
+    uint32_t leftCounts[BIN_COUNT - 1];
+    glm::vec3 accumulatedMin(FLT_MAX), accumulatedMax(-FLT_MAX);
+    uint32_t accumulatedCount = 0;
+    for (auto i = 0; i < BIN_COUNT - 1; ++i) {
+      accumulatedCount += binCounts[i];
+      accumulatedMin = glm::min(accumulatedMin, binMins[i]);
+      accumulatedMax = glm::max(accumulatedMax, binMaxs[i]);
+      leftCounts[i] = accumulatedCount;
+      leftAreas[i] = surfaceArea(accumulatedMin, accumulatedMax);
+    }
+    accumulatedMin = glm::vec3(FLT_MAX);
+    accumulatedMax = glm::vec3(-FLT_MAX);
+    accumulatedCount = 0;
+    for (auto i = BIN_COUNT - 1; i > 0; --i) {
+      accumulatedCount += binCounts[i];
+      accumulatedMin = glm::min(accumulatedMin, binMins[i]);
+      accumulatedMax = glm::max(accumulatedMax, binMaxs[i]);
+      if (leftCounts[i - 1] == 0 || accumulatedCount == 0) {
+        continue;
+      }
+      auto cost =
+          leftCounts[i - 1] * leftAreas[i - 1] +
+          accumulatedCount * surfaceArea(accumulatedMin, accumulatedMax);
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = i;
+      }
+    }
+  }
+
+  uint32_t middle;
+  if (bestAxis >= 0) {
+    auto scale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    auto iterator = std::partition(
+        items_.begin() + first, items_.begin() + first + count,
+        [&](uint32_t item) {
+          auto bin = std::min(BIN_COUNT - 1,
+                              int((centroids_[item][bestAxis] -
+                                   centroidMin[bestAxis]) *
+                                  scale));
+          return bin < bestSplit;
+        });
+    middle = uint32_t(iterator - items_.begin());
+  } else {
+    middle = first + count / 2;
+  }
+
+  auto left = uint32_t(nodes_.size());
+  nodes_.push_back({glm::vec3(0.0f), first, glm::vec3(0.0f), middle - first});
+  nodes_.push_back(
+      {glm::vec3(0.0f), middle, glm::vec3(0.0f), first + count - middle});
+  nodes_[nodeIndex].leftOrFirst = left;
+  nodes_[nodeIndex].count = 0;
+  subdivide(left, mins, maxs);
+  subdivide(left + 1, mins, maxs);
+}
+
+void BVH::refit(const std::vector<glm::vec3> &mins,
+                const std::vector<glm::vec3> &maxs) {
+  for (auto i = int(nodes_.size()) - 1; i >= 0; --i) {
+    auto &node = nodes_[i];
+    if (node.count > 0) {
+      node.min = glm::vec3(FLT_MAX);
+      node.max = glm::vec3(-FLT_MAX);
+      for (auto j = node.leftOrFirst; j < node.leftOrFirst + node.count; ++j) {
+        node.min = glm::min(node.min, mins[items_[j]]);
+        node.max = glm::max(node.max, maxs[items_[j]]);
+      }
+    } else {
+      const auto &left = nodes_[node.leftOrFirst];
+      const auto &right = nodes_[node.leftOrFirst + 1];
+      node.min = glm::min(left.min, right.min);
+      node.max = glm::max(left.max, right.max);
+    }
+  }
+}
+
+void BVH::collect(uint32_t nodeIndex, std::vector<uint32_t> &visibleItems) {
+  const auto &node = nodes_[nodeIndex];
+  if (node.count > 0) {
+    visibleItems.insert(visibleItems.end(), items_.begin() + node.leftOrFirst,
+                        items_.begin() + node.leftOrFirst + node.count);
+  } else {
+    collect(node.leftOrFirst, visibleItems);
+    collect(node.leftOrFirst + 1, visibleItems);
+  }
+}
+
+void BVH::cull(Frustum &frustum, std::vector<uint32_t> &visibleItems) {
+  visibleItems.clear();
+  if (nodes_.empty()) {
+    return;
+  }
+  stack_.clear();
+  stack_.push_back(0);
+  while (!stack_.empty()) {
+    auto nodeIndex = stack_.back();
+    stack_.pop_back();
+    const auto &node = nodes_[nodeIndex];
+    auto containment = frustum.classify((node.min + node.max) * 0.5f,
+                                        (node.max - node.min) * 0.5f);
+    if (containment == Containment::OUTSIDE) {
+      continue;
+    }
+    if (containment == Containment::INSIDE) {
+      collect(nodeIndex, visibleItems);
+    } else if (node.count > 0) {
+      collect(nodeIndex, visibleItems);
+    } else {
+      stack_.push_back(node.leftOrFirst);
+      stack_.push_back(node.leftOrFirst + 1);
+    }
+  }
+}
+
+bool BVH::intersectBox(const glm::vec3 &origin,
+                       const glm::vec3 &inverseDirection, const glm::vec3 &min,
+                       const glm::vec3 &max, float maxDistance, float &entry) {
+  auto t0 = (min - origin) * inverseDirection;
+  auto t1 = (max - origin) * inverseDirection;
+  auto entries = glm::min(t0, t1);
+  auto exits = glm::max(t0, t1);
+  entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+  auto exit =
+      std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+  return entry <= exit;
+}
+
+bool BVH::raycast(
+    const glm::vec3 &origin, const glm::vec3 &direction, float &distance,
+    const std::function<bool(uint32_t item, float &distance)> &intersect) {
+  if (nodes_.empty()) {
+    return false;
+  }
+  auto inverseDirection = inverseOf(direction);
+  auto hit = false;
+  float entry;
+  stack_.clear();
+  stack_.push_back(0);
+  while (!stack_.empty()) {
+    const auto &node = nodes_[stack_.back()];
+    stack_.pop_back();
+    if (!intersectBox(origin, inverseDirection, node.min, node.max, distance,
+                      entry)) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+        hit |= intersect(items_[i], distance);
+      }
+      continue;
+    }
+    float leftEntry, rightEntry;
+    const auto &left = nodes_[node.leftOrFirst];
+    const auto &right = nodes_[node.leftOrFirst + 1];
+    auto hitLeft = intersectBox(origin, inverseDirection, left.min, left.max,
+                                distance, leftEntry);
+    auto hitRight = intersectBox(origin, inverseDirection, right.min,
+                                 right.max, distance, rightEntry);
+    if (hitLeft && hitRight) {
+      auto nearFirst = leftEntry <= rightEntry;
+      stack_.push_back(nearFirst ? node.leftOrFirst + 1 : node.leftOrFirst);
+      stack_.push_back(nearFirst ? node.leftOrFirst : node.leftOrFirst + 1);
+    } else if (hitLeft) {
+      stack_.push_back(node.leftOrFirst);
+    } else if (hitRight) {
+      stack_.push_back(node.leftOrFirst + 1);
+    }
+  }
+  return hit;
+}
+
+unsigned int BVH::getNodeCount() { return nodes_.size(); }
+
+} // namespace triangle
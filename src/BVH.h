@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Frustum.h"
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+struct BVHNode {
+  glm::vec3 min;
+  uint32_t leftOrFirst;
+  glm::vec3 max;
+  uint32_t count;
+};
+
+// Bounding volume hierarchy over a set of world-space boxes, built with a
+// binned SAH. Children are always stored after their parent, so refit is a
+// single reverse pass over the nodes.
+class BVH {
+
+public:
+  void build(const std::vector<glm::vec3> &mins,
+             const std::vector<glm::vec3> &maxs);
+  void refit(const std::vector<glm::vec3> &mins,
+             const std::vector<glm::vec3> &maxs);
+  void cull(Frustum &frustum, std::vector<uint32_t> &visibleItems);
+  bool raycast(
+      const glm::vec3 &origin, const glm::vec3 &direction, float &distance,
+      const std::function<bool(uint32_t item, float &distance)> &intersect);
+  unsigned int getNodeCount();
+
+private:
+  void subdivide(uint32_t nodeIndex, const std::vector<glm::vec3> &mins,
+                 const std::vector<glm::vec3> &maxs);
+  void collect(uint32_t nodeIndex, std::vector<uint32_t> &visibleItems);
+  static bool intersectBox(const glm::vec3 &origin,
+                           const glm::vec3 &inverseDirection,
+                           const glm::vec3 &min, const glm::vec3 &max,
+                           float maxDistance, float &entry);
+  std::vector<BVHNode> nodes_;
+  std::vector<uint32_t> items_;
+  std::vector<glm::vec3> centroids_;
+  std::vector<uint32_t> stack_;
+};
+
+} // namespace triangle
@@ -23,16 +23,31 @@ Camera::Camera(glm::vec3 position, glm::vec3 lookAt, glm::vec3 up, float fov,
     : position_(position), lookAt_(lookAt), up_(up), fov_(fov),
       aspectRatio_(aspectRatio), nearPlane_(nearPlane), farPlane_(farPlane) {}
 
+// Both matrices are rebuilt only after the camera changed.
 const glm::mat4 &Camera::getViewMatrix() {
-  viewMatrix_ = glm::lookAt(position_, lookAt_, up_);
+  if (viewDirty_) {
+    viewMatrix_ = glm::lookAt(position_, lookAt_, up_);
+    viewDirty_ = false;
+  }
   return viewMatrix_;
 }
 
 const glm::mat4 &Camera::getProjectMatrix() {
-  projectMatrix_ = glm::perspective(fov_, aspectRatio_, nearPlane_, farPlane_);
+  if (projectDirty_) {
+    projectMatrix_ =
+        glm::perspective(fov_, aspectRatio_, nearPlane_, farPlane_);
+    projectDirty_ = false;
+  }
   return projectMatrix_;
 }
 
-void Camera::setPosition(glm::vec3 position) { position_ = position; }
+void Camera::setPosition(glm::vec3 position) {
+  position_ = position;
+  viewDirty_ = true;
+}
+
+float Camera::getNearPlane() { return nearPlane_; }
+
+float Camera::getFarPlane() { return farPlane_; }
 
 } // namespace triangle
\ No newline at end of file
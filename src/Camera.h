@@ -29,6 +29,8 @@ public:
   const glm::mat4 &getViewMatrix();
   const glm::mat4 &getProjectMatrix();
   void setPosition(glm::vec3 position);
+  float getNearPlane();
+  float getFarPlane();
 
 private:
   glm::vec3 position_;
@@ -40,6 +42,8 @@ private:
   float farPlane_;
   glm::mat4 viewMatrix_{};
   glm::mat4 projectMatrix_{};
+  bool viewDirty_ = true;
+  bool projectDirty_ = true;
 };
 
 } // namespace triangle
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CommandBuffer.h"
+
+namespace triangle {
+
+// Keeps the capacity, so a buffer reused every frame stops allocating.
+void CommandBuffer::reset() {
+  commands_.clear();
+  views_.clear();
+  jointRows_.clear();
+  instanceMatrices_.clear();
+  instanceJointOffsets_.clear();
+}
+
+void CommandBuffer::clear(unsigned int width, unsigned int height) {
+  commands_.push_back({CommandType::CLEAR, width, height, 0, nullptr});
+}
+
+void CommandBuffer::beginView(unsigned int view) {
+  commands_.push_back({CommandType::BEGIN_VIEW, view, 0, 0, nullptr});
+}
+
+void CommandBuffer::bindJoints() {
+  commands_.push_back({CommandType::BIND_JOINTS, 0, 0, 0, nullptr});
+}
+
+void CommandBuffer::useProgram(GLuint program) {
+  commands_.push_back({CommandType::USE_PROGRAM, program, 0, 0, nullptr});
+}
+
+void CommandBuffer::bindPrimitive(Primitive *primitive) {
+  commands_.push_back({CommandType::BIND_PRIMITIVE, 0, 0, 0, primitive});
+}
+
+void CommandBuffer::setInstances(unsigned int firstInstance) {
+  commands_.push_back(
+      {CommandType::SET_INSTANCES, firstInstance, 0, 0, nullptr});
+}
+
+void CommandBuffer::draw(Primitive *primitive, unsigned int instanceCount,
+                         unsigned int lod) {
+  commands_.push_back({CommandType::DRAW, 0, instanceCount, lod, primitive});
+}
+
+// Appends the commands of other only, its data stays behind.
+void CommandBuffer::append(const CommandBuffer &other) {
+  commands_.insert(commands_.end(), other.commands_.begin(),
+                   other.commands_.end());
+}
+
+void CommandBuffer::setViews(const std::vector<ViewUniforms> &views) {
+  views_ = views;
+}
+
+void CommandBuffer::setJointRows(const std::vector<glm::vec4> &jointRows) {
+  jointRows_ = jointRows;
+}
+
+std::vector<glm::mat4> &CommandBuffer::getInstanceMatrices() {
+  return instanceMatrices_;
+}
+
+std::vector<float> &CommandBuffer::getInstanceJointOffsets() {
+  return instanceJointOffsets_;
+}
+
+const std::vector<Command> &CommandBuffer::getCommands() const {
+  return commands_;
+}
+
+const std::vector<ViewUniforms> &CommandBuffer::getViews() const {
+  return views_;
+}
+
+const std::vector<glm::vec4> &CommandBuffer::getJointRows() const {
+  return jointRows_;
+}
+
+const std::vector<glm::mat4> &CommandBuffer::getInstanceMatrices() const {
+  return instanceMatrices_;
+}
+
+const std::vector<float> &CommandBuffer::getInstanceJointOffsets() const {
+  return instanceJointOffsets_;
+}
+
+} // namespace triangle
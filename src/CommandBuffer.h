@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameUniforms.h"
+#include "Primitive.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+enum class CommandType : uint8_t {
+  CLEAR,
+  BEGIN_VIEW,
+  BIND_JOINTS,
+  USE_PROGRAM,
+  BIND_PRIMITIVE,
+  SET_INSTANCES,
+  DRAW
+};
+
+// first is the program, view, first instance or viewport width, count the
+// instance count or viewport height.
+struct Command {
+  CommandType type;
+  unsigned int first;
+  unsigned int count;
+  unsigned int lod;
+  Primitive *primitive;
+};
+
+// The draws of a frame recorded without GL calls, on any thread, for
+// GLBackend to replay later on the thread that owns the context. The data
+// the commands read (camera uniforms, joint palette rows, instance matrices)
+// is copied in, so the scene may change before the replay.
+class CommandBuffer {
+
+public:
+  void reset();
+  void clear(unsigned int width, unsigned int height);
+  void beginView(unsigned int view);
+  void bindJoints();
+  void useProgram(GLuint program);
+  void bindPrimitive(Primitive *primitive);
+  void setInstances(unsigned int firstInstance);
+  void draw(Primitive *primitive, unsigned int instanceCount,
+            unsigned int lod);
+  void append(const CommandBuffer &other);
+  void setViews(const std::vector<ViewUniforms> &views);
+  void setJointRows(const std::vector<glm::vec4> &jointRows);
+  std::vector<glm::mat4> &getInstanceMatrices();
+  std::vector<float> &getInstanceJointOffsets();
+  const std::vector<Command> &getCommands() const;
+  const std::vector<ViewUniforms> &getViews() const;
+  const std::vector<glm::vec4> &getJointRows() const;
+  const std::vector<glm::mat4> &getInstanceMatrices() const;
+  const std::vector<float> &getInstanceJointOffsets() const;
+
+private:
+  std::vector<Command> commands_;
+  std::vector<ViewUniforms> views_;
+  std::vector<glm::vec4> jointRows_;
+  std::vector<glm::mat4> instanceMatrices_;
+  std::vector<float> instanceJointOffsets_;
+};
+
+} // namespace triangle
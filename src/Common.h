@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "GLDebug.h"
+#include <cassert>
 #include <iostream>
 #include <string>
 
@@ -23,37 +25,86 @@ namespace triangle {
 #define GL_CHECK(f)                                                            \
   f;                                                                           \
   {                                                                            \
-    auto error = glGetError();                                                 \
-    if (error != 0) {                                                          \
-      std::cout << "GL error = " << error << std::endl;                        \
+    if (::triangle::getGLErrorMode() == ::triangle::GLErrorMode::PER_CALL) {   \
+      ::triangle::checkGLError(#f, __FILE__, __LINE__);                        \
     }                                                                          \
-    assert(error == 0);                                                        \
   }
 
 const std::string VERTEX_SHADER =
     "#version 300 es\n"
-    "precision mediump float;\n"
+    "precision highp float;\n"
     "layout(location = 0) in vec4 a_position;\n"
     "layout(location = 1) in vec2 a_normal;\n"
     "layout(location = 2) in vec2 a_texCoord0;\n"
+    "layout(location = 3) in mat4 a_modelMatrix;\n"
     "out vec2 v_texCoord0;\n"
-    "uniform mat4 u_modelViewProjectMatrix;\n"
+    "#ifdef HAS_VERTEX_COLOR\n"
+    "layout(location = 7) in vec4 a_color0;\n"
+    "out vec4 v_color0;\n"
+    "#endif\n"
+    "#ifdef HAS_SKINNING\n"
+    "layout(location = 8) in vec4 a_joints0;\n"
+    "layout(location = 9) in vec4 a_weights0;\n"
+    "layout(location = 10) in float a_jointOffset;\n"
+    "uniform highp sampler2D u_jointPalette;\n"
+    "vec4 getJointRow(float joint, int row) {\n"
+    "    int index = int(a_jointOffset + joint);\n"
+    "    return texelFetch(u_jointPalette,\n"
+    "                      ivec2(index % 256 * 3 + row, index / 256), 0);\n"
+    "}\n"
+    "vec4 getSkinRow(int row) {\n"
+    "    return a_weights0.x * getJointRow(a_joints0.x, row) +\n"
+    "           a_weights0.y * getJointRow(a_joints0.y, row) +\n"
+    "           a_weights0.z * getJointRow(a_joints0.z, row) +\n"
+    "           a_weights0.w * getJointRow(a_joints0.w, row);\n"
+    "}\n"
+    "#endif\n"
+    "layout(std140) uniform FrameUniforms {\n"
+    "    mat4 u_viewProjectMatrix;\n"
+    "    mat4 u_viewMatrix;\n"
+    "    mat4 u_projectMatrix;\n"
+    "};\n"
     "void main() {\n"
-    "    gl_Position = u_modelViewProjectMatrix * a_position;\n"
+    "    vec4 position = a_position;\n"
+    "#ifdef HAS_SKINNING\n"
+    "    position = vec4(dot(getSkinRow(0), a_position),\n"
+    "                    dot(getSkinRow(1), a_position),\n"
+    "                    dot(getSkinRow(2), a_position), 1.0);\n"
+    "#endif\n"
+    "    gl_Position = u_viewProjectMatrix * a_modelMatrix * position;\n"
     "    v_texCoord0 = a_texCoord0;\n"
+    "#ifdef HAS_VERTEX_COLOR\n"
+    "    v_color0 = a_color0;\n"
+    "#endif\n"
     "}";
 
 const std::string FRAGMENT_SHADER =
     "#version 300 es\n"
     "precision mediump float;\n"
     "in vec2 v_texCoord0;\n"
+    "#ifdef HAS_VERTEX_COLOR\n"
+    "in vec4 v_color0;\n"
+    "#endif\n"
     "out vec4 outColor;\n"
     "uniform sampler2D u_baseColorTexture;\n"
     "void main() {\n"
     "    outColor = texture(u_baseColorTexture, v_texCoord0);\n"
+    "#ifdef HAS_VERTEX_COLOR\n"
+    "    outColor *= v_color0;\n"
+    "#endif\n"
     "}";
 
 #define UNIFORM_BASE_COLOR_TEXTURE "u_baseColorTexture"
-#define UNIFORM_MODEL_VIEW_PROJECT_MATRIX "u_modelViewProjectMatrix"
+#define UNIFORM_BLOCK_FRAME "FrameUniforms"
+#define FRAME_UNIFORM_BINDING 0
+#define ATTRIBUTE_MODEL_MATRIX 3
+#define ATTRIBUTE_COLOR_0 7
+#define ATTRIBUTE_JOINTS_0 8
+#define ATTRIBUTE_WEIGHTS_0 9
+#define ATTRIBUTE_JOINT_OFFSET 10
+#define UNIFORM_JOINT_PALETTE "u_jointPalette"
+#define JOINT_PALETTE_TEXTURE_UNIT 1
+// Joints per palette texture row, 256 in VERTEX_SHADER as well.
+#define JOINT_PALETTE_ROW_JOINTS 256
 
 } // namespace triangle
\ No newline at end of file
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ETC2.h"
+#include <algorithm>
+
+namespace triangle {
+
+static const int ETC_MODIFIERS[8][2] = {{2, 8},   {5, 17},  {9, 29},
+                                        {13, 42}, {18, 60}, {24, 80},
+                                        {33, 106}, {47, 183}};
+static const int ETC_DISTANCES[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+static const int EAC_MODIFIERS[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+static uint64_t readBlock(const unsigned char *data) {
+  uint64_t bits = 0;
+  for (auto i = 0; i < 8; ++i) {
+    bits = (bits << 8) | data[i];
+  }
+  return bits;
+}
+
+static int field(uint64_t bits, int high, int low) {
+  return int((bits >> low) & ((uint64_t(1) << (high - low + 1)) - 1));
+}
+
+static int clamp255(int value) { return std::min(255, std::max(0, value)); }
+
+static int signed3(int value) { return value >= 4 ? value - 8 : value; }
+
+static int extend4(int value) { return value * 17; }
+
+static int extend5(int value) { return (value << 3) | (value >> 2); }
+
+static int extend6(int value) { return (value << 2) | (value >> 4); }
+
+static int extend7(int value) { return (value << 1) | (value >> 6); }
+
+static void setTexel(unsigned char *texel, int r, int g, int b, int a) {
+  texel[0] = clamp255(r);
+  texel[1] = clamp255(g);
+  texel[2] = clamp255(b);
+  texel[3] = a;
+}
+
+// Decodes one 8 byte ETC2 colour block into 16 RGBA texels, row major.
+static void decodeColorBlock(const unsigned char *data, bool punchthrough,
+                             unsigned char *texels) {
+  auto bits = readBlock(data);
+  auto differential = (bits >> 33) & 1;
+  auto opaque = !punchthrough || differential;
+  auto pixelIndex = [&](int x, int y) {
+    auto i = x * 4 + y;
+    return int(((bits >> (16 + i)) & 1) << 1 | ((bits >> i) & 1));
+  };
+  if (punchthrough || differential) {
+    int r = field(bits, 63, 59), dr = field(bits, 58, 56);
+    int g = field(bits, 55, 51), dg = field(bits, 50, 48);
+    int b = field(bits, 47, 43), db = field(bits, 42, 40);
+    int r2 = r + signed3(dr), g2 = g + signed3(dg), b2 = b + signed3(db);
+    if (r2 < 0 || r2 > 31) {
+      // T mode.
+      int colors[2][3] = {
+          {extend4(field(bits, 60, 59) << 2 | field(bits, 57, 56)),
+           extend4(field(bits, 55, 52)), extend4(field(bits, 51, 48))},
+          {extend4(field(bits, 47, 44)), extend4(field(bits, 43, 40)),
+           extend4(field(bits, 39, 36))}};
+      auto distance =
+          ETC_DISTANCES[field(bits, 35, 34) << 1 | field(bits, 32, 32)];
+      int paint[4][3];
+      for (auto c = 0; c < 3; ++c) {
+        paint[0][c] = colors[0][c];
+        paint[1][c] = colors[1][c] + distance;
+        paint[2][c] = colors[1][c];
+        paint[3][c] = colors[1][c] - distance;
+      }
+      for (auto y = 0; y < 4; ++y) {
+        for (auto x = 0; x < 4; ++x) {
+          auto index = pixelIndex(x, y);
+          auto *texel = texels + (y * 4 + x) * 4;
+          if (!opaque && index == 2) {
+            setTexel(texel, 0, 0, 0, 0);
+          } else {
+            setTexel(texel, paint[index][0], paint[index][1], paint[index][2],
+                     255);
+          }
+        }
+      }
+      return;
+    }
+    if (g2 < 0 || g2 > 31) {
+      // H mode.
+      int r1 = field(bits, 62, 59);
+      int g1 = field(bits, 58, 56) << 1 | field(bits, 52, 52);
+      int b1 = field(bits, 51, 51) << 3 | field(bits, 49, 47);
+      int r2h = field(bits, 46, 43), g2h = field(bits, 42, 39),
+          b2h = field(bits, 38, 35);
+      auto order = (r1 << 8 | g1 << 4 | b1) >= (r2h << 8 | g2h << 4 | b2h);
+      auto distance = ETC_DISTANCES[field(bits, 34, 34) << 2 |
+                                    field(bits, 32, 32) << 1 | int(order)];
+      int colors[2][3] = {{extend4(r1), extend4(g1), extend4(b1)},
+                          {extend4(r2h), extend4(g2h), extend4(b2h)}};
+      int paint[4][3];
+      for (auto c = 0; c < 3; ++c) {
+        paint[0][c] = colors[0][c] + distance;
+        paint[1][c] = colors[0][c] - distance;
+        paint[2][c] = colors[1][c] + distance;
+        paint[3][c] = colors[1][c] - distance;
+      }
+      for (auto y = 0; y < 4; ++y) {
+        for (auto x = 0; x < 4; ++x) {
+          auto index = pixelIndex(x, y);
+          auto *texel = texels + (y * 4 + x) * 4;
+          if (!opaque && index == 2) {
+            setTexel(texel, 0, 0, 0, 0);
+          } else {
+            setTexel(texel, paint[index][0], paint[index][1], paint[index][2],
+                     255);
+          }
+        }
+      }
+      return;
+    }
+    if (b2 < 0 || b2 > 31) {
+      // Planar mode, always opaque.
+      int ro = extend6(field(bits, 62, 57));
+      int go = extend7(field(bits, 56, 56) << 6 | field(bits, 54, 49));
+      int bo = extend6(field(bits, 48, 48) << 5 | field(bits, 44, 43) << 3 |
+                       field(bits, 41, 39));
+      int rh = extend6(field(bits, 38, 34) << 1 | field(bits, 32, 32));
+      int gh = extend7(field(bits, 31, 25));
+      int bh = extend6(field(bits, 24, 19));
+      int rv = extend6(field(bits, 18, 13));
+      int gv = extend7(field(bits, 12, 6));
+      int bv = extend6(field(bits, 5, 0));
+      for (auto y = 0; y < 4; ++y) {
+        for (auto x = 0; x < 4; ++x) {
+          setTexel(texels + (y * 4 + x) * 4,
+                   (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                   (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                   (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2, 255);
+        }
+      }
+      return;
+    }
+    int colors[2][3] = {{extend5(r), extend5(g), extend5(b)},
+                        {extend5(r2), extend5(g2), extend5(b2)}};
+    int tables[2] = {field(bits, 39, 37), field(bits, 36, 34)};
+    auto flip = (bits >> 32) & 1;
+    for (auto y = 0; y < 4; ++y) {
+      for (auto x = 0; x < 4; ++x) {
+        auto subBlock = flip ? y >= 2 : x >= 2;
+        auto index = pixelIndex(x, y);
+        auto *texel = texels + (y * 4 + x) * 4;
+        const auto *modifiers = ETC_MODIFIERS[tables[subBlock]];
+        int modifier = index & 1 ? modifiers[1] : modifiers[0];
+        if (index & 2) {
+          modifier = -modifier;
+        }
+        if (!opaque) {
+          if (index == 2) {
+            setTexel(texel, 0, 0, 0, 0);
+            continue;
+          }
+          if (index == 0) {
+            modifier = 0;
+          }
+        }
+        setTexel(texel, colors[subBlock][0] + modifier,
+                 colors[subBlock][1] + modifier,
+                 colors[subBlock][2] + modifier, 255);
+      }
+    }
+    return;
+  }
+  // Individual mode.
+  int colors[2][3] = {
+      {extend4(field(bits, 63, 60)), extend4(field(bits, 55, 52)),
+       extend4(field(bits, 47, 44))},
+      {extend4(field(bits, 59, 56)), extend4(field(bits, 51, 48)),
+       extend4(field(bits, 43, 40))}};
+  int tables[2] = {field(bits, 39, 37), field(bits, 36, 34)};
+  auto flip = (bits >> 32) & 1;
+  for (auto y = 0; y < 4; ++y) {
+    for (auto x = 0; x < 4; ++x) {
+      auto subBlock = flip ? y >= 2 : x >= 2;
+      auto index = pixelIndex(x, y);
+      const auto *modifiers = ETC_MODIFIERS[tables[subBlock]];
+      int modifier = index & 1 ? modifiers[1] : modifiers[0];
+      if (index & 2) {
+        modifier = -modifier;
+      }
+      setTexel(texels + (y * 4 + x) * 4, colors[subBlock][0] + modifier,
+               colors[subBlock][1] + modifier, colors[subBlock][2] + modifier,
+               255);
+    }
+  }
+}
+
+// Decodes the 8 byte EAC alpha block in front of an RGBA8 ETC2 block.
+static void decodeAlphaBlock(const unsigned char *data,
+                             unsigned char *texels) {
+  auto bits = readBlock(data);
+  int base = field(bits, 63, 56);
+  int multiplier = field(bits, 55, 52);
+  const auto *modifiers = EAC_MODIFIERS[field(bits, 51, 48)];
+  for (auto y = 0; y < 4; ++y) {
+    for (auto x = 0; x < 4; ++x) {
+      auto i = x * 4 + y;
+      auto index = field(bits, 47 - i * 3, 45 - i * 3);
+      texels[(y * 4 + x) * 4 + 3] =
+          clamp255(base + modifiers[index] * multiplier);
+    }
+  }
+}
+
+bool decodeETC2(GLenum internalFormat, const unsigned char *data, size_t size,
+                uint32_t width, uint32_t height,
+                std::vector<unsigned char> &rgba) {
+  auto punchthrough =
+      internalFormat == GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 ||
+      internalFormat == GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+  auto alpha = internalFormat == GL_COMPRESSED_RGBA8_ETC2_EAC ||
+               internalFormat == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+  if (!punchthrough && !alpha && internalFormat != GL_COMPRESSED_RGB8_ETC2 &&
+      internalFormat != GL_COMPRESSED_SRGB8_ETC2) {
+    return false;
+  }
+  auto blockSize = alpha ? 16 : 8;
+  auto blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  if (size < size_t(blocksX) * blocksY * blockSize) {
+    return false;
+  }
+  rgba.resize(size_t(width) * height * 4);
+  unsigned char texels[16 * 4];
+  for (auto blockY = 0; blockY < blocksY; ++blockY) {
+    for (auto blockX = 0; blockX < blocksX; ++blockX) {
+      const auto *block = data + (blockY * blocksX + blockX) * blockSize;
+      decodeColorBlock(alpha ? block + 8 : block, punchthrough, texels);
+      if (alpha) {
+        decodeAlphaBlock(block, texels);
+      }
+      for (auto y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+        for (auto x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+          std::copy(texels + (y * 4 + x) * 4, texels + (y * 4 + x) * 4 + 4,
+                    rgba.data() + ((blockY * 4 + y) * width + blockX * 4 + x) *
+                                      4);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace triangle
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triangle {
+
+// CPU decoder for the ETC2 formats GLES3 guarantees, used when the driver
+// rejects a compressed upload. Fills rgba with width * height RGBA8 texels.
+bool decodeETC2(GLenum internalFormat, const unsigned char *data, size_t size,
+                uint32_t width, uint32_t height,
+                std::vector<unsigned char> &rgba);
+
+} // namespace triangle
@@ -16,54 +16,801 @@
 
 #include "Engine.h"
 #include "Common.h"
+#include "ETC2.h"
+#include "GeometryCache.h"
+#include "KTX2.h"
+#include "SharedContext.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
+#include <limits>
+#include <stb_image_write.h>
+#include <thread>
 #include <utility>
 
 namespace triangle {
 
+static const size_t UPLOAD_CHUNK_SIZE = 8 * 1024 * 1024;
+static const size_t DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+static const unsigned int READBACK_RING_SIZE = 3;
+static const unsigned int GPU_TIMER_RING_SIZE = 4;
+static const unsigned int MAX_LOD_LEVELS = 4;
+// A node only switches to a coarser level once it is this much below the
+// threshold, so that it does not flicker between two levels.
+static const float LOD_HYSTERESIS = 0.25f;
+static const unsigned int ANIMATION_GRAIN_SIZE = 16;
+static const unsigned int SKIN_GRAIN_SIZE = 16;
+static const unsigned int CANDIDATE_GRAIN_SIZE = 256;
+static const unsigned int CULL_GRAIN_SIZE = 4096;
+static const unsigned int QUEUE_GRAIN_SIZE = 1024;
+static const unsigned int NODE_GRAIN_SIZE = 256;
+static const unsigned int MESH_GRAIN_SIZE = 4;
+
+static double millisecondsBetween(ProfileClock::time_point start,
+                                  ProfileClock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static bool hasSuffix(const std::string &path, const std::string &suffix) {
+  return path.size() >= suffix.size() &&
+         path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Picks the stb_image_write encoder from the extension, PNG by default.
+static bool writeImage(const std::string &path, unsigned int width,
+                       unsigned int height, const unsigned char *pixels) {
+  if (hasSuffix(path, ".jpg") || hasSuffix(path, ".jpeg")) {
+    return stbi_write_jpg(path.c_str(), width, height, 4, pixels, 90) != 0;
+  }
+  if (hasSuffix(path, ".bmp")) {
+    return stbi_write_bmp(path.c_str(), width, height, 4, pixels) != 0;
+  }
+  if (hasSuffix(path, ".tga")) {
+    return stbi_write_tga(path.c_str(), width, height, 4, pixels) != 0;
+  }
+  return stbi_write_png(path.c_str(), width, height, 4, pixels, width * 4) !=
+         0;
+}
+
 Engine::Engine(unsigned int width, unsigned int height)
-    : width(width), height(height) {
+    : transformStore_(std::make_shared<TransformStore>()), width(width),
+      height(height), uploadBudget_(DEFAULT_UPLOAD_BUDGET),
+      imageDecodeThreads_(std::max(1u, std::thread::hardware_concurrency())) {
   preDefinedAttributes.emplace_back("POSITION", 0);
   preDefinedAttributes.emplace_back("NORMAL", 1);
   preDefinedAttributes.emplace_back("TEXCOORD_0", 2);
+  preDefinedAttributes.emplace_back("COLOR_0", ATTRIBUTE_COLOR_0);
+  preDefinedAttributes.emplace_back("JOINTS_0", ATTRIBUTE_JOINTS_0);
+  preDefinedAttributes.emplace_back("WEIGHTS_0", ATTRIBUTE_WEIGHTS_0);
 }
 
-void Engine::loadGLTF(const std::string &path) {
-  tinygltf::TinyGLTF loader;
-  std::string err;
-  std::string warn;
-  loader.LoadASCIIFromFile(&model_, &err, &warn, path);
+std::shared_ptr<LoadHandle> Engine::loadGLTF(const std::string &path) {
+  auto asset = std::make_shared<Asset>();
+  asset->handle = std::make_shared<LoadHandle>();
+  asset->path = path;
+  asset->queued = ProfileClock::now();
+  asset->loader.setImageDecodeThreads(imageDecodeThreads_);
+  asset->optimizeGeometry = optimizeGeometry_;
+  asset->quantizeVertices = quantizeVertices_;
+  asset->generateLods = generateLods_;
+  asset->geometryCacheDirectory = geometryCacheDirectory_;
+  asset->jobSystem = getJobSystem();
+  prepareAsset(*asset, path, preDefinedAttributes);
+  std::promise<void> parsed;
+  parsed.set_value();
+  asset->parsed = parsed.get_future();
+  loads_.push_back(asset);
+  return asset->handle;
+}
+
+// Parsing, image decoding and collision geometry run on the thread pool, GL
+// uploads are spread over the following frames within the upload budget.
+std::shared_ptr<LoadHandle> Engine::loadGLTFAsync(const std::string &path) {
+  auto asset = std::make_shared<Asset>();
+  asset->handle = std::make_shared<LoadHandle>();
+  asset->path = path;
+  asset->queued = ProfileClock::now();
+  asset->timeSliced = true;
+  asset->loader.setImageDecodeThreads(imageDecodeThreads_);
+  asset->optimizeGeometry = optimizeGeometry_;
+  asset->quantizeVertices = quantizeVertices_;
+  asset->generateLods = generateLods_;
+  asset->geometryCacheDirectory = geometryCacheDirectory_;
+  asset->jobSystem = getJobSystem();
+  asset->parsed = getThreadPool()->submit(
+      [asset, path, attributes = preDefinedAttributes] {
+        prepareAsset(*asset, path, attributes);
+      });
+  loads_.push_back(asset);
+  return asset->handle;
+}
+
+// Removes the scenes of the asset and frees its vertex arrays, textures and
+// arena ranges, compacting the arenas once more than half of them is unused.
+// A load still in flight is dropped, a worker parsing it finishes unseen.
+void Engine::unloadGLTF(const std::shared_ptr<LoadHandle> &handle) {
+  flushFrame();
+  for (auto *assets : {&loads_, &assets_}) {
+    for (auto iterator = assets->begin(); iterator != assets->end();
+         ++iterator) {
+      if ((*iterator)->handle != handle) {
+        continue;
+      }
+      auto scenesChanged = !(*iterator)->scenes.empty();
+      releaseAsset(**iterator);
+      assets->erase(iterator);
+      if (scenesChanged) {
+        buildBVH();
+      }
+      for (auto &arena : {vertexArena_, indexArena_}) {
+        if (arena != nullptr && arena->getStats().usedBytes * 2 <
+                                    arena->getStats().capacityBytes) {
+          compactGeometry();
+          break;
+        }
+      }
+      return;
+    }
+  }
+}
+
+// Packs the vertex and index arenas and re-points the vertex arrays and index
+// offsets of every resident asset at the moved ranges.
+bool Engine::compactGeometry() {
+  if (vertexArena_ == nullptr || !resourceCache_->compactGeometry()) {
+    return false;
+  }
+  rebindGeometry();
+  return true;
+}
+
+// Engines sharing the resource cache share the arenas, so this also runs when
+// another engine compacted them.
+void Engine::rebindGeometry() {
+  for (auto *assets : {&loads_, &assets_}) {
+    for (auto &asset : *assets) {
+      for (auto &binding : asset->geometryBindings) {
+        bindGeometry(*asset, binding);
+      }
+      for (auto &indexBinding : asset->indexBindings) {
+        indexBinding.primitive->setIndexOffset(
+            indexArena_->getOffset(asset->indexAllocation) +
+                indexBinding.offset,
+            indexBinding.lod);
+      }
+    }
+  }
+  GL_CHECK(glBindVertexArray(0));
+  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  geometryVersion_ = resourceCache_->getGeometryVersion();
+}
+
+const GeometryStats &Engine::getGeometryStats() {
+  geometryStats_.vertexArrays = 0;
+  for (auto &asset : assets_) {
+    geometryStats_.vertexArrays += asset->geometryBindings.size();
+  }
+  if (vertexArena_ != nullptr) {
+    geometryStats_.vertices = vertexArena_->getStats();
+    geometryStats_.indices = indexArena_->getStats();
+  }
+  return geometryStats_;
+}
+
+// Engines on one GL context that share a cache also share the textures,
+// geometry, materials and program their assets have in common. Must be set
+// before the first frame, otherwise the engine makes a cache of its own.
+void Engine::setResourceCache(std::shared_ptr<ResourceCache> resourceCache) {
+  resourceCache_ = std::move(resourceCache);
+}
+
+const std::shared_ptr<ResourceCache> &Engine::getResourceCache() {
+  if (resourceCache_ == nullptr) {
+    resourceCache_ = std::make_shared<ResourceCache>();
+  }
+  return resourceCache_;
+}
+
+const ResourceCacheStats &Engine::getResourceCacheStats() {
+  return getResourceCache()->getStats();
+}
+
+void Engine::setUploadBudget(size_t bytesPerFrame) {
+  uploadBudget_ = bytesPerFrame;
+}
+
+// Applies to assets loaded afterwards. With a cache directory the optimized
+// geometry of each asset is stored there and reused by later loads.
+void Engine::setGeometryOptimization(bool enabled,
+                                     const std::string &cacheDirectory) {
+  optimizeGeometry_ = enabled;
+  geometryCacheDirectory_ = cacheDirectory;
+}
+
+// Applies to assets loaded afterwards. Float positions, normals and texture
+// coordinates of indexed triangle lists are stored in compact formats, see
+// VertexEncoding, through the same rewrite as the geometry optimization.
+void Engine::setVertexQuantization(bool enabled) {
+  quantizeVertices_ = enabled;
+}
+
+// Applies to assets loaded afterwards. Indexed triangle lists get up to
+// MAX_LOD_LEVELS simplified index lists, through the same rewrite as the
+// geometry optimization.
+void Engine::setLodGeneration(bool enabled) { generateLods_ = enabled; }
+
+// Nodes draw the coarsest level whose error projects to at most this many
+// pixels. 0 always draws the full meshes.
+void Engine::setLodErrorThreshold(float pixels) {
+  lodErrorThreshold_ = pixels;
+}
+
+// 0 decodes each image inline while the document is parsed.
+void Engine::setImageDecodeThreads(unsigned int threadCount) {
+  imageDecodeThreads_ = threadCount;
+}
+
+const std::shared_ptr<ThreadPool> &Engine::getThreadPool() {
+  if (threadPool_ == nullptr) {
+    threadPool_ = std::make_shared<ThreadPool>(
+        std::max(2u, std::thread::hardware_concurrency()) - 1);
+  }
+  return threadPool_;
+}
+
+// Threads running frame and load jobs, the calling thread included, 0 for
+// one per core. Takes effect from the next frame or load.
+void Engine::setJobThreads(unsigned int threadCount) {
+  jobThreads_ = threadCount;
+  jobSystem_ = nullptr;
+}
+
+const std::shared_ptr<JobSystem> &Engine::getJobSystem() {
+  if (jobSystem_ == nullptr) {
+    jobSystem_ = std::make_shared<JobSystem>(
+        jobThreads_ > 0 ? jobThreads_
+                        : std::max(1u, std::thread::hardware_concurrency()));
+  }
+  return jobSystem_;
 }
 
 void Engine::init() {
+  queryCompressedTextureFormats();
   buildDefaultCamera();
-  buildProgram();
-  buildScenes();
+  buildProgramCache();
+  buildFrameUniforms();
+  buildInstanceBuffer();
+  buildJointPalette();
+  buildBackend();
+  buildGeometryArenas();
+#ifdef TRIANGLE_PROFILING
+  if (GpuTimer::isSupported()) {
+    gpuTimer_ = std::make_shared<GpuTimer>(GPU_TIMER_RING_SIZE);
+  }
+#endif
 }
 
+// With frame pipelining the frame is recorded on the job system while the
+// previous one is replayed here, so it shows after the next drawFrame or
+// flushFrame.
 void Engine::drawFrame() {
+  beginFrame();
+  {
+    PROFILE_SCOPE(profiler_, "transforms");
+    updateTransforms();
+  }
+  auto &commands = commandBuffers_[nextCommandBuffer_];
+  commandBufferFrames_[nextCommandBuffer_] = frameIndex_;
+  if (pendingFrame_) {
+    auto job = getJobSystem()->schedule([&]() { recordFrame(commands); });
+    submitFrame(1 - nextCommandBuffer_);
+    getJobSystem()->wait(job);
+  } else {
+    recordFrame(commands);
+  }
+  if (framePipelining_) {
+    pendingFrame_ = true;
+    nextCommandBuffer_ = 1 - nextCommandBuffer_;
+  } else {
+    submitFrame(nextCommandBuffer_);
+  }
+  endFrame();
+}
+
+// Everything drawFrame does before GL, free of GL calls so it can run on any
+// thread while the previous frame is replayed.
+void Engine::recordFrame(CommandBuffer &commands) {
+  const auto &viewMatrix = camera_->getViewMatrix();
+  const auto &projectMatrix = camera_->getProjectMatrix();
+  viewUniforms_.assign(1, {projectMatrix * viewMatrix, viewMatrix,
+                           projectMatrix});
+  const auto &viewProjectMatrix = viewUniforms_[0].viewProjectMatrix;
+  setLodView(*camera_, height);
+  const auto nearPlane = camera_->getNearPlane();
+  const auto depthRange = camera_->getFarPlane() - nearPlane;
+  {
+    PROFILE_SCOPE(profiler_, "transforms");
+    updateBVH();
+  }
+  Frustum frustum(viewProjectMatrix);
+  {
+    PROFILE_SCOPE(profiler_, "cull");
+    bvh_.cull(frustum, visibleNodes_);
+    buildDrawCandidates(visibleNodes_);
+    cullStats_.visible = cullCandidates(frustum, candidateVisibility_);
+    cullStats_.culled = primitiveCount_ - cullStats_.visible;
+  }
+  {
+    // Culled candidates are queued too and skipped by the record, so that
+    // every candidate has its slot and the queue fills in parallel.
+    PROFILE_SCOPE(profiler_, "sort");
+    renderQueue_.clear();
+    const auto first = renderQueue_.allocate(drawCandidates_.size());
+    getJobSystem()->parallelFor(
+        drawCandidates_.size(), QUEUE_GRAIN_SIZE,
+        [&](unsigned int begin, unsigned int end) {
+          for (auto i = begin; i < end; ++i) {
+            const auto &candidate = drawCandidates_[i];
+            const auto &worldMatrix = *candidate.worldMatrix;
+            auto viewDepth = -(viewMatrix * worldMatrix[3]).z;
+            auto depth = (viewDepth - nearPlane) / depthRange;
+            renderQueue_.setItem(
+                first + i, candidate.primitive,
+                candidate.primitive->getMaterial()->getProgram(), worldMatrix,
+                depth, candidate.lod, candidate.jointOffset);
+          }
+        });
+    renderQueue_.sort();
+  }
+  {
+    PROFILE_SCOPE(profiler_, "record");
+    beginCommands(commands);
+    commands.clear(width, height);
+    commands.beginView(0);
+    if (!skinnedNodes_.empty()) {
+      commands.bindJoints();
+    }
+    renderQueue_.record(commands, &candidateVisibility_,
+                        getJobSystem().get());
+  }
+}
+
+// Loads, the BVH refit, candidate bounds and the sort are done once for all
+// views, levels of detail are picked for the first one. The queue is sorted by
+// state only, since depth differs per view, and recorded once per view with
+// that view's frustum visibility; the instance matrices and the camera
+// uniforms of all views each go up in a single upload. Stats are summed over
+// the views. A pipelined frame still pending is replayed first.
+void Engine::drawViews(const std::vector<std::shared_ptr<Camera>> &cameras,
+                       MultiViewTarget &target) {
+  flushFrame();
+  beginFrame();
+  {
+    PROFILE_SCOPE(profiler_, "transforms");
+    updateBVH();
+  }
+  auto viewCount =
+      std::min<unsigned int>(cameras.size(), target.getViewCount());
+  {
+    PROFILE_SCOPE(profiler_, "cull");
+    viewUniforms_.clear();
+    viewFrustums_.clear();
+    candidateNodes_.assign(bvhNodes_.size(), 0);
+    for (auto view = 0; view < viewCount; ++view) {
+      const auto &viewMatrix = cameras[view]->getViewMatrix();
+      const auto &projectMatrix = cameras[view]->getProjectMatrix();
+      viewUniforms_.push_back(
+          {projectMatrix * viewMatrix, viewMatrix, projectMatrix});
+      viewFrustums_.emplace_back(viewUniforms_.back().viewProjectMatrix);
+      bvh_.cull(viewFrustums_.back(), visibleNodes_);
+      for (auto nodeIndex : visibleNodes_) {
+        candidateNodes_[nodeIndex] = 1;
+      }
+    }
+    if (viewCount > 0) {
+      setLodView(*cameras[0], target.getViewHeight());
+    }
+    visibleNodes_.clear();
+    for (auto nodeIndex = 0; nodeIndex < candidateNodes_.size();
+         ++nodeIndex) {
+      if (candidateNodes_[nodeIndex]) {
+        visibleNodes_.push_back(nodeIndex);
+      }
+    }
+    buildDrawCandidates(visibleNodes_);
+  }
+  {
+    PROFILE_SCOPE(profiler_, "sort");
+    renderQueue_.clear();
+    const auto first = renderQueue_.allocate(drawCandidates_.size());
+    getJobSystem()->parallelFor(
+        drawCandidates_.size(), QUEUE_GRAIN_SIZE,
+        [&](unsigned int begin, unsigned int end) {
+          for (auto i = begin; i < end; ++i) {
+            const auto &candidate = drawCandidates_[i];
+            renderQueue_.setItem(
+                first + i, candidate.primitive,
+                candidate.primitive->getMaterial()->getProgram(),
+                *candidate.worldMatrix, 0.0f, candidate.lod,
+                candidate.jointOffset);
+          }
+        });
+    renderQueue_.sort();
+  }
+  auto &commands = commandBuffers_[nextCommandBuffer_];
+  commandBufferFrames_[nextCommandBuffer_] = frameIndex_;
+  {
+    PROFILE_SCOPE(profiler_, "record");
+    cullStats_ = CullStats();
+    viewVisibilities_.resize(viewCount);
+    for (auto view = 0; view < viewCount; ++view) {
+      auto visible =
+          cullCandidates(viewFrustums_[view], viewVisibilities_[view]);
+      cullStats_.visible += visible;
+      cullStats_.culled += primitiveCount_ - visible;
+    }
+    beginCommands(commands);
+    if (!skinnedNodes_.empty()) {
+      commands.bindJoints();
+    }
+    renderQueue_.recordViews(commands, viewVisibilities_,
+                             getJobSystem().get());
+  }
+  target.bind();
+  submitFrame(nextCommandBuffer_,
+              [&](unsigned int view) { target.bindView(view); });
+  target.unbind();
+  endFrame();
+}
+
+// Starts a frame's buffer with the camera uniforms and, when the skins moved
+// since the last frame, the joint palette.
+void Engine::beginCommands(CommandBuffer &commands) {
+  commands.reset();
+  commands.setViews(viewUniforms_);
+  if (jointRowsDirty_) {
+    commands.setJointRows(jointRows_);
+    jointRowsDirty_ = false;
+  }
+}
+
+// Replays a recorded frame on this thread, timed for the "submit" scope that
+// endFrame adds, since the recording of the next frame may be using the
+// profiler meanwhile.
+void Engine::submitFrame(unsigned int commandBuffer,
+                         const std::function<void(unsigned int)> &beginView) {
+  submitStart_ = ProfileClock::now();
+#ifdef TRIANGLE_PROFILING
+  if (gpuTimer_ != nullptr) {
+    gpuTimer_->begin(commandBufferFrames_[commandBuffer]);
+  }
+#endif
+  backend_->execute(commandBuffers_[commandBuffer], beginView);
+#ifdef TRIANGLE_PROFILING
+  if (gpuTimer_ != nullptr) {
+    gpuTimer_->end();
+  }
+#endif
+  submitEnd_ = ProfileClock::now();
+  frameSubmitted_ = true;
+}
+
+// Pipelined frames are recorded while the previous one is replayed, for one
+// frame of latency. Turning it off replays the pending frame.
+void Engine::setFramePipelining(bool enabled) {
+  if (!enabled) {
+    flushFrame();
+  }
+  framePipelining_ = enabled;
+}
+
+// Replays the pending pipelined frame, if any, e.g. before reading pixels,
+// swapping buffers for the last time or changing the scene under it.
+void Engine::flushFrame() {
+  if (!pendingFrame_) {
+    return;
+  }
+  pendingFrame_ = false;
+  submitFrame(1 - nextCommandBuffer_);
+}
+
+const GLStateCacheStats &Engine::getStateCacheStats() {
+  return stateCache_.getStats();
+}
+
+const RenderQueueStats &Engine::getRenderQueueStats() {
+  return renderQueue_.getStats();
+}
+
+const CullStats &Engine::getCullStats() { return cullStats_; }
+
+RaycastHit Engine::raycast(const glm::vec3 &origin,
+                           const glm::vec3 &direction) {
+  RaycastHit hit;
+  if (!initialized_) {
+    return hit;
+  }
+  updateBVH();
+  auto distance = 1e30f;
+  bvh_.raycast(origin, direction, distance, [&](uint32_t item, float &t) {
+    const auto &node = bvhNodes_[item];
+    auto inverseWorldMatrix = glm::inverse(node->getWorldMatrix());
+    auto localOrigin = glm::vec3(inverseWorldMatrix * glm::vec4(origin, 1.0f));
+    auto localDirection =
+        glm::vec3(inverseWorldMatrix * glm::vec4(direction, 0.0f));
+    auto nodeHit = false;
+    for (auto &primitive : node->getMesh()->getPrimitives()) {
+      if (primitive->intersect(localOrigin, localDirection, t)) {
+        hit.node = node;
+        hit.primitive = primitive;
+        hit.distance = t;
+        nodeHit = true;
+      }
+    }
+    return nodeHit;
+  });
+  return hit;
+}
+
+void Engine::setRenderQueueSortEnabled(bool sortEnabled) {
+  renderQueue_.setSortEnabled(sortEnabled);
+}
+
+// Queues a copy of the bound read framebuffer, as left by the last drawFrame.
+// The callback runs from a later drawFrame or finishReadbacks once the GPU is
+// done, with the pixels still in the mapped pack buffer.
+void Engine::readbackFrameAsync(ReadbackCallback callback) {
+  if (frameReadback_ == nullptr) {
+    frameReadback_ =
+        std::make_shared<FrameReadback>(width, height, READBACK_RING_SIZE);
+  }
+  frameReadback_->request(frameIndex_, std::move(callback));
+}
+
+// Flips the rows while copying out of the pack buffer, encoding happens on
+// the thread pool.
+std::future<bool> Engine::saveFrameAsync(const std::string &path) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  auto threadPool = getThreadPool();
+  readbackFrameAsync([promise, threadPool, path](const ReadbackFrame &frame) {
+    auto pixels = std::make_shared<std::vector<unsigned char>>(
+        frame.width * frame.height * 4);
+    for (auto y = 0; y < frame.height; ++y) {
+      memcpy(pixels->data() + (frame.height - 1 - y) * frame.width * 4,
+             frame.pixels + y * frame.stride, frame.width * 4);
+    }
+    auto width = frame.width, height = frame.height;
+    threadPool->submit([promise, pixels, path, width, height] {
+      promise->set_value(writeImage(path, width, height, pixels->data()));
+    });
+  });
+  return promise->get_future();
+}
+
+void Engine::finishReadbacks() {
+  if (frameReadback_ != nullptr) {
+    frameReadback_->poll(true);
+  }
+}
+
+void Engine::beginFrame() {
   if (!initialized_) {
     init();
     initialized_ = true;
   }
-  program_->bind();
-  GL_CHECK(glEnable(GL_DEPTH_TEST));
-  GL_CHECK(glViewport(0, 0, width, height));
-  GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-  GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-  for (auto &scene : scenes_) {
-    scene->traverse([&](const std::shared_ptr<Node> &node) {
-      auto modelViewProjectMatrix = camera_->getProjectMatrix() *
-                                    camera_->getViewMatrix() *
-                                    node->getWorldMatrix();
-      auto location = GL_CHECK(glGetUniformLocation(
-          program_->getProgram(), UNIFORM_MODEL_VIEW_PROJECT_MATRIX));
-      GL_CHECK(glUniformMatrix4fv(location, 1, false,
-                                  glm::value_ptr(modelViewProjectMatrix)));
-      node->draw();
-    });
+  if (geometryVersion_ != resourceCache_->getGeometryVersion()) {
+    rebindGeometry();
+  }
+  ++frameIndex_;
+#ifdef TRIANGLE_PROFILING
+  frameStart_ = ProfileClock::now();
+  profiler_.beginFrame();
+#endif
+  if (frameReadback_ != nullptr) {
+    frameReadback_->poll(false);
+  }
+  frameStats_.uploadMilliseconds = 0.0;
+  frameStats_.completedLoads.clear();
+  frameSubmitted_ = false;
+  {
+    PROFILE_SCOPE(profiler_, "loads");
+    adoptPrecompiledPrograms(false);
+    processLoads();
+  }
+#ifdef TRIANGLE_PROFILING
+  // Polled before the frame's query so only flushed frames are checked. A
+  // result from a disjoint period is dropped, the last valid one stays.
+  double gpuMilliseconds = 0.0;
+  uint64_t gpuFrameIndex = 0;
+  if (gpuTimer_ != nullptr && gpuTimer_->poll(gpuMilliseconds, gpuFrameIndex)) {
+    frameStats_.gpuMilliseconds = gpuMilliseconds;
+    frameStats_.gpuFrameIndex = gpuFrameIndex;
   }
+#endif
+}
+
+void Engine::endFrame() {
+  if (getGLErrorMode() == GLErrorMode::PER_FRAME) {
+    checkGLError("frame", __FILE__, __LINE__);
+  }
+  const auto &queueStats = renderQueue_.getStats();
+  frameStats_.frameIndex = frameIndex_;
+  frameStats_.draws = queueStats.draws;
+  frameStats_.instances = queueStats.instances;
+  frameStats_.triangles = queueStats.triangles;
+  frameStats_.stateChanges = queueStats.stateChanges;
+  frameStats_.visiblePrimitives = cullStats_.visible;
+  frameStats_.residentBufferBytes =
+      vertexArena_->getStats().capacityBytes +
+      indexArena_->getStats().capacityBytes;
+  frameStats_.residentTextureBytes = resourceCache_->getStats().textureBytes;
+#ifdef TRIANGLE_PROFILING
+  if (frameSubmitted_) {
+    profiler_.addScope("submit", submitStart_, submitEnd_,
+                       std::this_thread::get_id());
+  }
+  auto frameEnd = ProfileClock::now();
+  frameStats_.cpuMilliseconds = millisecondsBetween(frameStart_, frameEnd);
+  frameStats_.cpuTimings = profiler_.getTimings();
+  profiler_.addEvent("frame", frameStart_, frameEnd,
+                     std::this_thread::get_id());
+  profiler_.addCounter("draws", frameStats_.draws);
+  profiler_.addCounter("gpu ms", frameStats_.gpuMilliseconds);
+#endif
+}
+
+const FrameStats &Engine::getFrameStats() { return frameStats_; }
+
+// Returns false when the file cannot be written or profiling is compiled out.
+bool Engine::startTrace(const std::string &path) {
+#ifdef TRIANGLE_PROFILING
+  return profiler_.startTrace(path);
+#else
+  return false;
+#endif
+}
+
+void Engine::stopTrace() { profiler_.stopTrace(); }
+
+// Levels of detail are picked for the camera's position and vertical
+// projection scale in pixels.
+void Engine::setLodView(Camera &camera, unsigned int viewHeight) {
+  lodViewPosition_ = glm::vec3(glm::inverse(camera.getViewMatrix())[3]);
+  lodPixelsPerUnit_ = camera.getProjectMatrix()[1][1] * viewHeight * 0.5f;
+  lodViewHeight_ = std::max(viewHeight, 1u);
+  lodNearPlane_ = camera.getNearPlane();
+}
+
+// MSFT_lod nodes pick a mesh by the screen height share of their bounds,
+// other nodes pick a level of their primitives by the projected error. Going
+// coarser needs LOD_HYSTERESIS of margin, going finer none.
+unsigned int Engine::selectLod(uint32_t nodeIndex) {
+  const auto &node = bvhNodes_[nodeIndex];
+  const auto &lodMeshes = node->getLodMeshes();
+  const unsigned int lodCount = lodMeshes.empty()
+                                    ? node->getMesh()->getLodCount()
+                                    : lodMeshes.size();
+  if (lodCount <= 1 || lodErrorThreshold_ <= 0.0f) {
+    return 0;
+  }
+  const auto center = (bvhMins_[nodeIndex] + bvhMaxs_[nodeIndex]) * 0.5f;
+  const auto radius = glm::length(bvhMaxs_[nodeIndex] - center);
+  const auto distance = std::max(
+      glm::length(center - lodViewPosition_) - radius, lodNearPlane_);
+  const auto pixelsPerUnit = lodPixelsPerUnit_ / distance;
+  auto lod = std::min(node->getLod(), lodCount - 1);
+  if (!lodMeshes.empty()) {
+    const auto coverage = 2.0f * radius * pixelsPerUnit / lodViewHeight_;
+    const auto &coverages = node->getLodScreenCoverages();
+    auto threshold = [&](unsigned int level) {
+      return level < coverages.size() ? coverages[level]
+                                      : std::pow(0.5f, float(level + 1));
+    };
+    while (lod + 1 < lodCount &&
+           coverage < threshold(lod) * (1.0f - LOD_HYSTERESIS)) {
+      ++lod;
+    }
+    while (lod > 0 && coverage >= threshold(lod - 1)) {
+      --lod;
+    }
+  } else {
+    const auto &worldMatrix = node->getWorldMatrix();
+    const auto scale = std::max(
+        {glm::length(glm::vec3(worldMatrix[0])),
+         glm::length(glm::vec3(worldMatrix[1])),
+         glm::length(glm::vec3(worldMatrix[2]))});
+    const auto &mesh = node->getMesh();
+    auto projectedError = [&](unsigned int level) {
+      return mesh->getLodError(level) * scale * pixelsPerUnit;
+    };
+    while (lod + 1 < lodCount &&
+           projectedError(lod + 1) <=
+               lodErrorThreshold_ * (1.0f - LOD_HYSTERESIS)) {
+      ++lod;
+    }
+    while (lod > 0 && projectedError(lod) > lodErrorThreshold_) {
+      --lod;
+    }
+  }
+  node->setLod(lod);
+  return lod;
+}
+
+// The primitives of the nodes, in node order. Levels of detail are picked
+// for all nodes in parallel, then each node writes its primitives after those
+// of the nodes before it, again in parallel.
+void Engine::buildDrawCandidates(const std::vector<uint32_t> &nodeIndices) {
+  const auto &jobSystem = getJobSystem();
+  candidateMeshes_.resize(nodeIndices.size());
+  jobSystem->parallelFor(
+      nodeIndices.size(), CANDIDATE_GRAIN_SIZE,
+      [&](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          const auto &node = bvhNodes_[nodeIndices[i]];
+          auto lod = selectLod(nodeIndices[i]);
+          auto *mesh = node->getMesh().get();
+          if (!node->getLodMeshes().empty()) {
+            mesh = node->getLodMeshes()[lod].get();
+            lod = 0;
+          }
+          candidateMeshes_[i] = {mesh, lod, 0};
+        }
+      });
+  unsigned int candidateCount = 0;
+  for (auto &candidateMesh : candidateMeshes_) {
+    candidateMesh.firstCandidate = candidateCount;
+    candidateCount += candidateMesh.mesh->getPrimitives().size();
+  }
+  drawCandidates_.resize(candidateCount);
+  candidateBounds_.resize(candidateCount);
+  jobSystem->parallelFor(
+      nodeIndices.size(), CANDIDATE_GRAIN_SIZE,
+      [&](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          pushDrawCandidates(nodeIndices[i], candidateMeshes_[i]);
+        }
+      });
+}
+
+void Engine::pushDrawCandidates(uint32_t nodeIndex,
+                                const CandidateMesh &candidateMesh) {
+  const auto &node = bvhNodes_[nodeIndex];
+  const auto &worldMatrix = node->getWorldMatrix();
+  // Skinned nodes are bounded by their skin, see Skin::update.
+  const auto &skin = node->getSkin();
+  const auto jointOffset = skin != nullptr ? int(node->getJointOffset()) : 0;
+  auto candidate = candidateMesh.firstCandidate;
+  for (auto &primitive : candidateMesh.mesh->getPrimitives()) {
+    glm::vec3 center, extent;
+    if (skin != nullptr) {
+      center = (bvhMins_[nodeIndex] + bvhMaxs_[nodeIndex]) * 0.5f;
+      extent = (bvhMaxs_[nodeIndex] - bvhMins_[nodeIndex]) * 0.5f;
+    } else {
+      Frustum::transformBounds(worldMatrix, primitive->getBoundsMin(),
+                               primitive->getBoundsMax(), center, extent);
+    }
+    drawCandidates_[candidate] = {primitive.get(), &worldMatrix,
+                                  candidateMesh.lod,
+                                  primitive->isSkinned() ? jointOffset : -1};
+    candidateBounds_.set(candidate, center, extent);
+    ++candidate;
+  }
+}
+
+unsigned int Engine::cullCandidates(Frustum &frustum,
+                                    std::vector<uint8_t> &visibility) {
+  visibility.resize(candidateBounds_.size());
+  std::atomic<unsigned int> visible{0};
+  getJobSystem()->parallelFor(candidateBounds_.size(), CULL_GRAIN_SIZE,
+                              [&](unsigned int begin, unsigned int end) {
+                                visible += frustum.cullRange(
+                                    candidateBounds_, visibility.data(),
+                                    begin, end);
+                              });
+  return visible;
 }
 
 void Engine::buildDefaultCamera() {
@@ -74,219 +821,1709 @@ void Engine::buildDefaultCamera() {
   }
 }
 
-void Engine::buildProgram() {
-  program_ = std::make_shared<Program>(VERTEX_SHADER, FRAGMENT_SHADER);
+// Programs themselves are built on first use, see getProgram.
+void Engine::buildProgramCache() {
+  if (!programCacheDirectory_.empty()) {
+    programBinaryCache_ =
+        std::make_shared<ProgramBinaryCache>(programCacheDirectory_);
+  }
 }
 
-std::shared_ptr<std::vector<GLuint>>
-Engine::buildBuffers(const tinygltf::Model &model) {
-  auto buffers = std::make_shared<std::vector<GLuint>>(model.buffers.size(), 0);
-  GL_CHECK(glGenBuffers(buffers->size(), buffers->data()));
-  for (auto i = 0; i < model.buffers.size(); ++i) {
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffers->at(i)));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, model.buffers[i].data.size(),
-                          model.buffers[i].data.data(), GL_STATIC_DRAW));
+// The program of a shader feature bitmask, from the programs precompiled so
+// far, the resource cache or the binary cache, compiled when none has it. A
+// precompile still running is waited for, it may be building this one.
+const std::shared_ptr<Program> &Engine::getProgram(uint32_t features) {
+  auto iterator = programs_.find(features);
+  if (iterator != programs_.end()) {
+    return iterator->second;
   }
-  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
-  return buffers;
+  adoptPrecompiledPrograms(true);
+  auto &program = programs_[features];
+  if (program == nullptr) {
+    program = getResourceCache()->getProgram(
+        buildShaderSource(VERTEX_SHADER, features),
+        buildShaderSource(FRAGMENT_SHADER, features),
+        programBinaryCache_.get());
+    FrameUniforms::bindBlock(program->getProgram());
+    JointPalette::bindSampler(program->getProgram());
+  }
+  return program;
 }
 
-std::shared_ptr<std::vector<GLuint>>
-Engine::buildTextures(const tinygltf::Model &model) {
-  auto textures = std::make_shared<std::vector<GLuint>>(model.textures.size());
-  GL_CHECK(glGenTextures(textures->size(), textures->data()));
-  for (auto i = 0; i < textures->size(); ++i) {
-    GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures->at(i)));
-    const auto &texture = model.textures[i];
-    const auto &image = model.images[texture.source];
-    auto minFilter =
-        texture.sampler >= 0 && model.samplers[texture.sampler].minFilter != -1
-            ? model.samplers[texture.sampler].minFilter
-            : GL_LINEAR;
-    auto magFilter =
-        texture.sampler >= 0 && model.samplers[texture.sampler].magFilter != -1
-            ? model.samplers[texture.sampler].magFilter
-            : GL_LINEAR;
-    auto wrapS = texture.sampler >= 0 ? model.samplers[texture.sampler].wrapS
-                                      : GL_REPEAT;
-    auto wrapT = texture.sampler >= 0 ? model.samplers[texture.sampler].wrapT
-                                      : GL_REPEAT;
-    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height,
-                          0, GL_RGBA, image.pixel_type, image.image.data()));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS));
-    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT));
-    if (minFilter == GL_NEAREST_MIPMAP_NEAREST ||
-        minFilter == GL_NEAREST_MIPMAP_LINEAR ||
-        minFilter == GL_LINEAR_MIPMAP_NEAREST ||
-        minFilter == GL_LINEAR_MIPMAP_LINEAR) {
-      GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+// Builds the programs of the given feature bitmasks ahead of the assets that
+// need them. In the background they are compiled, or loaded from the binary
+// cache, on a context shared with the current one and picked up by a later
+// frame; without EGL or with background false they are built right away.
+void Engine::precompilePrograms(const std::vector<uint32_t> &featureSets,
+                                bool background) {
+  if (!initialized_) {
+    init();
+    initialized_ = true;
+  }
+  adoptPrecompiledPrograms(true);
+  std::vector<uint32_t> pending;
+  for (auto features : featureSets) {
+    if (programs_.count(features) == 0) {
+      pending.push_back(features);
     }
   }
-  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
-  return textures;
+  auto context = background && !pending.empty()
+                     ? std::make_shared<SharedContext>()
+                     : nullptr;
+  if (context == nullptr || !context->isValid()) {
+    for (auto features : pending) {
+      getProgram(features);
+    }
+    return;
+  }
+  precompiledPrograms_ = std::async(
+      std::launch::async,
+      [context, pending, binaryCache = programBinaryCache_] {
+        std::vector<std::pair<uint32_t, std::shared_ptr<Program>>> programs;
+        if (!context->bind()) {
+          return programs;
+        }
+        for (auto features : pending) {
+          programs.emplace_back(
+              features, std::make_shared<Program>(
+                            buildShaderSource(VERTEX_SHADER, features),
+                            buildShaderSource(FRAGMENT_SHADER, features),
+                            binaryCache.get()));
+        }
+        // The programs must be complete before the main context uses them.
+        GL_CHECK(glFinish());
+        context->unbind();
+        return programs;
+      });
 }
 
-void Engine::buildScenes() {
-  auto buffers = buildBuffers(model_);
-  auto textures = buildTextures(model_);
-  scenes_.resize(model_.scenes.size());
-  for (auto i = 0; i < model_.scenes.size(); ++i) {
-    scenes_[i] = buildScene(model_, i, buffers, textures);
+void Engine::adoptPrecompiledPrograms(bool wait) {
+  if (!precompiledPrograms_.valid() ||
+      (!wait && precompiledPrograms_.wait_for(std::chrono::seconds(0)) !=
+                    std::future_status::ready)) {
+    return;
+  }
+  for (auto &entry : precompiledPrograms_.get()) {
+    if (programs_.count(entry.first) > 0 || !entry.second->isLinked()) {
+      continue;
+    }
+    FrameUniforms::bindBlock(entry.second->getProgram());
+    JointPalette::bindSampler(entry.second->getProgram());
+    resourceCache_->addProgram(buildShaderSource(VERTEX_SHADER, entry.first),
+                               buildShaderSource(FRAGMENT_SHADER, entry.first),
+                               entry.second);
+    programs_[entry.first] = entry.second;
   }
 }
 
-std::shared_ptr<Scene>
-Engine::buildScene(const tinygltf::Model &model, unsigned int sceneIndex,
-                   const std::shared_ptr<std::vector<GLuint>> &buffers,
-                   const std::shared_ptr<std::vector<GLuint>> &textures) {
-  auto scene = std::make_shared<triangle::Scene>();
-  for (auto i = 0; i < model.scenes[sceneIndex].nodes.size(); ++i) {
-    scene->addNode(
-        buildNode(model, model.scenes[sceneIndex].nodes[i], buffers, textures));
+// Programs built afterwards are loaded from, or stored to, binaries in this
+// directory. Must be set before the first frame.
+void Engine::setProgramCacheDirectory(const std::string &directory) {
+  programCacheDirectory_ = directory;
+}
+
+ProgramBinaryCacheStats Engine::getProgramCacheStats() {
+  return programBinaryCache_ != nullptr ? programBinaryCache_->getStats()
+                                        : ProgramBinaryCacheStats();
+}
+
+// The translation, rotation and scale a glTF node is loaded with, matrices
+// decomposed without shear.
+static NodePose getRestPose(const tinygltf::Node &node) {
+  NodePose pose;
+  if (node.matrix.size() == 16) {
+    glm::mat4 matrix;
+    for (auto i = 0; i < 16; ++i) {
+      matrix[i / 4][i % 4] = node.matrix[i];
+    }
+    pose.translation = glm::vec3(matrix[3]);
+    pose.scale = glm::vec3(glm::length(glm::vec3(matrix[0])),
+                           glm::length(glm::vec3(matrix[1])),
+                           glm::length(glm::vec3(matrix[2])));
+    glm::mat3 rotation(glm::vec3(matrix[0]) / pose.scale.x,
+                       glm::vec3(matrix[1]) / pose.scale.y,
+                       glm::vec3(matrix[2]) / pose.scale.z);
+    pose.rotation = glm::normalize(glm::quat_cast(rotation));
+    return pose;
   }
-  return scene;
+  if (node.translation.size() == 3) {
+    pose.translation = glm::vec3(node.translation[0], node.translation[1],
+                                 node.translation[2]);
+  }
+  if (node.rotation.size() == 4) {
+    pose.rotation = glm::quat(node.rotation[3], node.rotation[0],
+                              node.rotation[1], node.rotation[2]);
+  }
+  if (node.scale.size() == 3) {
+    pose.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+  }
+  return pose;
+}
+
+// Starts, or restarts, one of the asset's animations, -1 for all of them.
+// Returns false when the asset is not loaded yet or has no such animation.
+bool Engine::playAnimation(const std::shared_ptr<LoadHandle> &handle,
+                           int animation, float speed, bool loop) {
+  auto asset = findAsset(handle);
+  if (asset == nullptr || animation < -1 ||
+      animation >= int(asset->animations.size())) {
+    return false;
+  }
+  auto started = false;
+  for (auto i = 0; i < asset->animations.size(); ++i) {
+    const auto &clip = asset->animations[i];
+    if ((animation >= 0 && i != animation) || clip == nullptr) {
+      continue;
+    }
+    auto iterator = std::find_if(
+        asset->animationInstances.begin(), asset->animationInstances.end(),
+        [&](const std::shared_ptr<AnimationInstance> &instance) {
+          return instance->getAnimation() == clip;
+        });
+    if (iterator == asset->animationInstances.end()) {
+      std::vector<int> targets;
+      std::vector<NodePose> restPoses;
+      for (auto nodeIndex : clip->getTargetNodes()) {
+        targets.push_back(asset->nodeTransforms[nodeIndex]);
+        restPoses.push_back(getRestPose(asset->model.nodes[nodeIndex]));
+      }
+      asset->animationInstances.push_back(std::make_shared<AnimationInstance>(
+          clip, std::move(targets), std::move(restPoses)));
+      animationInstances_.push_back(asset->animationInstances.back());
+      iterator = asset->animationInstances.end() - 1;
+    }
+    (*iterator)->play(speed, loop);
+    started = true;
+  }
+  animationsAdvanced_ |= started;
+  return started;
+}
+
+// Stopped animations leave the nodes in their last pose.
+void Engine::stopAnimation(const std::shared_ptr<LoadHandle> &handle,
+                           int animation) {
+  auto asset = findAsset(handle);
+  if (asset == nullptr) {
+    return;
+  }
+  auto &instances = asset->animationInstances;
+  for (auto iterator = instances.begin(); iterator != instances.end();) {
+    if (animation >= 0 && animation < asset->animations.size() &&
+        (*iterator)->getAnimation() != asset->animations[animation]) {
+      ++iterator;
+      continue;
+    }
+    animationInstances_.erase(std::remove(animationInstances_.begin(),
+                                          animationInstances_.end(),
+                                          *iterator),
+                              animationInstances_.end());
+    iterator = instances.erase(iterator);
+  }
+}
+
+// Index of the first animation with the name, -1 when there is none.
+int Engine::findAnimation(const std::shared_ptr<LoadHandle> &handle,
+                          const std::string &name) {
+  auto asset = findAsset(handle);
+  if (asset == nullptr) {
+    return -1;
+  }
+  for (auto i = 0; i < asset->animations.size(); ++i) {
+    if (asset->animations[i] != nullptr &&
+        asset->animations[i]->getName() == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Only moves the clocks, the poses are sampled when the next frame updates
+// the transforms.
+void Engine::advanceAnimations(float seconds) {
+  for (auto &instance : animationInstances_) {
+    instance->advance(seconds);
+  }
+  animationsAdvanced_ |= !animationInstances_.empty();
+}
+
+void Engine::buildFrameUniforms() {
+  frameUniforms_ = std::make_shared<FrameUniforms>();
+}
+
+void Engine::buildInstanceBuffer() {
+  instanceBuffer_ = std::make_shared<InstanceBuffer>();
+}
+
+void Engine::buildJointPalette() {
+  jointPalette_ = std::make_shared<JointPalette>();
+}
+
+void Engine::buildBackend() {
+  backend_ = std::make_shared<GLBackend>(stateCache_, frameUniforms_,
+                                         instanceBuffer_, jointPalette_);
+}
+
+void Engine::buildGeometryArenas() {
+  vertexArena_ = getResourceCache()->getVertexArena();
+  indexArena_ = resourceCache_->getIndexArena();
+  geometryVersion_ = resourceCache_->getGeometryVersion();
+}
+
+void Engine::processLoads() {
+  auto budget = std::max<size_t>(uploadBudget_, 1);
+  auto scenesChanged = false;
+  for (auto iterator = loads_.begin(); iterator != loads_.end();) {
+    auto &asset = **iterator;
+    if (asset.parsed.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      ++iterator;
+      continue;
+    }
+    if (!asset.parseSucceeded) {
+      asset.handle->setError(asset.error);
+      asset.handle->setState(LoadState::FAILED);
+      iterator = loads_.erase(iterator);
+      continue;
+    }
+    if (asset.uploadFrames == 0) {
+      for (auto &phase : asset.phases) {
+        profiler_.addEvent(phase.name, phase.start, phase.end, phase.thread);
+      }
+    }
+    asset.handle->setState(LoadState::UPLOADING);
+    auto unlimitedBudget = std::numeric_limits<size_t>::max();
+    auto uploadStart = ProfileClock::now();
+    auto uploaded =
+        uploadAsset(asset, asset.timeSliced ? budget : unlimitedBudget);
+    auto uploadEnd = ProfileClock::now();
+    asset.uploadMilliseconds += millisecondsBetween(uploadStart, uploadEnd);
+    ++asset.uploadFrames;
+    frameStats_.uploadMilliseconds +=
+        millisecondsBetween(uploadStart, uploadEnd);
+    if (!uploaded) {
+      ++iterator;
+      continue;
+    }
+    buildAsset(asset);
+    auto buildEnd = ProfileClock::now();
+    frameStats_.uploadMilliseconds += millisecondsBetween(uploadEnd, buildEnd);
+    frameStats_.completedLoads.push_back(
+        buildLoadTimings(asset, uploadEnd, buildEnd));
+    asset.handle->setProgress(1.0f);
+    asset.handle->setState(LoadState::READY);
+    assets_.push_back(*iterator);
+    iterator = loads_.erase(iterator);
+    scenesChanged = true;
+  }
+  if (scenesChanged) {
+    buildBVH();
+  }
+}
+
+// Uploads geometry range chunks and whole textures until the budget runs
+// out, at least one step per call. Returns true once everything is on the GPU.
+bool Engine::uploadAsset(Asset &asset, size_t &budget) {
+  const auto &model = asset.model;
+  if (asset.textures == nullptr) {
+    allocateGeometry(asset);
+    asset.textures =
+        std::make_shared<std::vector<GLuint>>(model.textures.size(), 0);
+  }
+  while (budget > 0 && asset.uploadedRanges < asset.geometryRanges.size()) {
+    const auto &range = asset.geometryRanges[asset.uploadedRanges];
+    const auto size = range.end - range.begin;
+    const auto *data = getGeometryRangeData(asset, range);
+    auto &offset = asset.uploadedRangeBytes;
+    auto chunkSize = std::min({UPLOAD_CHUNK_SIZE, size - offset, budget});
+    if (range.indices) {
+      indexArena_->upload(asset.indexAllocation, range.offset + offset,
+                          data + offset, chunkSize);
+    } else {
+      vertexArena_->upload(asset.vertexAllocation, range.offset + offset,
+                           data + offset, chunkSize);
+    }
+    if (range.optimizedGeometry < 0) {
+      asset.loader.evict(data + offset, chunkSize);
+    }
+    offset += chunkSize;
+    budget -= chunkSize;
+    asset.uploadedBytes += chunkSize;
+    if (offset == size) {
+      ++asset.uploadedRanges;
+      offset = 0;
+    }
+  }
+  if (asset.uploadedRanges == asset.geometryRanges.size() &&
+      !asset.geometryRanges.empty() && !asset.sharedGeometry) {
+    resourceCache_->addGeometry(asset.geometryKey, asset.vertexAllocation,
+                                asset.indexAllocation,
+                                asset.vertexBytes + asset.indexBytes);
+    asset.sharedGeometry = true;
+  }
+  while (budget > 0 && asset.uploadedTextures < asset.textures->size()) {
+    const auto textureIndex = asset.uploadedTextures;
+    const auto key = asset.textureKeys[textureIndex];
+    auto &glTexture = asset.textures->at(textureIndex);
+    glTexture = resourceCache_->acquireTexture(key);
+    if (glTexture == 0) {
+      GL_CHECK(glGenTextures(1, &glTexture));
+      resourceCache_->addTexture(key, glTexture,
+                                 buildTexture(model, textureIndex, glTexture));
+    }
+    const auto &texture = model.textures[textureIndex];
+    const auto bytes = model.images[texture.source].image.size();
+    budget -= std::min(bytes, budget);
+    asset.uploadedBytes += bytes;
+    ++asset.uploadedTextures;
+  }
+  if (asset.totalBytes > 0) {
+    asset.handle->setProgress(float(asset.uploadedBytes) / asset.totalBytes);
+  }
+  return asset.uploadedRanges == asset.geometryRanges.size() &&
+         asset.uploadedTextures == asset.textures->size();
 }
 
-std::shared_ptr<Node>
-Engine::buildNode(const tinygltf::Model &model, unsigned int nodeIndex,
-                  const std::shared_ptr<std::vector<GLuint>> &buffers,
-                  const std::shared_ptr<std::vector<GLuint>> &textures,
-                  std::shared_ptr<Node> parent) {
-  auto node = std::make_shared<Node>(parent);
-  auto nodeMatrix = model.nodes[nodeIndex].matrix;
+const unsigned char *Engine::getGeometryRangeData(Asset &asset,
+                                                  const GeometryRange &range) {
+  if (range.optimizedGeometry >= 0) {
+    const auto &geometry = asset.optimizedGeometries[range.optimizedGeometry];
+    return (range.indices ? geometry.indices : geometry.vertices).data();
+  }
+  return asset.loader.getBufferData(asset.model, range.buffer) + range.begin;
+}
+
+// One component of a KHR_mesh_quantization attribute, decoded as the vertex
+// fetch would.
+static float readComponent(const unsigned char *data, int componentType,
+                           bool normalized) {
+  switch (componentType) {
+  case TINYGLTF_COMPONENT_TYPE_BYTE:
+    return normalized ? std::max(*(const int8_t *)data / 127.0f, -1.0f)
+                      : *(const int8_t *)data;
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return normalized ? *data / 255.0f : *data;
+  case TINYGLTF_COMPONENT_TYPE_SHORT: {
+    int16_t value;
+    memcpy(&value, data, sizeof(value));
+    return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+  }
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return normalized ? value / 65535.0f : value;
+  }
+  default: {
+    float value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  }
+}
+
+// Whether the accessor's buffer view exists and all of its elements lie
+// within the view's buffer.
+static bool isAccessorInBounds(Asset &asset,
+                               const tinygltf::Accessor &accessor) {
+  const auto &model = asset.model;
+  if (accessor.bufferView < 0 ||
+      accessor.bufferView >= model.bufferViews.size()) {
+    return false;
+  }
+  const auto &bufferView = model.bufferViews[accessor.bufferView];
+  if (bufferView.buffer < 0 || bufferView.buffer >= model.buffers.size()) {
+    return false;
+  }
+  const auto componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+  const auto componentSize =
+      tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const auto stride = accessor.ByteStride(bufferView);
+  if (componentCount <= 0 || componentSize <= 0 || stride <= 0) {
+    return false;
+  }
+  const auto elementSize = size_t(componentCount) * componentSize;
+  const auto first = bufferView.byteOffset + accessor.byteOffset;
+  const auto size = asset.loader.getBufferSize(model, bufferView.buffer);
+  if (first < bufferView.byteOffset || first > size ||
+      elementSize > size - first) {
+    return false;
+  }
+  return accessor.count == 0 ||
+         accessor.count - 1 <= (size - first - elementSize) / stride;
+}
+
+// First byte of a non-sparse accessor whose elements all lie within its
+// buffer, or null when it cannot be read in place.
+static const unsigned char *getAccessorData(Asset &asset, int accessorIndex) {
+  const auto &model = asset.model;
+  if (accessorIndex < 0 || accessorIndex >= model.accessors.size()) {
+    return nullptr;
+  }
+  const auto &accessor = model.accessors[accessorIndex];
+  if (accessor.sparse.isSparse || !isAccessorInBounds(asset, accessor)) {
+    return nullptr;
+  }
+  const auto &bufferView = model.bufferViews[accessor.bufferView];
+  return asset.loader.getBufferData(model, bufferView.buffer) +
+         bufferView.byteOffset + accessor.byteOffset;
+}
+
+// Whether every accessor the primitive names can be read from its buffer.
+// Attributes without a buffer view stay unbound, indices need one.
+static bool hasValidAccessors(Asset &asset,
+                              const tinygltf::Primitive &primitive) {
+  const auto &accessors = asset.model.accessors;
+  if (primitive.attributes.empty()) {
+    return false;
+  }
+  for (auto &attribute : primitive.attributes) {
+    if (attribute.second < 0 || attribute.second >= accessors.size() ||
+        (accessors[attribute.second].bufferView >= 0 &&
+         !isAccessorInBounds(asset, accessors[attribute.second]))) {
+      return false;
+    }
+  }
+  return primitive.indices < 0 ||
+         (primitive.indices < accessors.size() &&
+          isAccessorInBounds(asset, accessors[primitive.indices]));
+}
+
+// All components of a non-sparse accessor as floats, decoded as the vertex
+// fetch would, or an empty list when it cannot be read.
+static std::vector<float> readAccessor(Asset &asset, int accessorIndex) {
+  std::vector<float> values;
+  const auto *data = getAccessorData(asset, accessorIndex);
+  if (!data) {
+    return values;
+  }
+  const auto &model = asset.model;
+  const auto &accessor = model.accessors[accessorIndex];
+  const auto componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+  const auto componentSize =
+      tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const auto stride =
+      accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+  values.resize(accessor.count * componentCount);
+  for (auto i = 0; i < accessor.count; ++i) {
+    for (auto c = 0; c < componentCount; ++c) {
+      values[i * componentCount + c] =
+          readComponent(data + i * stride + c * componentSize,
+                        accessor.componentType, accessor.normalized);
+    }
+  }
+  return values;
+}
+
+// Compact format of a float attribute when vertices are quantized.
+static VertexEncoding getVertexEncoding(const std::string &attribute,
+                                        int type) {
+  if (attribute == "POSITION" && type == TINYGLTF_TYPE_VEC3) {
+    return VertexEncoding::POSITION;
+  }
+  if (attribute == "NORMAL" && type == TINYGLTF_TYPE_VEC3) {
+    return VertexEncoding::NORMAL;
+  }
+  if (attribute.compare(0, 9, "TEXCOORD_") == 0 &&
+      type == TINYGLTF_TYPE_VEC2) {
+    return VertexEncoding::TEXCOORD;
+  }
+  return VertexEncoding::COPY;
+}
+
+// Offset of the accessor's first element in the asset's vertex or index
+// allocation.
+static size_t geometryOffset(const Asset &asset,
+                             const tinygltf::Accessor &accessor,
+                             bool indices) {
+  const auto &bufferView = asset.model.bufferViews[accessor.bufferView];
+  const auto rangeIndex = (indices ? asset.indexRanges
+                                   : asset.vertexRanges)[accessor.bufferView];
+  const auto &range = asset.geometryRanges[rangeIndex];
+  return range.offset + bufferView.byteOffset + accessor.byteOffset -
+         range.begin;
+}
+
+// Collects the bytes of the accessors the renderer reads, one range per buffer
+// view and use, lays them out in the asset's vertex and index allocations and
+// hashes them into the asset's geometry key. Whatever else the buffers hold,
+// embedded images, animation data or unused attributes, never reaches the
+// GPU.
+void Engine::prepareGeometryRanges(
+    Asset &asset,
+    const std::vector<std::pair<std::string, GLuint>> &attributes) {
+  const auto &model = asset.model;
+  asset.vertexRanges.assign(model.bufferViews.size(), -1);
+  asset.indexRanges.assign(model.bufferViews.size(), -1);
+  auto addAccessor = [&](int accessorIndex, bool indices) {
+    if (accessorIndex < 0 || accessorIndex >= model.accessors.size()) {
+      return;
+    }
+    const auto &accessor = model.accessors[accessorIndex];
+    if (accessor.bufferView < 0 || accessor.count == 0) {
+      return;
+    }
+    const auto &bufferView = model.bufferViews[accessor.bufferView];
+    const auto stride = accessor.ByteStride(bufferView);
+    const auto elementSize =
+        tinygltf::GetComponentSizeInBytes(accessor.componentType) *
+        tinygltf::GetNumComponentsInType(accessor.type);
+    // Ranges start on a 4 byte boundary of the source so that copying them to
+    // aligned offsets keeps every accessor in them aligned.
+    const auto first = bufferView.byteOffset + accessor.byteOffset;
+    const auto begin = first & ~size_t(3);
+    const auto end =
+        first + size_t(stride) * (accessor.count - 1) + elementSize;
+    auto &rangeIndex =
+        (indices ? asset.indexRanges : asset.vertexRanges)[accessor.bufferView];
+    if (rangeIndex < 0) {
+      rangeIndex = asset.geometryRanges.size();
+      asset.geometryRanges.push_back({bufferView.buffer, begin, end, 0,
+                                      indices, -1});
+    }
+    auto &range = asset.geometryRanges[rangeIndex];
+    range.begin = std::min(range.begin, begin);
+    range.end = std::max(range.end, end);
+  };
+  for (auto i = 0; i < model.meshes.size(); ++i) {
+    for (auto j = 0; j < model.meshes[i].primitives.size(); ++j) {
+      const auto &primitive = model.meshes[i].primitives[j];
+      if (getOptimizedGeometry(asset, i, j) >= 0 ||
+          !hasValidAccessors(asset, primitive)) {
+        continue;
+      }
+      for (auto &attribute : attributes) {
+        const auto iterator = primitive.attributes.find(attribute.first);
+        if (iterator != primitive.attributes.end()) {
+          addAccessor((*iterator).second, false);
+        }
+      }
+      addAccessor(primitive.indices, true);
+    }
+  }
+  for (auto i = 0; i < asset.optimizedGeometries.size(); ++i) {
+    const auto &geometry = asset.optimizedGeometries[i];
+    asset.optimizedRanges.push_back(asset.geometryRanges.size());
+    asset.geometryRanges.push_back(
+        {-1, 0, geometry.vertices.size(), 0, false, i});
+    asset.geometryRanges.push_back(
+        {-1, 0, geometry.indices.size(), 0, true, i});
+  }
+  auto key = hashBytes(nullptr, 0);
+  for (auto &range : asset.geometryRanges) {
+    auto &bytes = range.indices ? asset.indexBytes : asset.vertexBytes;
+    const auto size = range.end - range.begin;
+    range.offset = bytes;
+    bytes = (bytes + size + 3) & ~size_t(3);
+    asset.totalBytes += size;
+    const uint64_t layout[] = {range.indices, range.offset, size};
+    key = hashBytes(layout, sizeof(layout), key);
+    const auto *data = getGeometryRangeData(asset, range);
+    key = hashBytes(data, size, key);
+    if (range.optimizedGeometry < 0) {
+      asset.loader.evict(data, size);
+    }
+  }
+  asset.geometryKey = key;
+}
+
+// Reserves the asset's space in the vertex and index arenas, or takes the
+// allocations of identical geometry another asset already uploaded.
+void Engine::allocateGeometry(Asset &asset) {
+  if (asset.geometryRanges.empty()) {
+    return;
+  }
+  if (resourceCache_->acquireGeometry(asset.geometryKey,
+                                      asset.vertexAllocation,
+                                      asset.indexAllocation)) {
+    asset.sharedGeometry = true;
+    asset.uploadedRanges = asset.geometryRanges.size();
+    asset.uploadedBytes += asset.vertexBytes + asset.indexBytes;
+    return;
+  }
+  if (asset.vertexBytes > 0) {
+    asset.vertexAllocation = vertexArena_->allocate(asset.vertexBytes);
+  }
+  if (asset.indexBytes > 0) {
+    asset.indexAllocation = indexArena_->allocate(asset.indexBytes);
+  }
+}
+
+void Engine::bindGeometry(const Asset &asset, const GeometryBinding &binding) {
+  GL_CHECK(glBindVertexArray(binding.vao));
+  if (!binding.attributes.empty()) {
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER,
+                          vertexArena_->getBuffer(asset.vertexAllocation)));
+  }
+  const auto base = binding.attributes.empty()
+                        ? 0
+                        : vertexArena_->getOffset(asset.vertexAllocation);
+  for (auto &attribute : binding.attributes) {
+    GL_CHECK(glEnableVertexAttribArray(attribute.location));
+    GL_CHECK(glVertexAttribPointer(
+        attribute.location, attribute.size, attribute.type,
+        attribute.normalized, attribute.stride,
+        (const GLvoid *)(base + attribute.offset)));
+  }
+  if (binding.indexed) {
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                          indexArena_->getBuffer(asset.indexAllocation)));
+  }
+}
+
+void Engine::releaseAsset(Asset &asset) {
+  for (auto &scene : asset.scenes) {
+    scene->traverse([this](std::shared_ptr<Node> node) {
+      transformStore_->remove(node->getTransformIndex());
+    });
+    scenes_.erase(std::remove(scenes_.begin(), scenes_.end(), scene),
+                  scenes_.end());
+  }
+  asset.scenes.clear();
+  for (auto &instance : asset.animationInstances) {
+    animationInstances_.erase(std::remove(animationInstances_.begin(),
+                                          animationInstances_.end(), instance),
+                              animationInstances_.end());
+  }
+  asset.animationInstances.clear();
+  for (auto &binding : asset.geometryBindings) {
+    GL_CHECK(glDeleteVertexArrays(1, &binding.vao));
+  }
+  asset.geometryBindings.clear();
+  asset.indexBindings.clear();
+  if (asset.textures != nullptr) {
+    for (auto texture : *asset.textures) {
+      resourceCache_->releaseTexture(texture);
+    }
+    asset.textures->clear();
+  }
+  if (asset.sharedGeometry) {
+    resourceCache_->releaseGeometry(asset.geometryKey);
+    asset.sharedGeometry = false;
+    asset.vertexAllocation = GeometryArena::NO_ALLOCATION;
+    asset.indexAllocation = GeometryArena::NO_ALLOCATION;
+  }
+  if (asset.vertexAllocation != GeometryArena::NO_ALLOCATION) {
+    vertexArena_->free(asset.vertexAllocation);
+    asset.vertexAllocation = GeometryArena::NO_ALLOCATION;
+  }
+  if (asset.indexAllocation != GeometryArena::NO_ALLOCATION) {
+    indexArena_->free(asset.indexAllocation);
+    asset.indexAllocation = GeometryArena::NO_ALLOCATION;
+  }
+}
+
+Asset *Engine::findAsset(const std::shared_ptr<LoadHandle> &handle) {
+  for (auto &asset : assets_) {
+    if (asset->handle == handle) {
+      return asset.get();
+    }
+  }
+  return nullptr;
+}
+
+LoadTimings Engine::buildLoadTimings(const Asset &asset,
+                                     ProfileClock::time_point buildStart,
+                                     ProfileClock::time_point buildEnd) {
+  LoadTimings timings;
+  timings.path = asset.path;
+  for (auto &phase : asset.phases) {
+    auto milliseconds = millisecondsBetween(phase.start, phase.end);
+    if (std::strcmp(phase.name, "parse") == 0) {
+      timings.parseMilliseconds += milliseconds;
+    } else if (std::strcmp(phase.name, "decode images") == 0) {
+      timings.decodeMilliseconds += milliseconds;
+      timings.parseMilliseconds -= milliseconds;
+    } else if (std::strcmp(phase.name, "collision") == 0) {
+      timings.collisionMilliseconds += milliseconds;
+    } else if (std::strcmp(phase.name, "optimize geometry") == 0) {
+      timings.optimizeMilliseconds += milliseconds;
+    }
+  }
+  timings.uploadMilliseconds = asset.uploadMilliseconds;
+  timings.buildMilliseconds = millisecondsBetween(buildStart, buildEnd);
+  timings.totalMilliseconds = millisecondsBetween(asset.queued, buildEnd);
+  timings.uploadFrames = asset.uploadFrames;
+  return timings;
+}
+
+static glm::mat4 getNodeMatrix(const tinygltf::Node &node) {
   glm::mat4 matrix(1.0f);
-  if (nodeMatrix.size() == 16) {
-    matrix[0].x = nodeMatrix[0], matrix[0].y = nodeMatrix[1],
-    matrix[0].z = nodeMatrix[2], matrix[0].w = nodeMatrix[3];
-    matrix[1].x = nodeMatrix[4], matrix[1].y = nodeMatrix[5],
-    matrix[1].z = nodeMatrix[6], matrix[1].w = nodeMatrix[7];
-    matrix[2].x = nodeMatrix[8], matrix[2].y = nodeMatrix[9],
-    matrix[2].z = nodeMatrix[10], matrix[2].w = nodeMatrix[11];
-    matrix[3].x = nodeMatrix[12], matrix[3].y = nodeMatrix[13],
-    matrix[3].z = nodeMatrix[14], matrix[3].w = nodeMatrix[15];
+  if (node.matrix.size() == 16) {
+    for (auto i = 0; i < 16; ++i) {
+      matrix[i / 4][i % 4] = node.matrix[i];
+    }
+    return matrix;
+  }
+  if (node.translation.size() == 3) {
+    matrix = glm::translate(matrix,
+                            glm::vec3(node.translation[0], node.translation[1],
+                                      node.translation[2]));
+  }
+  if (node.rotation.size() == 4) {
+    matrix *= glm::mat4_cast(glm::quat(node.rotation[3], node.rotation[0],
+                                       node.rotation[1], node.rotation[2]));
+  }
+  if (node.scale.size() == 3) {
+    matrix = glm::scale(
+        matrix, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+  }
+  return matrix;
+}
+
+void Engine::buildAsset(Asset &asset) {
+  auto meshes = buildMeshes(asset);
+  const auto &nodes = asset.model.nodes;
+  asset.nodeMatrices.resize(nodes.size());
+  getJobSystem()->parallelFor(nodes.size(), NODE_GRAIN_SIZE,
+                              [&](unsigned int begin, unsigned int end) {
+                                for (auto i = begin; i < end; ++i) {
+                                  asset.nodeMatrices[i] =
+                                      getNodeMatrix(nodes[i]);
+                                }
+                              });
+  asset.nodeTransforms.assign(nodes.size(), -1);
+  for (auto i = 0; i < asset.model.scenes.size(); ++i) {
+    asset.scenes.push_back(buildScene(asset, i, meshes));
+    scenes_.push_back(asset.scenes.back());
+  }
+  buildSkins(asset);
+  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  releaseHostData(asset);
+}
+
+void Engine::queryCompressedTextureFormats() {
+  GLint formatCount = 0;
+  GL_CHECK(glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &formatCount));
+  compressedTextureFormats_.resize(formatCount);
+  GL_CHECK(glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS,
+                         compressedTextureFormats_.data()));
+}
+
+// Returns the bytes the texture occupies on the GPU, mip chain included.
+size_t Engine::buildTexture(const tinygltf::Model &model,
+                            unsigned int textureIndex, GLuint texture) {
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  const auto &gltfTexture = model.textures[textureIndex];
+  const auto &image = model.images[gltfTexture.source];
+  const auto sampler = gltfTexture.sampler;
+  auto minFilter = sampler >= 0 && model.samplers[sampler].minFilter != -1
+                       ? model.samplers[sampler].minFilter
+                       : GL_LINEAR;
+  auto magFilter = sampler >= 0 && model.samplers[sampler].magFilter != -1
+                       ? model.samplers[sampler].magFilter
+                       : GL_LINEAR;
+  auto wrapS = sampler >= 0 ? model.samplers[sampler].wrapS : GL_REPEAT;
+  auto wrapT = sampler >= 0 ? model.samplers[sampler].wrapT : GL_REPEAT;
+  auto levelCount = 1u;
+  auto canGenerateMipmap = true;
+  size_t bytes = 0;
+  if (image.mimeType == KTX2_MIME_TYPE) {
+    levelCount = buildKTX2Texture(image, canGenerateMipmap, bytes);
   } else {
-    if (model.nodes[nodeIndex].translation.size() == 3) {
-      glm::translate(matrix, glm::vec3(model.nodes[nodeIndex].translation[0],
-                                       model.nodes[nodeIndex].translation[1],
-                                       model.nodes[nodeIndex].translation[2]));
+    bytes = size_t(image.width) * image.height * 4;
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width,
+                          image.height, 0, GL_RGBA, image.pixel_type,
+                          image.image.data()));
+  }
+  auto mipmapped = minFilter == GL_NEAREST_MIPMAP_NEAREST ||
+                   minFilter == GL_NEAREST_MIPMAP_LINEAR ||
+                   minFilter == GL_LINEAR_MIPMAP_NEAREST ||
+                   minFilter == GL_LINEAR_MIPMAP_LINEAR;
+  if (mipmapped && levelCount == 1 && !canGenerateMipmap) {
+    minFilter = GL_LINEAR;
+  }
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT));
+  if (levelCount > 1) {
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                             levelCount - 1));
+  } else if (mipmapped && canGenerateMipmap) {
+    GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+    bytes += bytes / 3;
+  }
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  return bytes;
+}
+
+// Uploads the prebuilt mip chain of a KTX2 image to the bound texture and
+// returns the number of levels. ETC2 payloads the driver does not list are
+// decoded on the CPU, other unsupported formats leave a white texel.
+unsigned int Engine::buildKTX2Texture(const tinygltf::Image &image,
+                                      bool &canGenerateMipmap,
+                                      size_t &bytes) {
+  KTX2 ktx2;
+  ktx2.parse(image.image.data(), image.image.size());
+  const auto internalFormat = ktx2.getInternalFormat();
+  const auto supported =
+      !ktx2.isCompressed() ||
+      std::find(compressedTextureFormats_.begin(),
+                compressedTextureFormats_.end(),
+                GLint(internalFormat)) != compressedTextureFormats_.end();
+  if (!supported && !ktx2.isETC2()) {
+    std::cout << "Unsupported compressed texture format = " << std::hex
+              << internalFormat << std::dec << std::endl;
+    const unsigned char white[] = {255, 255, 255, 255};
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                          GL_UNSIGNED_BYTE, white));
+    bytes = sizeof(white);
+    return 1;
+  }
+  canGenerateMipmap = !ktx2.isCompressed() || !supported;
+  std::vector<unsigned char> decoded;
+  for (auto level = 0; level < ktx2.getLevelCount(); ++level) {
+    auto width = std::max(1u, ktx2.getWidth() >> level);
+    auto height = std::max(1u, ktx2.getHeight() >> level);
+    const auto &data = ktx2.getLevel(level);
+    bytes += supported ? data.size : size_t(width) * height * 4;
+    if (!ktx2.isCompressed()) {
+      GL_CHECK(glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width,
+                            height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data));
+    } else if (supported) {
+      GL_CHECK(glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat,
+                                      width, height, 0, data.size,
+                                      data.data));
+    } else {
+      decodeETC2(internalFormat, data.data, data.size, width, height,
+                 decoded);
+      GL_CHECK(glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0,
+                            GL_RGBA, GL_UNSIGNED_BYTE, decoded.data()));
     }
-    if (model.nodes[nodeIndex].rotation.size() == 4) {
-      matrix *= glm::mat4_cast(glm::quat(model.nodes[nodeIndex].rotation[3],
-                                         model.nodes[nodeIndex].rotation[0],
-                                         model.nodes[nodeIndex].rotation[1],
-                                         model.nodes[nodeIndex].rotation[2]));
+  }
+  return ktx2.getLevelCount();
+}
+
+void Engine::releaseHostData(Asset &asset) {
+  asset.loader.release();
+  for (auto &buffer : asset.model.buffers) {
+    std::vector<unsigned char>().swap(buffer.data);
+  }
+  for (auto &image : asset.model.images) {
+    std::vector<unsigned char>().swap(image.image);
+  }
+  std::vector<std::vector<CollisionGeometry>>().swap(
+      asset.collisionGeometries);
+  std::vector<std::vector<glm::mat4>>().swap(asset.inverseBindMatrices);
+  std::vector<std::vector<float>>().swap(asset.jointRadii);
+  std::vector<glm::mat4>().swap(asset.nodeMatrices);
+  std::map<std::vector<int>, GLuint>().swap(asset.vertexArrays);
+  std::vector<OptimizedGeometry>().swap(asset.optimizedGeometries);
+  std::vector<std::vector<int>>().swap(asset.primitiveGeometries);
+}
+
+// Also lays out the joint palette, the joints of each skinned node after
+// those of the one before.
+void Engine::buildBVH() {
+  bvhNodes_.clear();
+  skinnedNodes_.clear();
+  primitiveCount_ = 0;
+  jointCount_ = 0;
+  for (auto &scene : scenes_) {
+    scene->traverse([&](const std::shared_ptr<Node> &node) {
+      if (node->getMesh() != nullptr) {
+        bvhNodes_.push_back(node);
+        primitiveCount_ += node->getMesh()->getPrimitives().size();
+      }
+      if (node->getSkin() != nullptr) {
+        node->setJointOffset(jointCount_);
+        jointCount_ += node->getSkin()->getJointCount();
+        skinnedNodes_.push_back(node);
+      }
+    });
+  }
+  updateTransforms();
+  bvhTransformVersion_ = transformStore_->getVersion();
+  updateSkins();
+  computeBVHBounds();
+  bvh_.build(bvhMins_, bvhMaxs_);
+}
+
+// Applies the advanced animations and refreshes the dirty world matrices. A
+// frame does this on its own thread before any of its jobs run, afterwards
+// the store is only read.
+void Engine::updateTransforms() {
+  evaluateAnimations();
+  transformStore_->update(getJobSystem().get());
+}
+
+void Engine::updateBVH() {
+  updateTransforms();
+  if (bvhTransformVersion_ == transformStore_->getVersion()) {
+    return;
+  }
+  bvhTransformVersion_ = transformStore_->getVersion();
+  updateSkins();
+  computeBVHBounds();
+  bvh_.refit(bvhMins_, bvhMaxs_);
+}
+
+// Samples the instances advanced since the last call in parallel, each into
+// its own matrices, then writes those to the transform store in order.
+void Engine::evaluateAnimations() {
+  if (!animationsAdvanced_) {
+    return;
+  }
+  PROFILE_SCOPE(profiler_, "animation");
+  animationsAdvanced_ = false;
+  getJobSystem()->parallelFor(
+      animationInstances_.size(), ANIMATION_GRAIN_SIZE,
+      [this](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          animationInstances_[i]->evaluate();
+        }
+      });
+  for (auto &instance : animationInstances_) {
+    instance->apply(*transformStore_);
+  }
+}
+
+// Joint matrices and bounds of every skinned node, computed in parallel from
+// the updated world matrices, for the next recorded frame to upload at once.
+void Engine::updateSkins() {
+  if (skinnedNodes_.empty()) {
+    return;
+  }
+  PROFILE_SCOPE(profiler_, "skinning");
+  const auto rowCount =
+      (jointCount_ + JOINT_PALETTE_ROW_JOINTS - 1) / JOINT_PALETTE_ROW_JOINTS;
+  jointRows_.resize(rowCount * JOINT_PALETTE_ROW_JOINTS * 3);
+  getJobSystem()->parallelFor(
+      skinnedNodes_.size(), SKIN_GRAIN_SIZE,
+      [this](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          const auto &node = skinnedNodes_[i];
+          node->getSkin()->update(
+              *transformStore_, node->getWorldMatrix(),
+              glm::value_ptr(jointRows_[node->getJointOffset() * 3]));
+        }
+      });
+  jointRowsDirty_ = true;
+}
+
+void Engine::computeBVHBounds() {
+  bvhMins_.resize(bvhNodes_.size());
+  bvhMaxs_.resize(bvhNodes_.size());
+  for (auto i = 0; i < bvhNodes_.size(); ++i) {
+    const auto &skin = bvhNodes_[i]->getSkin();
+    if (skin != nullptr) {
+      bvhMins_[i] = skin->getBoundsMin();
+      bvhMaxs_[i] = skin->getBoundsMax();
+      continue;
     }
-    if (model.nodes[nodeIndex].scale.size() == 3) {
-      glm::scale(matrix, glm::vec3(model.nodes[nodeIndex].scale[0],
-                                   model.nodes[nodeIndex].scale[1],
-                                   model.nodes[nodeIndex].scale[2]));
+    const auto &worldMatrix = bvhNodes_[i]->getWorldMatrix();
+    glm::vec3 min(1e30f), max(-1e30f);
+    for (auto &primitive : bvhNodes_[i]->getMesh()->getPrimitives()) {
+      glm::vec3 center, extent;
+      Frustum::transformBounds(worldMatrix, primitive->getBoundsMin(),
+                               primitive->getBoundsMax(), center, extent);
+      min = glm::min(min, center - extent);
+      max = glm::max(max, center + extent);
     }
+    bvhMins_[i] = min;
+    bvhMaxs_[i] = max;
   }
-  node->setMatrix(matrix);
+}
+
+std::shared_ptr<Scene> Engine::buildScene(
+    Asset &asset, unsigned int sceneIndex,
+    const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes) {
+  const auto &model = asset.model;
+  auto scene = std::make_shared<triangle::Scene>();
+  for (auto i = 0; i < model.scenes[sceneIndex].nodes.size(); ++i) {
+    scene->addNode(buildNode(asset, model.scenes[sceneIndex].nodes[i], meshes));
+  }
+  return scene;
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Mesh>>>
+Engine::buildMeshes(Asset &asset) {
+  auto meshes = std::make_shared<std::vector<std::shared_ptr<Mesh>>>(
+      asset.model.meshes.size());
+  for (auto i = 0; i < meshes->size(); ++i) {
+    meshes->at(i) = buildMesh(asset, i);
+  }
+  return meshes;
+}
+
+// Animations drive the first node built for a glTF node, scenes sharing it
+// get still copies.
+std::shared_ptr<Node> Engine::buildNode(
+    Asset &asset, unsigned int nodeIndex,
+    const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes,
+    std::shared_ptr<Node> parent) {
+  const auto &model = asset.model;
+  auto node = std::make_shared<Node>(transformStore_, parent);
+  if (asset.nodeTransforms[nodeIndex] < 0) {
+    asset.nodeTransforms[nodeIndex] = node->getTransformIndex();
+  }
+  node->setMatrix(asset.nodeMatrices[nodeIndex]);
   if (model.nodes[nodeIndex].mesh >= 0) {
-    node->setMesh(
-        buildMesh(model, model.nodes[nodeIndex].mesh, buffers, textures));
+    node->setMesh(meshes->at(model.nodes[nodeIndex].mesh));
+    buildLodMeshes(model, nodeIndex, meshes, *node);
+    if (model.nodes[nodeIndex].skin >= 0 &&
+        model.nodes[nodeIndex].skin < model.skins.size()) {
+      asset.skinnedNodes.emplace_back(node, nodeIndex);
+    }
   }
   for (auto &childNodeIndex : model.nodes[nodeIndex].children) {
-    node->addChild(buildNode(model, childNodeIndex, buffers, textures, node));
+    node->addChild(buildNode(asset, childNodeIndex, meshes, node));
   }
   return node;
 }
 
-std::shared_ptr<Mesh>
-Engine::buildMesh(const tinygltf::Model &model, unsigned int meshIndex,
-                  const std::shared_ptr<std::vector<GLuint>> &buffers,
-                  const std::shared_ptr<std::vector<GLuint>> &textures) {
+// Runs once every scene is built, joints may come after the meshes they move.
+// Joints in no scene follow the mesh node itself.
+void Engine::buildSkins(Asset &asset) {
+  const auto &model = asset.model;
+  for (auto &skinnedNode : asset.skinnedNodes) {
+    const auto skinIndex = model.nodes[skinnedNode.second].skin;
+    const auto &gltfSkin = model.skins[skinIndex];
+    std::vector<unsigned int> joints;
+    for (auto joint : gltfSkin.joints) {
+      const auto transform = joint >= 0 && joint < model.nodes.size()
+                                 ? asset.nodeTransforms[joint]
+                                 : -1;
+      joints.push_back(transform >= 0
+                           ? transform
+                           : skinnedNode.first->getTransformIndex());
+    }
+    skinnedNode.first->setSkin(std::make_shared<Skin>(
+        std::move(joints), asset.inverseBindMatrices[skinIndex],
+        asset.jointRadii[skinnedNode.second]));
+  }
+  std::vector<std::pair<std::shared_ptr<Node>, int>>().swap(
+      asset.skinnedNodes);
+}
+
+// MSFT_lod lists the nodes whose meshes are the coarser levels, only their
+// meshes are used. The MSFT_screencoverage extra holds the screen coverage
+// each level is drawn down to.
+void Engine::buildLodMeshes(
+    const tinygltf::Model &model, unsigned int nodeIndex,
+    const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes,
+    Node &node) {
+  const auto &gltfNode = model.nodes[nodeIndex];
+  const auto extension = gltfNode.extensions.find("MSFT_lod");
+  if (extension == gltfNode.extensions.end()) {
+    return;
+  }
+  std::vector<std::shared_ptr<Mesh>> lodMeshes{node.getMesh()};
+  const auto &ids = extension->second.Get("ids");
+  for (auto i = 0; i < ids.ArrayLen(); ++i) {
+    const auto lodNodeIndex = ids.Get(i).GetNumberAsInt();
+    if (lodNodeIndex >= 0 && lodNodeIndex < model.nodes.size() &&
+        model.nodes[lodNodeIndex].mesh >= 0) {
+      lodMeshes.push_back(meshes->at(model.nodes[lodNodeIndex].mesh));
+    }
+  }
+  std::vector<float> screenCoverages;
+  const auto &coverages = gltfNode.extras.Get("MSFT_screencoverage");
+  for (auto i = 0; i < coverages.ArrayLen(); ++i) {
+    screenCoverages.push_back(coverages.Get(i).GetNumberAsDouble());
+  }
+  if (lodMeshes.size() > 1) {
+    node.setLodMeshes(std::move(lodMeshes), std::move(screenCoverages));
+  }
+}
+
+std::shared_ptr<Mesh> Engine::buildMesh(Asset &asset,
+                                        unsigned int meshIndex) {
   auto meshPrimitives =
       std::make_shared<std::vector<std::shared_ptr<Primitive>>>();
-  const auto &primitives = model.meshes[meshIndex].primitives;
-  auto vaos = std::make_shared<std::vector<GLuint>>(primitives.size());
-  GL_CHECK(glGenVertexArrays(vaos->size(), vaos->data()));
+  const auto &primitives = asset.model.meshes[meshIndex].primitives;
   for (auto i = 0; i < primitives.size(); ++i) {
-    GL_CHECK(glBindVertexArray(vaos->at(i)));
-    meshPrimitives->push_back(
-        buildPrimitive(model, meshIndex, i, vaos, buffers, textures));
+    if (!hasValidAccessors(asset, primitives[i])) {
+      continue;
+    }
+    auto vao = buildVertexArray(asset, meshIndex, i);
+    meshPrimitives->push_back(buildPrimitive(asset, meshIndex, i, vao));
   }
   GL_CHECK(glBindVertexArray(0));
   return std::make_shared<Mesh>(meshPrimitives);
 }
 
-std::shared_ptr<Material>
-Engine::buildMaterial(const tinygltf::Model &model, unsigned int materialIndex,
-                      const std::shared_ptr<std::vector<GLuint>> &textures) {
-  auto baseColorIndex = model.materials[materialIndex]
-                            .pbrMetallicRoughness.baseColorTexture.index;
-  auto baseColorTexture =
-      (baseColorIndex >= 0 ? textures->at(baseColorIndex)
-                           : buildDefaultBaseColorTexture(model));
-  const auto baseColorTextureLocation = GL_CHECK(
-      glGetUniformLocation(program_->getProgram(), UNIFORM_BASE_COLOR_TEXTURE));
-  return std::make_shared<Material>(baseColorTexture, baseColorTextureLocation);
-}
-
-std::shared_ptr<Primitive>
-Engine::buildPrimitive(const tinygltf::Model &model, unsigned int meshIndex,
-                       unsigned int primitiveIndex,
-                       const std::shared_ptr<std::vector<GLuint>> &vaos,
-                       const std::shared_ptr<std::vector<GLuint>> &buffers,
-                       const std::shared_ptr<std::vector<GLuint>> &textures) {
+// Primitives reading the same accessors, or the same optimized geometry,
+// share one vertex array. Its element buffer is the index arena page, so the
+// index offset stays per primitive.
+GLuint Engine::buildVertexArray(Asset &asset, unsigned int meshIndex,
+                                unsigned int primitiveIndex) {
+  const auto &model = asset.model;
   const auto &primitive = model.meshes[meshIndex].primitives[primitiveIndex];
-  for (auto &attribute : preDefinedAttributes) {
-    const auto &attributeName = attribute.first;
-    const auto &attributeLocation = attribute.second;
-    const auto iterator = primitive.attributes.find(attributeName);
-    if (iterator == primitive.attributes.end()) {
-      continue;
+  GeometryBinding binding;
+  binding.indexed = primitive.indices >= 0;
+  std::vector<int> key{primitive.indices >= 0};
+  const auto optimizedGeometry =
+      getOptimizedGeometry(asset, meshIndex, primitiveIndex);
+  if (optimizedGeometry >= 0) {
+    const auto &geometry = asset.optimizedGeometries[optimizedGeometry];
+    const auto &range =
+        asset.geometryRanges[asset.optimizedRanges[optimizedGeometry]];
+    key = {-1, optimizedGeometry};
+    for (auto &attribute : geometry.attributes) {
+      binding.attributes.push_back(
+          {attribute.location, attribute.size, attribute.type,
+           attribute.normalized, geometry.stride,
+           range.offset + attribute.offset});
     }
-    const auto &accessor = model.accessors[(*iterator).second];
-    const auto &bufferView = model.bufferViews[accessor.bufferView];
-    const auto bufferIdx = bufferView.buffer;
+  } else {
+    for (auto &attribute : preDefinedAttributes) {
+      const auto iterator = primitive.attributes.find(attribute.first);
+      if (iterator == primitive.attributes.end() || (*iterator).second < 0 ||
+          (*iterator).second >= model.accessors.size()) {
+        key.push_back(-1);
+        continue;
+      }
+      const auto &accessor = model.accessors[(*iterator).second];
+      key.push_back((*iterator).second);
+      if (accessor.bufferView < 0 ||
+          asset.vertexRanges[accessor.bufferView] < 0) {
+        continue;
+      }
+      const auto &bufferView = model.bufferViews[accessor.bufferView];
+      binding.attributes.push_back(
+          {attribute.second, accessor.type, GLenum(accessor.componentType),
+           GLboolean(accessor.normalized), GLsizei(bufferView.byteStride),
+           geometryOffset(asset, accessor, false)});
+    }
+  }
+  auto &vao = asset.vertexArrays[key];
+  if (vao != 0) {
+    return vao;
+  }
+  GL_CHECK(glGenVertexArrays(1, &vao));
+  binding.vao = vao;
+  bindGeometry(asset, binding);
+  const auto hasLocation = [&](GLuint location) {
+    return std::any_of(binding.attributes.begin(), binding.attributes.end(),
+                       [&](const VertexAttributeBinding &attribute) {
+                         return attribute.location == location;
+                       });
+  };
+  InstanceBuffer::enableAttributes(hasLocation(ATTRIBUTE_JOINTS_0) &&
+                                   hasLocation(ATTRIBUTE_WEIGHTS_0));
+  asset.geometryBindings.push_back(std::move(binding));
+  return vao;
+}
 
-    GL_CHECK(glEnableVertexAttribArray(attributeLocation));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffers->at(bufferIdx)));
+static bool hasAttribute(const tinygltf::Model &model,
+                         const tinygltf::Primitive &primitive,
+                         const std::string &name) {
+  auto iterator = primitive.attributes.find(name);
+  return iterator != primitive.attributes.end() && iterator->second >= 0 &&
+         iterator->second < model.accessors.size() &&
+         model.accessors[iterator->second].bufferView >= 0;
+}
 
-    const auto byteOffset = accessor.byteOffset + bufferView.byteOffset;
-    GL_CHECK(glVertexAttribPointer(
-        attributeLocation, accessor.type, accessor.componentType, GL_FALSE,
-        bufferView.byteStride, (const GLvoid *)byteOffset));
+// The shader features a primitive's attributes ask for.
+static uint32_t getShaderFeatures(const tinygltf::Model &model,
+                                  const tinygltf::Primitive &primitive) {
+  uint32_t features = 0;
+  if (hasAttribute(model, primitive, "COLOR_0")) {
+    features |= SHADER_FEATURE_VERTEX_COLOR;
   }
+  if (hasAttribute(model, primitive, "JOINTS_0") &&
+      hasAttribute(model, primitive, "WEIGHTS_0")) {
+    features |= SHADER_FEATURE_SKINNING;
+  }
+  return features;
+}
+
+// Primitives without a material, -1, or without a base color texture get the
+// cache's default texture.
+std::shared_ptr<Material> Engine::buildMaterial(Asset &asset,
+                                                int materialIndex,
+                                                uint32_t features) {
+  const auto &model = asset.model;
+  auto baseColorIndex =
+      materialIndex >= 0 && materialIndex < model.materials.size()
+          ? model.materials[materialIndex]
+                .pbrMetallicRoughness.baseColorTexture.index
+          : -1;
+  auto baseColorTexture =
+      baseColorIndex >= 0 && baseColorIndex < asset.textures->size()
+          ? asset.textures->at(baseColorIndex)
+          : resourceCache_->getDefaultTexture();
+  const auto &program = getProgram(features);
+  const auto baseColorTextureLocation =
+      program->getUniformLocation(UNIFORM_BASE_COLOR_TEXTURE);
+  return resourceCache_->getMaterial(
+      program->getProgram(), baseColorTexture, baseColorTextureLocation);
+}
+
+std::shared_ptr<Primitive>
+Engine::buildPrimitive(Asset &asset, unsigned int meshIndex,
+                       unsigned int primitiveIndex, GLuint vao) {
+  const auto &model = asset.model;
+  const auto &primitive = model.meshes[meshIndex].primitives[primitiveIndex];
   std::shared_ptr<Primitive> meshPrimitive;
-  if (primitive.indices >= 0) {
+  const auto optimizedGeometry =
+      getOptimizedGeometry(asset, meshIndex, primitiveIndex);
+  if (optimizedGeometry >= 0) {
+    const auto &geometry = asset.optimizedGeometries[optimizedGeometry];
+    const auto offset =
+        asset.geometryRanges[asset.optimizedRanges[optimizedGeometry] + 1]
+            .offset;
+    meshPrimitive = std::make_shared<Primitive>(
+        vao, primitive.mode, geometry.indexCount, geometry.indexType,
+        indexArena_->getOffset(asset.indexAllocation) + offset);
+    asset.indexBindings.push_back({meshPrimitive, offset, 0});
+    meshPrimitive->setPositionTransform(geometry.positionTransform);
+    for (auto &lod : geometry.lods) {
+      meshPrimitive->addLod(indexArena_->getOffset(asset.indexAllocation) +
+                                offset + lod.indexOffset,
+                            lod.indexCount, lod.error);
+      asset.indexBindings.push_back({meshPrimitive, offset + lod.indexOffset,
+                                     meshPrimitive->getLodCount() - 1});
+    }
+  } else if (primitive.indices >= 0) {
     const auto &accessor = model.accessors[primitive.indices];
-    const auto &bufferView = model.bufferViews[accessor.bufferView];
-    const auto bufferIndex = bufferView.buffer;
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->at(bufferIndex)));
+    const auto offset = geometryOffset(asset, accessor, true);
     meshPrimitive = std::make_shared<Primitive>(
-        vaos->at(primitiveIndex), primitive.mode, accessor.count,
-        accessor.componentType, accessor.byteOffset + bufferView.byteOffset);
+        vao, primitive.mode, accessor.count, accessor.componentType,
+        indexArena_->getOffset(asset.indexAllocation) + offset);
+    asset.indexBindings.push_back({meshPrimitive, offset, 0});
   } else {
     const auto accessorIndex = (*begin(primitive.attributes)).second;
     const auto &accessor = model.accessors[accessorIndex];
-    meshPrimitive =
-        std::make_shared<Primitive>(vaos->at(primitiveIndex), primitive.mode,
-                                    accessor.count, accessor.componentType);
+    meshPrimitive = std::make_shared<Primitive>(
+        vao, primitive.mode, accessor.count, accessor.componentType);
+  }
+  const auto &collisionGeometry =
+      asset.collisionGeometries[meshIndex][primitiveIndex];
+  const auto positionIterator = primitive.attributes.find("POSITION");
+  if (positionIterator != primitive.attributes.end()) {
+    const auto &accessor = model.accessors[(*positionIterator).second];
+    // Bounds of quantized positions come from the decoded ones, their min
+    // and max may be given in either unit.
+    if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT &&
+        collisionGeometry.positions != nullptr &&
+        !collisionGeometry.positions->empty()) {
+      glm::vec3 min(collisionGeometry.positions->front()), max(min);
+      for (auto &position : *collisionGeometry.positions) {
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+      }
+      meshPrimitive->setBounds(min, max);
+    } else if (accessor.minValues.size() == 3 &&
+               accessor.maxValues.size() == 3) {
+      meshPrimitive->setBounds(
+          glm::vec3(accessor.minValues[0], accessor.minValues[1],
+                    accessor.minValues[2]),
+          glm::vec3(accessor.maxValues[0], accessor.maxValues[1],
+                    accessor.maxValues[2]));
+    }
   }
+  if (collisionGeometry.positions != nullptr) {
+    meshPrimitive->setCollisionGeometry(collisionGeometry.positions,
+                                        collisionGeometry.indices);
+  }
+  const auto features = getShaderFeatures(asset.model, primitive);
+  meshPrimitive->setSkinned((features & SHADER_FEATURE_SKINNING) != 0);
   meshPrimitive->setMaterial(
-      buildMaterial(model, primitive.material, textures));
+      buildMaterial(asset, primitive.material, features));
   return meshPrimitive;
 }
 
-GLuint Engine::buildDefaultBaseColorTexture(const tinygltf::Model &model) {
-  float defaultBaseColorTextureColor[] = {1, 1, 1};
-  GLuint defaultBaseColorTexture = 0;
-  GL_CHECK(glGenTextures(1, &defaultBaseColorTexture));
-  GL_CHECK(glBindTexture(GL_TEXTURE_2D, defaultBaseColorTexture));
-  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT));
-  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_FLOAT,
-                        defaultBaseColorTextureColor));
-  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
-  return defaultBaseColorTexture;
+void Engine::prepareAsset(
+    Asset &asset, const std::string &path,
+    const std::vector<std::pair<std::string, GLuint>> &attributes) {
+  std::string warn;
+  const auto thread = std::this_thread::get_id();
+  auto parseStart = ProfileClock::now();
+  if (!asset.loader.load(path, &asset.model, &asset.error, &warn)) {
+    std::cout << "glTF error = " << asset.error << std::endl;
+    return;
+  }
+  auto parseEnd = ProfileClock::now();
+  asset.phases.push_back({"parse", parseStart, parseEnd, thread});
+  ProfileClock::time_point decodeStart, decodeEnd;
+  asset.loader.getDecodeInterval(decodeStart, decodeEnd);
+  if (decodeEnd > decodeStart) {
+    asset.phases.push_back({"decode images", decodeStart, decodeEnd, thread});
+  }
+  const auto &model = asset.model;
+  asset.collisionGeometries.resize(model.meshes.size());
+  asset.jobSystem->parallelFor(
+      model.meshes.size(), MESH_GRAIN_SIZE,
+      [&](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          for (auto &primitive : model.meshes[i].primitives) {
+            asset.collisionGeometries[i].push_back(
+                prepareCollisionGeometry(asset, primitive));
+          }
+        }
+      });
+  prepareAnimations(asset);
+  prepareSkins(asset);
+  auto collisionEnd = ProfileClock::now();
+  asset.phases.push_back({"collision", parseEnd, collisionEnd, thread});
+  if (asset.optimizeGeometry || asset.quantizeVertices ||
+      asset.generateLods) {
+    prepareOptimizedGeometry(asset, attributes);
+    asset.phases.push_back(
+        {"optimize geometry", collisionEnd, ProfileClock::now(), thread});
+  }
+  auto hashStart = ProfileClock::now();
+  prepareGeometryRanges(asset, attributes);
+  for (auto &texture : model.textures) {
+    const auto &image = model.images[texture.source];
+    asset.totalBytes += image.image.size();
+    const auto sampler = texture.sampler >= 0
+                             ? model.samplers[texture.sampler]
+                             : tinygltf::Sampler();
+    const int64_t description[] = {image.width, image.height, image.component,
+                                   image.pixel_type, sampler.minFilter,
+                                   sampler.magFilter, sampler.wrapS,
+                                   sampler.wrapT};
+    auto key = hashBytes(image.mimeType.data(), image.mimeType.size());
+    key = hashBytes(description, sizeof(description), key);
+    asset.textureKeys.push_back(
+        hashBytes(image.image.data(), image.image.size(), key));
+  }
+  asset.phases.push_back({"hash", hashStart, ProfileClock::now(), thread});
+  asset.parseSucceeded = true;
+}
+
+// Rewrites every indexed triangle list through optimizeGeometry, reordered,
+// quantized and/or with levels of detail, reusing the result for primitives
+// that read the same accessors, or reads all of it from the geometry cache.
+// Its positions and indices are the ones already extracted for collision.
+// The distinct geometries are optimized in parallel.
+void Engine::prepareOptimizedGeometry(
+    Asset &asset,
+    const std::vector<std::pair<std::string, GLuint>> &attributes) {
+  const auto &model = asset.model;
+  std::shared_ptr<GeometryCache> cache;
+  if (!asset.geometryCacheDirectory.empty()) {
+    uint64_t bufferBytes = 0;
+    for (auto i = 0; i < model.buffers.size(); ++i) {
+      bufferBytes += asset.loader.getBufferSize(model, i);
+    }
+    cache = std::make_shared<GeometryCache>(
+        asset.geometryCacheDirectory, asset.path, bufferBytes,
+        asset.optimizeGeometry | asset.quantizeVertices << 1 |
+            asset.generateLods << 2);
+    if (cache->read(asset.primitiveGeometries, asset.optimizedGeometries) &&
+        asset.primitiveGeometries.size() == model.meshes.size()) {
+      auto matches = true;
+      for (auto i = 0; i < model.meshes.size(); ++i) {
+        matches &= asset.primitiveGeometries[i].size() ==
+                   model.meshes[i].primitives.size();
+      }
+      if (matches) {
+        return;
+      }
+    }
+    asset.optimizedGeometries.clear();
+  }
+  std::map<std::vector<int>, int> geometries;
+  std::vector<std::pair<const CollisionGeometry *, std::vector<VertexStream>>>
+      pending;
+  asset.primitiveGeometries.resize(model.meshes.size());
+  for (auto i = 0; i < model.meshes.size(); ++i) {
+    const auto &primitives = model.meshes[i].primitives;
+    asset.primitiveGeometries[i].assign(primitives.size(), -1);
+    for (auto j = 0; j < primitives.size(); ++j) {
+      const auto &collisionGeometry = asset.collisionGeometries[i][j];
+      if (primitives[j].indices < 0 || collisionGeometry.positions == nullptr ||
+          !hasValidAccessors(asset, primitives[j])) {
+        continue;
+      }
+      const auto vertexCount = collisionGeometry.positions->size();
+      std::vector<int> key{primitives[j].indices};
+      std::vector<VertexStream> streams;
+      auto supported = true;
+      for (auto &attribute : attributes) {
+        const auto iterator = primitives[j].attributes.find(attribute.first);
+        if (iterator == primitives[j].attributes.end()) {
+          key.push_back(-1);
+          continue;
+        }
+        const auto *data = getAccessorData(asset, (*iterator).second);
+        supported = data != nullptr &&
+                    model.accessors[(*iterator).second].count == vertexCount;
+        if (!supported) {
+          break;
+        }
+        const auto &accessor = model.accessors[(*iterator).second];
+        const auto stride =
+            accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+        const auto elementSize =
+            tinygltf::GetComponentSizeInBytes(accessor.componentType) *
+            tinygltf::GetNumComponentsInType(accessor.type);
+        key.push_back((*iterator).second);
+        streams.push_back({attribute.second, accessor.type,
+                           GLenum(accessor.componentType),
+                           GLboolean(accessor.normalized),
+                           size_t(elementSize), data, size_t(stride)});
+        // Skinned positions go through the joint matrices before the model
+        // matrix, which could not undo their quantization.
+        if (asset.quantizeVertices &&
+            accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT &&
+            !(attribute.first == "POSITION" &&
+              primitives[j].attributes.count("JOINTS_0") > 0)) {
+          streams.back().encoding = getVertexEncoding(attribute.first,
+                                                      accessor.type);
+        }
+      }
+      const auto &indices = *collisionGeometry.indices;
+      if (!supported || indices.size() % 3 != 0 ||
+          std::any_of(indices.begin(), indices.end(),
+                      [&](uint32_t index) { return index >= vertexCount; })) {
+        continue;
+      }
+      auto iterator = geometries.find(key);
+      if (iterator == geometries.end()) {
+        iterator = geometries.emplace(key, pending.size()).first;
+        pending.emplace_back(&collisionGeometry, std::move(streams));
+      }
+      asset.primitiveGeometries[i][j] = iterator->second;
+    }
+  }
+  asset.optimizedGeometries.resize(pending.size());
+  asset.jobSystem->parallelFor(
+      pending.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          const auto &geometry = *pending[i].first;
+          std::vector<SimplifiedMesh> lods;
+          if (asset.generateLods) {
+            lods = simplifyLods(*geometry.indices, *geometry.positions,
+                                MAX_LOD_LEVELS);
+          }
+          asset.optimizedGeometries[i] = optimizeGeometry(
+              *geometry.indices, *geometry.positions, pending[i].second,
+              asset.optimizeGeometry, std::move(lods));
+        }
+      });
+  if (cache != nullptr && !cache->write(asset.primitiveGeometries,
+                                        asset.optimizedGeometries)) {
+    std::cout << "Failed to write geometry cache " << cache->getPath()
+              << std::endl;
+  }
+}
+
+int Engine::getOptimizedGeometry(const Asset &asset, unsigned int meshIndex,
+                                 unsigned int primitiveIndex) {
+  return meshIndex < asset.primitiveGeometries.size()
+             ? asset.primitiveGeometries[meshIndex][primitiveIndex]
+             : -1;
+}
+
+CollisionGeometry
+Engine::prepareCollisionGeometry(Asset &asset,
+                                 const tinygltf::Primitive &primitive) {
+  const auto &model = asset.model;
+  CollisionGeometry geometry;
+  const auto positionIterator = primitive.attributes.find("POSITION");
+  if (primitive.mode != TINYGLTF_MODE_TRIANGLES ||
+      positionIterator == primitive.attributes.end()) {
+    return geometry;
+  }
+  const auto *data = getAccessorData(asset, (*positionIterator).second);
+  if (!data) {
+    return geometry;
+  }
+  const auto &accessor = model.accessors[(*positionIterator).second];
+  if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ||
+      accessor.type != TINYGLTF_TYPE_VEC3) {
+    return geometry;
+  }
+  const unsigned char *indexData = nullptr;
+  if (primitive.indices >= 0) {
+    indexData = getAccessorData(asset, primitive.indices);
+    if (!indexData) {
+      return geometry;
+    }
+    const auto indexType = model.accessors[primitive.indices].componentType;
+    if (indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+        indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+        indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
+      return geometry;
+    }
+  }
+  const auto stride =
+      accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+  auto positions = std::make_shared<std::vector<glm::vec3>>(accessor.count);
+  if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
+    for (auto i = 0; i < accessor.count; ++i) {
+      float values[3];
+      memcpy(values, data + i * stride, sizeof(values));
+      (*positions)[i] = glm::make_vec3(values);
+    }
+  } else {
+    const auto componentSize =
+        tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    for (auto i = 0; i < accessor.count; ++i) {
+      for (auto c = 0; c < 3; ++c) {
+        positions->at(i)[c] =
+            readComponent(data + i * stride + c * componentSize,
+                          accessor.componentType, accessor.normalized);
+      }
+    }
+  }
+  auto indices = std::make_shared<std::vector<uint32_t>>();
+  if (primitive.indices >= 0) {
+    const auto &indexAccessor = model.accessors[primitive.indices];
+    indices->resize(indexAccessor.count);
+    for (auto i = 0; i < indexAccessor.count; ++i) {
+      switch (indexAccessor.componentType) {
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        indices->at(i) = indexData[i];
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        indices->at(i) = ((const uint16_t *)indexData)[i];
+        break;
+      default:
+        indices->at(i) = ((const uint32_t *)indexData)[i];
+        break;
+      }
+    }
+  }
+  geometry.positions = positions;
+  geometry.indices = indices;
+  return geometry;
+}
+
+// One entry per glTF animation so indices match the file, null for the ones
+// without a usable channel. Morph target weights are not animated.
+void Engine::prepareAnimations(Asset &asset) {
+  const auto &model = asset.model;
+  for (auto &gltfAnimation : model.animations) {
+    std::vector<AnimationSampler> samplers;
+    std::vector<bool> valid;
+    for (auto &gltfSampler : gltfAnimation.samplers) {
+      AnimationSampler sampler;
+      if (gltfSampler.interpolation == "STEP") {
+        sampler.interpolation = Interpolation::STEP;
+      } else if (gltfSampler.interpolation == "CUBICSPLINE") {
+        sampler.interpolation = Interpolation::CUBICSPLINE;
+      }
+      sampler.times = readAccessor(asset, gltfSampler.input);
+      const auto values = readAccessor(asset, gltfSampler.output);
+      const auto keyValues =
+          sampler.interpolation == Interpolation::CUBICSPLINE ? 3 : 1;
+      const auto componentCount =
+          gltfSampler.output >= 0 &&
+                  gltfSampler.output < model.accessors.size()
+              ? tinygltf::GetNumComponentsInType(
+                    model.accessors[gltfSampler.output].type)
+              : 0;
+      valid.push_back(!sampler.times.empty() && componentCount >= 3 &&
+                      componentCount <= 4 &&
+                      values.size() == sampler.times.size() * keyValues *
+                                           componentCount);
+      if (!valid.back()) {
+        sampler.times.clear();
+        samplers.push_back(std::move(sampler));
+        continue;
+      }
+      for (auto i = 0; i < values.size(); i += componentCount) {
+        sampler.values.emplace_back(values[i], values[i + 1], values[i + 2],
+                                    componentCount == 4 ? values[i + 3]
+                                                        : 0.0f);
+      }
+      samplers.push_back(std::move(sampler));
+    }
+    std::vector<AnimationChannel> channels;
+    std::vector<int> targetNodes;
+    for (auto &gltfChannel : gltfAnimation.channels) {
+      const auto &path = gltfChannel.target_path;
+      const auto node = gltfChannel.target_node;
+      if (gltfChannel.sampler < 0 || gltfChannel.sampler >= samplers.size() ||
+          !valid[gltfChannel.sampler] || node < 0 ||
+          node >= model.nodes.size() ||
+          (path != "translation" && path != "rotation" && path != "scale")) {
+        continue;
+      }
+      AnimationChannel channel;
+      channel.sampler = gltfChannel.sampler;
+      channel.path = path == "translation" ? AnimationPath::TRANSLATION
+                     : path == "rotation"  ? AnimationPath::ROTATION
+                                           : AnimationPath::SCALE;
+      auto target = std::find(targetNodes.begin(), targetNodes.end(), node);
+      channel.target = target - targetNodes.begin();
+      if (target == targetNodes.end()) {
+        targetNodes.push_back(node);
+      }
+      channels.push_back(channel);
+    }
+    asset.animations.push_back(
+        channels.empty() ? nullptr
+                         : std::make_shared<const Animation>(
+                               gltfAnimation.name, std::move(samplers),
+                               std::move(channels), std::move(targetNodes)));
+  }
+}
+
+// Inverse bind matrices per skin, identity when the skin has none, then the
+// joint radii of every skinned mesh node.
+void Engine::prepareSkins(Asset &asset) {
+  const auto &model = asset.model;
+  for (auto &gltfSkin : model.skins) {
+    std::vector<glm::mat4> matrices(gltfSkin.joints.size(), glm::mat4(1.0f));
+    const auto values = readAccessor(asset, gltfSkin.inverseBindMatrices);
+    if (values.size() == matrices.size() * 16) {
+      for (auto i = 0; i < matrices.size(); ++i) {
+        matrices[i] = glm::make_mat4(&values[i * 16]);
+      }
+    }
+    asset.inverseBindMatrices.push_back(std::move(matrices));
+  }
+  asset.jointRadii.resize(model.nodes.size());
+  asset.jobSystem->parallelFor(
+      model.nodes.size(), MESH_GRAIN_SIZE,
+      [&](unsigned int begin, unsigned int end) {
+        for (auto i = begin; i < end; ++i) {
+          prepareJointRadii(asset, i);
+        }
+      });
+}
+
+// How far the vertices of a skinned mesh node reach from each joint in the
+// bind pose, -1 for joints moving no vertex. Nodes whose reach cannot be
+// worked out get no radii and are never culled.
+void Engine::prepareJointRadii(Asset &asset, unsigned int nodeIndex) {
+  const auto &model = asset.model;
+  const auto &gltfNode = model.nodes[nodeIndex];
+  if (gltfNode.skin < 0 || gltfNode.skin >= model.skins.size() ||
+      gltfNode.mesh < 0 || gltfNode.mesh >= model.meshes.size()) {
+    return;
+  }
+  const auto &inverseBindMatrices = asset.inverseBindMatrices[gltfNode.skin];
+  std::vector<float> radii(inverseBindMatrices.size(), -1.0f);
+  const auto &primitives = model.meshes[gltfNode.mesh].primitives;
+  auto bounded = true;
+  for (auto j = 0; j < primitives.size() && bounded; ++j) {
+    const auto &positions =
+        asset.collisionGeometries[gltfNode.mesh][j].positions;
+    const auto joints =
+        readAccessor(asset, primitives[j].attributes.count("JOINTS_0")
+                                ? primitives[j].attributes.at("JOINTS_0")
+                                : -1);
+    const auto weights =
+        readAccessor(asset, primitives[j].attributes.count("WEIGHTS_0")
+                                ? primitives[j].attributes.at("WEIGHTS_0")
+                                : -1);
+    bounded = positions != nullptr &&
+              joints.size() == positions->size() * 4 &&
+              weights.size() == joints.size();
+    for (auto k = 0; bounded && k < joints.size(); ++k) {
+      const auto joint = (unsigned int)joints[k];
+      if (weights[k] <= 0.0f) {
+        continue;
+      }
+      if (joint >= radii.size()) {
+        bounded = false;
+        break;
+      }
+      const auto local = inverseBindMatrices[joint] *
+                         glm::vec4(positions->at(k / 4), 1.0f);
+      radii[joint] = std::max(radii[joint], glm::length(glm::vec3(local)));
+    }
+  }
+  if (bounded) {
+    asset.jointRadii[nodeIndex] = std::move(radii);
+  }
 }
 
 void Engine::setDefaultCamera(std::shared_ptr<Camera> defaultCamera) {
@@ -16,65 +16,285 @@
 
 #pragma once
 
+#include "Asset.h"
+#include "BVH.h"
+#include "CommandBuffer.h"
+#include "FrameReadback.h"
+#include "FrameStats.h"
+#include "FrameUniforms.h"
+#include "Frustum.h"
+#include "GLBackend.h"
+#include "GLDebug.h"
+#include "GLStateCache.h"
+#include "GLTFLoader.h"
+#include "GeometryArena.h"
+#include "GpuTimer.h"
+#include "InstanceBuffer.h"
+#include "JobSystem.h"
+#include "JointPalette.h"
+#include "LoadHandle.h"
 #include "Material.h"
+#include "MultiViewTarget.h"
+#include "Profiler.h"
 #include "Program.h"
+#include "ProgramBinaryCache.h"
+#include "RenderQueue.h"
+#include "ResourceCache.h"
 #include "Scene.h"
+#include "ShaderFeatures.h"
+#include "ThreadPool.h"
+#include "TransformStore.h"
+#include <functional>
+#include <future>
 #include <string>
 #include <tiny_gltf.h>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class Scene;
 
 namespace triangle {
 
+struct RaycastHit {
+  std::shared_ptr<Node> node;
+  std::shared_ptr<Primitive> primitive;
+  float distance = 0.0f;
+};
+
+struct GeometryStats {
+  GeometryArenaStats vertices;
+  GeometryArenaStats indices;
+  unsigned int vertexArrays = 0;
+};
+
 class Engine {
 
 public:
   Engine(unsigned int width, unsigned int height);
-  void loadGLTF(const std::string &path);
+  std::shared_ptr<LoadHandle> loadGLTF(const std::string &path);
+  std::shared_ptr<LoadHandle> loadGLTFAsync(const std::string &path);
+  void unloadGLTF(const std::shared_ptr<LoadHandle> &handle);
+  bool compactGeometry();
+  const GeometryStats &getGeometryStats();
+  void setResourceCache(std::shared_ptr<ResourceCache> resourceCache);
+  const std::shared_ptr<ResourceCache> &getResourceCache();
+  const ResourceCacheStats &getResourceCacheStats();
+  void setUploadBudget(size_t bytesPerFrame);
+  void setImageDecodeThreads(unsigned int threadCount);
+  void setJobThreads(unsigned int threadCount);
+  void setGeometryOptimization(bool enabled,
+                               const std::string &cacheDirectory = "");
+  void setVertexQuantization(bool enabled);
+  void setLodGeneration(bool enabled);
+  void setLodErrorThreshold(float pixels);
+  void setProgramCacheDirectory(const std::string &directory);
+  void precompilePrograms(const std::vector<uint32_t> &featureSets,
+                          bool background = false);
+  ProgramBinaryCacheStats getProgramCacheStats();
+  bool playAnimation(const std::shared_ptr<LoadHandle> &handle, int animation,
+                     float speed = 1.0f, bool loop = true);
+  void stopAnimation(const std::shared_ptr<LoadHandle> &handle,
+                     int animation = -1);
+  int findAnimation(const std::shared_ptr<LoadHandle> &handle,
+                    const std::string &name);
+  void advanceAnimations(float seconds);
   void setDefaultCamera(std::shared_ptr<Camera> defaultCamera);
+  void setFramePipelining(bool enabled);
   void drawFrame();
+  void flushFrame();
+  void drawViews(const std::vector<std::shared_ptr<Camera>> &cameras,
+                 MultiViewTarget &target);
+  const GLStateCacheStats &getStateCacheStats();
+  const RenderQueueStats &getRenderQueueStats();
+  const CullStats &getCullStats();
+  const FrameStats &getFrameStats();
+  bool startTrace(const std::string &path);
+  void stopTrace();
+  RaycastHit raycast(const glm::vec3 &origin, const glm::vec3 &direction);
+  void setRenderQueueSortEnabled(bool sortEnabled);
+  void readbackFrameAsync(ReadbackCallback callback);
+  std::future<bool> saveFrameAsync(const std::string &path);
+  void finishReadbacks();
 
 private:
+  struct DrawCandidate {
+    Primitive *primitive;
+    const glm::mat4 *worldMatrix;
+    unsigned int lod;
+    int jointOffset;
+  };
+  struct CandidateMesh {
+    Mesh *mesh;
+    unsigned int lod;
+    unsigned int firstCandidate;
+  };
   void init();
+  const std::shared_ptr<ThreadPool> &getThreadPool();
+  const std::shared_ptr<JobSystem> &getJobSystem();
+  void beginFrame();
+  void endFrame();
+  void recordFrame(CommandBuffer &commands);
+  void beginCommands(CommandBuffer &commands);
+  void submitFrame(unsigned int commandBuffer,
+                   const std::function<void(unsigned int)> &beginView =
+                       nullptr);
+  void setLodView(Camera &camera, unsigned int viewHeight);
+  unsigned int selectLod(uint32_t nodeIndex);
+  void buildDrawCandidates(const std::vector<uint32_t> &nodeIndices);
+  void pushDrawCandidates(uint32_t nodeIndex,
+                          const CandidateMesh &candidateMesh);
+  unsigned int cullCandidates(Frustum &frustum,
+                              std::vector<uint8_t> &visibility);
   void buildDefaultCamera();
-  void buildProgram();
-  void buildScenes();
+  void buildProgramCache();
+  const std::shared_ptr<Program> &getProgram(uint32_t features);
+  void adoptPrecompiledPrograms(bool wait);
+  void buildFrameUniforms();
+  void buildInstanceBuffer();
+  void buildJointPalette();
+  void buildBackend();
+  void buildGeometryArenas();
+  void processLoads();
+  bool uploadAsset(Asset &asset, size_t &budget);
+  static const unsigned char *getGeometryRangeData(Asset &asset,
+                                                   const GeometryRange &range);
+  static void prepareGeometryRanges(
+      Asset &asset,
+      const std::vector<std::pair<std::string, GLuint>> &attributes);
+  void allocateGeometry(Asset &asset);
+  void rebindGeometry();
+  void bindGeometry(const Asset &asset, const GeometryBinding &binding);
+  void releaseAsset(Asset &asset);
+  Asset *findAsset(const std::shared_ptr<LoadHandle> &handle);
+  void buildAsset(Asset &asset);
+  static LoadTimings buildLoadTimings(const Asset &asset,
+                                     ProfileClock::time_point buildStart,
+                                     ProfileClock::time_point buildEnd);
+  void releaseHostData(Asset &asset);
+  void buildBVH();
+  void updateTransforms();
+  void updateBVH();
+  void evaluateAnimations();
+  void updateSkins();
+  void computeBVHBounds();
+  static void
+  prepareAsset(Asset &asset, const std::string &path,
+               const std::vector<std::pair<std::string, GLuint>> &attributes);
+  static void prepareOptimizedGeometry(
+      Asset &asset,
+      const std::vector<std::pair<std::string, GLuint>> &attributes);
+  static int getOptimizedGeometry(const Asset &asset, unsigned int meshIndex,
+                                  unsigned int primitiveIndex);
+  static CollisionGeometry
+  prepareCollisionGeometry(Asset &asset, const tinygltf::Primitive &primitive);
+  static void prepareAnimations(Asset &asset);
+  static void prepareSkins(Asset &asset);
+  static void prepareJointRadii(Asset &asset, unsigned int nodeIndex);
   std::shared_ptr<Scene>
-  buildScene(const tinygltf::Model &model, unsigned int sceneIndex,
-             const std::shared_ptr<std::vector<GLuint>> &buffers,
-             const std::shared_ptr<std::vector<GLuint>> &textures);
-  std::shared_ptr<std::vector<GLuint>>
-  buildBuffers(const tinygltf::Model &model);
-  std::shared_ptr<std::vector<GLuint>>
-  buildTextures(const tinygltf::Model &model);
+  buildScene(Asset &asset, unsigned int sceneIndex,
+             const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes);
+  void queryCompressedTextureFormats();
+  size_t buildTexture(const tinygltf::Model &model,
+                      unsigned int textureIndex, GLuint texture);
+  unsigned int buildKTX2Texture(const tinygltf::Image &image,
+                                bool &canGenerateMipmap, size_t &bytes);
+  std::shared_ptr<std::vector<std::shared_ptr<Mesh>>>
+  buildMeshes(Asset &asset);
   std::shared_ptr<Node>
-  buildNode(const tinygltf::Model &model, unsigned int nodeIndex,
-            const std::shared_ptr<std::vector<GLuint>> &buffers,
-            const std::shared_ptr<std::vector<GLuint>> &textures,
+  buildNode(Asset &asset, unsigned int nodeIndex,
+            const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes,
             std::shared_ptr<Node> parent = nullptr);
-  std::shared_ptr<Mesh>
-  buildMesh(const tinygltf::Model &model, unsigned int meshIndex,
-            const std::shared_ptr<std::vector<GLuint>> &buffers,
-            const std::shared_ptr<std::vector<GLuint>> &textures);
-  std::shared_ptr<Material>
-  buildMaterial(const tinygltf::Model &model, unsigned int materialIndex,
-                const std::shared_ptr<std::vector<GLuint>> &textures);
-  std::shared_ptr<Primitive>
-  buildPrimitive(const tinygltf::Model &model, unsigned int meshIndex,
-                 unsigned int primitiveIndex,
-                 const std::shared_ptr<std::vector<GLuint>> &vaos,
-                 const std::shared_ptr<std::vector<GLuint>> &buffers,
-                 const std::shared_ptr<std::vector<GLuint>> &textures);
-  GLuint buildDefaultBaseColorTexture(const tinygltf::Model &model);
+  void buildSkins(Asset &asset);
+  static void buildLodMeshes(
+      const tinygltf::Model &model, unsigned int nodeIndex,
+      const std::shared_ptr<std::vector<std::shared_ptr<Mesh>>> &meshes,
+      Node &node);
+  std::shared_ptr<Mesh> buildMesh(Asset &asset, unsigned int meshIndex);
+  GLuint buildVertexArray(Asset &asset, unsigned int meshIndex,
+                          unsigned int primitiveIndex);
+  std::shared_ptr<Material> buildMaterial(Asset &asset, int materialIndex,
+                                          uint32_t features);
+  std::shared_ptr<Primitive> buildPrimitive(Asset &asset,
+                                            unsigned int meshIndex,
+                                            unsigned int primitiveIndex,
+                                            GLuint vao);
   std::vector<std::shared_ptr<Scene>> scenes_;
+  std::shared_ptr<TransformStore> transformStore_;
   std::shared_ptr<Camera> camera_;
-  std::shared_ptr<Program> program_;
+  std::unordered_map<uint32_t, std::shared_ptr<Program>> programs_;
+  std::future<std::vector<std::pair<uint32_t, std::shared_ptr<Program>>>>
+      precompiledPrograms_;
+  std::string programCacheDirectory_;
+  std::shared_ptr<ProgramBinaryCache> programBinaryCache_;
+  std::shared_ptr<FrameUniforms> frameUniforms_;
+  std::vector<ViewUniforms> viewUniforms_;
+  std::shared_ptr<InstanceBuffer> instanceBuffer_;
+  std::shared_ptr<JointPalette> jointPalette_;
+  std::vector<glm::vec4> jointRows_;
+  bool jointRowsDirty_ = false;
+  std::vector<std::shared_ptr<Node>> skinnedNodes_;
+  unsigned int jointCount_ = 0;
+  std::vector<std::shared_ptr<AnimationInstance>> animationInstances_;
+  bool animationsAdvanced_ = false;
+  GLStateCache stateCache_;
+  std::shared_ptr<GLBackend> backend_;
+  RenderQueue renderQueue_;
+  CommandBuffer commandBuffers_[2];
+  uint64_t commandBufferFrames_[2] = {0, 0};
+  unsigned int nextCommandBuffer_ = 0;
+  bool framePipelining_ = false;
+  bool pendingFrame_ = false;
+  std::vector<CandidateMesh> candidateMeshes_;
+  std::vector<DrawCandidate> drawCandidates_;
+  BoundsArray candidateBounds_;
+  std::vector<uint8_t> candidateVisibility_;
+  CullStats cullStats_;
+  BVH bvh_;
+  std::vector<std::shared_ptr<Node>> bvhNodes_;
+  std::vector<glm::vec3> bvhMins_;
+  std::vector<glm::vec3> bvhMaxs_;
+  unsigned int bvhTransformVersion_ = 0;
+  std::vector<uint32_t> visibleNodes_;
+  std::vector<uint8_t> candidateNodes_;
+  std::vector<Frustum> viewFrustums_;
+  std::vector<std::vector<uint8_t>> viewVisibilities_;
+  unsigned int primitiveCount_ = 0;
   bool initialized_ = false;
   unsigned int width = 0;
   unsigned int height = 0;
   std::vector<std::pair<std::string, GLuint>> preDefinedAttributes;
-  tinygltf::Model model_;
+  std::vector<GLint> compressedTextureFormats_;
+  std::vector<std::shared_ptr<Asset>> loads_;
+  std::vector<std::shared_ptr<Asset>> assets_;
+  std::shared_ptr<GeometryArena> vertexArena_;
+  std::shared_ptr<GeometryArena> indexArena_;
+  unsigned int geometryVersion_ = 0;
+  std::shared_ptr<ResourceCache> resourceCache_;
+  GeometryStats geometryStats_;
+  size_t uploadBudget_;
+  unsigned int imageDecodeThreads_;
+  bool optimizeGeometry_ = false;
+  bool quantizeVertices_ = false;
+  bool generateLods_ = false;
+  float lodErrorThreshold_ = 1.0f;
+  glm::vec3 lodViewPosition_{0.0f};
+  float lodPixelsPerUnit_ = 0.0f;
+  unsigned int lodViewHeight_ = 1;
+  float lodNearPlane_ = 0.0f;
+  std::string geometryCacheDirectory_;
+  std::shared_ptr<ThreadPool> threadPool_;
+  std::shared_ptr<JobSystem> jobSystem_;
+  unsigned int jobThreads_ = 0;
+  std::shared_ptr<FrameReadback> frameReadback_;
+  uint64_t frameIndex_ = 0;
+  Profiler profiler_;
+  std::shared_ptr<GpuTimer> gpuTimer_;
+  FrameStats frameStats_;
+  ProfileClock::time_point frameStart_;
+  ProfileClock::time_point submitStart_;
+  ProfileClock::time_point submitEnd_;
+  bool frameSubmitted_ = false;
 };
 
 } // namespace triangle
\ No newline at end of file
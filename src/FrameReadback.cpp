@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameReadback.h"
+#include "Common.h"
+
+namespace triangle {
+
+FrameReadback::FrameReadback(unsigned int width, unsigned int height,
+                             unsigned int ringSize)
+    : width_(width), height_(height), slots_(ringSize) {
+  for (auto &slot : slots_) {
+    GL_CHECK(glGenBuffers(1, &slot.buffer));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+    GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr,
+                          GL_STREAM_READ));
+  }
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+FrameReadback::~FrameReadback() {
+  for (auto &slot : slots_) {
+    if (slot.fence != nullptr) {
+      GL_CHECK(glDeleteSync(slot.fence));
+    }
+    GL_CHECK(glDeleteBuffers(1, &slot.buffer));
+  }
+}
+
+void FrameReadback::request(uint64_t frameIndex, ReadbackCallback callback) {
+  if (pendingCount_ == slots_.size()) {
+    deliver(slots_[first_], true);
+  }
+  auto &slot = slots_[(first_ + pendingCount_) % slots_.size()];
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+  GL_CHECK(glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE,
+                        nullptr));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  slot.fence = GL_CHECK(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  slot.frameIndex = frameIndex;
+  slot.callback = std::move(callback);
+  ++pendingCount_;
+}
+
+// Delivers finished readbacks in request order, stopping at the first one
+// still in flight unless asked to wait for all of them.
+void FrameReadback::poll(bool wait) {
+  while (pendingCount_ > 0 && deliver(slots_[first_], wait)) {
+  }
+}
+
+unsigned int FrameReadback::getPendingCount() { return pendingCount_; }
+
+bool FrameReadback::deliver(Slot &slot, bool wait) {
+  auto result = GL_CHECK(glClientWaitSync(
+      slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0));
+  if (result == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+  GL_CHECK(glDeleteSync(slot.fence));
+  slot.fence = nullptr;
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer));
+  auto *pixels = GL_CHECK(glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, width_ * height_ * 4, GL_MAP_READ_BIT));
+  if (pixels != nullptr) {
+    ReadbackFrame frame;
+    frame.pixels = static_cast<const unsigned char *>(pixels);
+    frame.width = width_;
+    frame.height = height_;
+    frame.stride = width_ * 4;
+    frame.frameIndex = slot.frameIndex;
+    slot.callback(frame);
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+  }
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  slot.callback = nullptr;
+  first_ = (first_ + 1) % slots_.size();
+  --pendingCount_;
+  return true;
+}
+
+} // namespace triangle
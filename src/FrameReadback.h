@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace triangle {
+
+// Mapped pixels of a finished readback, RGBA8 with the bottom row first as
+// glReadPixels returns them. Only valid during the callback.
+struct ReadbackFrame {
+  const unsigned char *pixels = nullptr;
+  unsigned int width = 0;
+  unsigned int height = 0;
+  size_t stride = 0;
+  uint64_t frameIndex = 0;
+};
+
+using ReadbackCallback = std::function<void(const ReadbackFrame &)>;
+
+// Ring of pixel pack buffers. Each request reads the bound framebuffer into
+// the next buffer and fences it, poll() maps the buffers whose fence has
+// signalled, so frame N is delivered while later frames are rendering. A
+// request on a full ring waits for the oldest one. Callbacks run on the GL
+// thread and must not request readbacks themselves.
+class FrameReadback {
+
+public:
+  FrameReadback(unsigned int width, unsigned int height,
+                unsigned int ringSize);
+  ~FrameReadback();
+  void request(uint64_t frameIndex, ReadbackCallback callback);
+  void poll(bool wait);
+  unsigned int getPendingCount();
+
+private:
+  struct Slot {
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    uint64_t frameIndex = 0;
+    ReadbackCallback callback;
+  };
+  bool deliver(Slot &slot, bool wait);
+  unsigned int width_;
+  unsigned int height_;
+  std::vector<Slot> slots_;
+  unsigned int first_ = 0;
+  unsigned int pendingCount_ = 0;
+};
+
+} // namespace triangle
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Profiler.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace triangle {
+
+// Wall-clock phases of one glTF load. Parse includes inline image decoding,
+// decode only covers the parallel decode pass, optimize is the import-time
+// geometry optimization or its cache read. Upload and build run on the GL
+// thread, upload spread over uploadFrames frames.
+struct LoadTimings {
+  std::string path;
+  double parseMilliseconds = 0.0;
+  double decodeMilliseconds = 0.0;
+  double collisionMilliseconds = 0.0;
+  double optimizeMilliseconds = 0.0;
+  double uploadMilliseconds = 0.0;
+  double buildMilliseconds = 0.0;
+  double totalMilliseconds = 0.0;
+  unsigned int uploadFrames = 0;
+};
+
+// Counters of the last drawFrame or drawViews. The timings stay zero, and
+// gpuMilliseconds -1, in builds without TRIANGLE_PROFILING. GPU time comes
+// from an earlier frame, gpuFrameIndex says which.
+struct FrameStats {
+  uint64_t frameIndex = 0;
+  unsigned int draws = 0;
+  unsigned int instances = 0;
+  uint64_t triangles = 0;
+  unsigned int stateChanges = 0;
+  unsigned int visiblePrimitives = 0;
+  size_t residentBufferBytes = 0;
+  size_t residentTextureBytes = 0;
+  double cpuMilliseconds = 0.0;
+  double gpuMilliseconds = -1.0;
+  uint64_t gpuFrameIndex = 0;
+  double uploadMilliseconds = 0.0;
+  std::vector<ProfileTiming> cpuTimings;
+  std::vector<LoadTimings> completedLoads;
+};
+
+} // namespace triangle
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameUniforms.h"
+#include "Common.h"
+#include <cstring>
+
+namespace triangle {
+
+FrameUniforms::FrameUniforms() {
+  GL_CHECK(glGenBuffers(1, &buffer_));
+  GLint alignment = 1;
+  GL_CHECK(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+  stride_ =
+      (sizeof(ViewUniforms) + alignment - 1) / alignment * alignment;
+}
+
+FrameUniforms::~FrameUniforms() { GL_CHECK(glDeleteBuffers(1, &buffer_)); }
+
+void FrameUniforms::upload(const std::vector<ViewUniforms> &views) {
+  staging_.resize(views.size() * stride_);
+  for (auto i = 0; i < views.size(); ++i) {
+    memcpy(staging_.data() + i * stride_, &views[i], sizeof(ViewUniforms));
+  }
+  GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, buffer_));
+  GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, staging_.size(), staging_.data(),
+                        GL_STREAM_DRAW));
+}
+
+void FrameUniforms::bind(unsigned int view) {
+  GL_CHECK(glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING,
+                             buffer_, view * stride_, sizeof(ViewUniforms)));
+}
+
+void FrameUniforms::bindBlock(GLuint program) {
+  auto blockIndex =
+      GL_CHECK(glGetUniformBlockIndex(program, UNIFORM_BLOCK_FRAME));
+  if (blockIndex != GL_INVALID_INDEX) {
+    GL_CHECK(glUniformBlockBinding(program, blockIndex, FRAME_UNIFORM_BINDING));
+  }
+}
+
+} // namespace triangle
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// std140 layout of the FrameUniforms block in VERTEX_SHADER.
+struct ViewUniforms {
+  glm::mat4 viewProjectMatrix;
+  glm::mat4 viewMatrix;
+  glm::mat4 projectMatrix;
+};
+
+// Streams the camera data of every view of a frame into one uniform buffer,
+// each view at an offset aligned for glBindBufferRange, so that switching
+// views only rebinds a range of FRAME_UNIFORM_BINDING.
+class FrameUniforms {
+
+public:
+  FrameUniforms();
+  ~FrameUniforms();
+  void upload(const std::vector<ViewUniforms> &views);
+  void bind(unsigned int view);
+  static void bindBlock(GLuint program);
+
+private:
+  GLuint buffer_ = 0;
+  GLint stride_ = 0;
+  std::vector<unsigned char> staging_;
+};
+
+} // namespace triangle
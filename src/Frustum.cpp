@@ -0,0 +1,139 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Frustum.h"
+#include <algorithm>
+#include <cmath>
+
+namespace triangle {
+
+void BoundsArray::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+
+void BoundsArray::push(const glm::vec3 &center, const glm::vec3 &extent) {
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extent.x);
+  extentY.push_back(extent.y);
+  extentZ.push_back(extent.z);
+}
+
+void BoundsArray::resize(unsigned int count) {
+  for (auto *stream :
+       {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ}) {
+    stream->resize(count);
+  }
+}
+
+// Boxes of a resized array may be set from several threads at once.
+void BoundsArray::set(unsigned int index, const glm::vec3 &center,
+                      const glm::vec3 &extent) {
+  centerX[index] = center.x;
+  centerY[index] = center.y;
+  centerZ[index] = center.z;
+  extentX[index] = extent.x;
+  extentY[index] = extent.y;
+  extentZ[index] = extent.z;
+}
+
+unsigned int BoundsArray::size() { return centerX.size(); }
+
+Frustum::Frustum(const glm::mat4 &viewProjectMatrix) {
+  auto row = [&](int i) {
+    return glm::vec4(viewProjectMatrix[0][i], viewProjectMatrix[1][i],
+                     viewProjectMatrix[2][i], viewProjectMatrix[3][i]);
+  };
+  planes_[0] = row(3) + row(0);
+  planes_[1] = row(3) - row(0);
+  planes_[2] = row(3) + row(1);
+  planes_[3] = row(3) - row(1);
+  planes_[4] = row(3) + row(2);
+  planes_[5] = row(3) - row(2);
+  for (auto &plane : planes_) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
+
+unsigned int Frustum::cull(BoundsArray &bounds,
+                           std::vector<uint8_t> &visibility) {
+  visibility.resize(bounds.size());
+  return cullRange(bounds, visibility.data(), 0, bounds.size());
+}
+
+// Writes the visibility of the boxes in [begin, end) only, so that ranges can
+// be culled in parallel.
+unsigned int Frustum::cullRange(const BoundsArray &bounds,
+                                uint8_t *visibility, unsigned int begin,
+                                unsigned int end) {
+  std::fill(visibility + begin, visibility + end, 1);
+  const auto *centerX = bounds.centerX.data();
+  const auto *centerY = bounds.centerY.data();
+  const auto *centerZ = bounds.centerZ.data();
+  const auto *extentX = bounds.extentX.data();
+  const auto *extentY = bounds.extentY.data();
+  const auto *extentZ = bounds.extentZ.data();
+  auto *visible = visibility;
+  for (auto &plane : planes_) {
+    const auto nx = plane.x, ny = plane.y, nz = plane.z, d = plane.w;
+    const auto ax = std::fabs(nx), ay = std::fabs(ny), az = std::fabs(nz);
+    for (auto i = begin; i < end; ++i) {
+      auto distance = nx * centerX[i] + ny * centerY[i] + nz * centerZ[i] + d;
+      auto radius = ax * extentX[i] + ay * extentY[i] + az * extentZ[i];
+      visible[i] &= uint8_t(distance + radius >= 0.0f);
+    }
+  }
+  unsigned int visibleCount = 0;
+  for (auto i = begin; i < end; ++i) {
+    visibleCount += visible[i];
+  }
+  return visibleCount;
+}
+
+Containment Frustum::classify(const glm::vec3 &center,
+                              const glm::vec3 &extent) {
+  auto containment = Containment::INSIDE;
+  for (auto &plane : planes_) {
+    auto distance = glm::dot(glm::vec3(plane), center) + plane.w;
+    auto radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+    if (distance + radius < 0.0f) {
+      return Containment::OUTSIDE;
+    }
+    if (distance - radius < 0.0f) {
+      containment = Containment::INTERSECT;
+    }
+  }
+  return containment;
+}
+
+void Frustum::transformBounds(const glm::mat4 &matrix, const glm::vec3 &min,
+                              const glm::vec3 &max, glm::vec3 &center,
+                              glm::vec3 &extent) {
+  auto localCenter = (min + max) * 0.5f;
+  auto localExtent = (max - min) * 0.5f;
+  center = glm::vec3(matrix * glm::vec4(localCenter, 1.0f));
+  extent = glm::abs(glm::vec3(matrix[0])) * localExtent.x +
+           glm::abs(glm::vec3(matrix[1])) * localExtent.y +
+           glm::abs(glm::vec3(matrix[2])) * localExtent.z;
+}
+
+} // namespace triangle
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// World-space axis aligned boxes stored as separate center/extent streams so
+// that culling runs over contiguous floats.
+struct BoundsArray {
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> extentX;
+  std::vector<float> extentY;
+  std::vector<float> extentZ;
+  void clear();
+  void push(const glm::vec3 &center, const glm::vec3 &extent);
+  void resize(unsigned int count);
+  void set(unsigned int index, const glm::vec3 &center,
+           const glm::vec3 &extent);
+  unsigned int size();
+};
+
+enum class Containment { OUTSIDE, INTERSECT, INSIDE };
+
+struct CullStats {
+  unsigned int visible = 0;
+  unsigned int culled = 0;
+};
+
+class Frustum {
+
+public:
+  Frustum(const glm::mat4 &viewProjectMatrix);
+  unsigned int cull(BoundsArray &bounds, std::vector<uint8_t> &visibility);
+  unsigned int cullRange(const BoundsArray &bounds, uint8_t *visibility,
+                         unsigned int begin, unsigned int end);
+  Containment classify(const glm::vec3 &center, const glm::vec3 &extent);
+  static void transformBounds(const glm::mat4 &matrix, const glm::vec3 &min,
+                              const glm::vec3 &max, glm::vec3 &center,
+                              glm::vec3 &extent);
+
+private:
+  glm::vec4 planes_[6];
+};
+
+} // namespace triangle
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLBackend.h"
+#include "Common.h"
+#include <utility>
+
+namespace triangle {
+
+GLBackend::GLBackend(GLStateCache &stateCache,
+                     std::shared_ptr<FrameUniforms> frameUniforms,
+                     std::shared_ptr<InstanceBuffer> instanceBuffer,
+                     std::shared_ptr<JointPalette> jointPalette)
+    : stateCache_(stateCache), frameUniforms_(std::move(frameUniforms)),
+      instanceBuffer_(std::move(instanceBuffer)),
+      jointPalette_(std::move(jointPalette)) {}
+
+void GLBackend::execute(const CommandBuffer &commands,
+                        const std::function<void(unsigned int)> &beginView) {
+  stateCache_.reset();
+  GL_CHECK(glEnable(GL_DEPTH_TEST));
+  GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  if (!commands.getViews().empty()) {
+    frameUniforms_->upload(commands.getViews());
+  }
+  if (!commands.getJointRows().empty()) {
+    jointPalette_->upload(stateCache_, commands.getJointRows());
+  }
+  instanceBuffer_->upload(commands.getInstanceMatrices(),
+                          commands.getInstanceJointOffsets());
+  for (auto &command : commands.getCommands()) {
+    switch (command.type) {
+    case CommandType::CLEAR:
+      GL_CHECK(glViewport(0, 0, command.first, command.count));
+      GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+      break;
+    case CommandType::BEGIN_VIEW:
+      if (beginView) {
+        beginView(command.first);
+      }
+      frameUniforms_->bind(command.first);
+      break;
+    case CommandType::BIND_JOINTS:
+      jointPalette_->bind(stateCache_);
+      break;
+    case CommandType::USE_PROGRAM:
+      stateCache_.useProgram(command.first);
+      break;
+    case CommandType::BIND_PRIMITIVE:
+      command.primitive->bind(stateCache_);
+      break;
+    case CommandType::SET_INSTANCES:
+      instanceBuffer_->bindRange(command.first);
+      break;
+    case CommandType::DRAW:
+      command.primitive->draw(command.count, command.lod);
+      break;
+    }
+  }
+  stateCache_.bindVertexArray(0);
+}
+
+} // namespace triangle
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "CommandBuffer.h"
+#include "FrameUniforms.h"
+#include "GLStateCache.h"
+#include "InstanceBuffer.h"
+#include "JointPalette.h"
+#include <functional>
+#include <memory>
+
+namespace triangle {
+
+// Replays command buffers against GL on the thread that owns the context.
+// Each replay uploads the buffer's data first, then runs its commands from a
+// reset state cache, with beginView called at every BEGIN_VIEW before the
+// view's uniforms are bound.
+class GLBackend {
+
+public:
+  GLBackend(GLStateCache &stateCache,
+            std::shared_ptr<FrameUniforms> frameUniforms,
+            std::shared_ptr<InstanceBuffer> instanceBuffer,
+            std::shared_ptr<JointPalette> jointPalette);
+  void execute(const CommandBuffer &commands,
+               const std::function<void(unsigned int)> &beginView = nullptr);
+
+private:
+  GLStateCache &stateCache_;
+  std::shared_ptr<FrameUniforms> frameUniforms_;
+  std::shared_ptr<InstanceBuffer> instanceBuffer_;
+  std::shared_ptr<JointPalette> jointPalette_;
+};
+
+} // namespace triangle
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLDebug.h"
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+namespace triangle {
+
+// Read by every GL_CHECK, on the compile thread too.
+#ifdef NDEBUG
+std::atomic<GLErrorMode> currentGLErrorMode(GLErrorMode::OFF);
+#else
+std::atomic<GLErrorMode> currentGLErrorMode(GLErrorMode::PER_CALL);
+#endif
+
+// Counted from the GL thread and the background compile context alike.
+static std::atomic<uint64_t> glErrorQueryCount(0);
+
+static bool hasExtension(const char *name) {
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (auto i = 0; i < extensionCount; ++i) {
+    if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) ==
+        0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void GL_APIENTRY onDebugMessage(GLenum source, GLenum type, GLuint id,
+                                       GLenum severity, GLsizei length,
+                                       const GLchar *message,
+                                       const void *userParam) {
+  std::cout << "GL debug message = " << std::string(message, length)
+            << std::endl;
+  assert(type != GL_DEBUG_TYPE_ERROR_KHR);
+}
+
+// Needs a current context. Returns the mode actually set, DEBUG_CALLBACK
+// falls back to PER_FRAME without KHR_debug.
+GLErrorMode setGLErrorMode(GLErrorMode mode) {
+  static PFNGLDEBUGMESSAGECALLBACKKHRPROC debugMessageCallback = nullptr;
+  static PFNGLDEBUGMESSAGECONTROLKHRPROC debugMessageControl = nullptr;
+  if (mode == GLErrorMode::DEBUG_CALLBACK && debugMessageCallback == nullptr &&
+      hasExtension("GL_KHR_debug")) {
+    debugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKKHRPROC)eglGetProcAddress(
+        "glDebugMessageCallbackKHR");
+    debugMessageControl = (PFNGLDEBUGMESSAGECONTROLKHRPROC)eglGetProcAddress(
+        "glDebugMessageControlKHR");
+  }
+  if (mode == GLErrorMode::DEBUG_CALLBACK && debugMessageCallback == nullptr) {
+    std::cout << "KHR_debug unavailable, checking GL errors per frame"
+              << std::endl;
+    mode = GLErrorMode::PER_FRAME;
+  }
+  if (mode == GLErrorMode::DEBUG_CALLBACK) {
+    debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
+                        GL_TRUE);
+    debugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                        GL_DEBUG_SEVERITY_NOTIFICATION_KHR, 0, nullptr,
+                        GL_FALSE);
+    debugMessageCallback(&onDebugMessage, nullptr);
+    glEnable(GL_DEBUG_OUTPUT_KHR);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
+  } else if (getGLErrorMode() == GLErrorMode::DEBUG_CALLBACK) {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
+    glDisable(GL_DEBUG_OUTPUT_KHR);
+    debugMessageCallback(nullptr, nullptr);
+  }
+  currentGLErrorMode.store(mode, std::memory_order_relaxed);
+  return mode;
+}
+
+// Drains every pending error, so a per-frame check reports all of them.
+void checkGLError(const char *call, const char *file, int line) {
+  GLenum error;
+  auto failed = false;
+  while (glErrorQueryCount.fetch_add(1, std::memory_order_relaxed),
+         (error = glGetError()) != GL_NO_ERROR) {
+    std::cout << "GL error = " << error << " after " << call << " at " << file
+              << ":" << line << std::endl;
+    failed = true;
+  }
+  assert(!failed);
+}
+
+uint64_t getGLErrorQueryCount() {
+  return glErrorQueryCount.load(std::memory_order_relaxed);
+}
+
+} // namespace triangle
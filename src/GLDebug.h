@@ -0,0 +1,41 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <atomic>
+#include <cstdint>
+
+namespace triangle {
+
+// How GL errors are caught. PER_CALL checks glGetError after every GL_CHECK,
+// PER_FRAME once at the end of each frame, DEBUG_CALLBACK has the driver
+// report errors through KHR_debug without any glGetError, OFF never checks.
+// Debug builds default to PER_CALL, NDEBUG builds to OFF.
+enum class GLErrorMode { OFF, PER_FRAME, PER_CALL, DEBUG_CALLBACK };
+
+extern std::atomic<GLErrorMode> currentGLErrorMode;
+
+inline GLErrorMode getGLErrorMode() {
+  return currentGLErrorMode.load(std::memory_order_relaxed);
+}
+
+GLErrorMode setGLErrorMode(GLErrorMode mode);
+void checkGLError(const char *call, const char *file, int line);
+uint64_t getGLErrorQueryCount();
+
+} // namespace triangle
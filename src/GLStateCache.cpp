@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLStateCache.h"
+#include "Common.h"
+
+namespace triangle {
+
+GLStateCache::GLStateCache() { reset(); }
+
+void GLStateCache::reset() {
+  program_ = UNKNOWN;
+  vao_ = UNKNOWN;
+  activeTexture_ = UNKNOWN;
+  for (auto &texture : textures_) {
+    texture = UNKNOWN;
+  }
+  uniforms1i_.clear();
+  stats_ = GLStateCacheStats();
+}
+
+void GLStateCache::useProgram(GLuint program) {
+  if (program_ == program) {
+    ++stats_.skipped;
+    return;
+  }
+  GL_CHECK(glUseProgram(program));
+  program_ = program;
+  ++stats_.issued;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+  if (vao_ == vao) {
+    ++stats_.skipped;
+    return;
+  }
+  GL_CHECK(glBindVertexArray(vao));
+  vao_ = vao;
+  ++stats_.issued;
+}
+
+void GLStateCache::activeTexture(GLenum unit) {
+  if (activeTexture_ == unit) {
+    ++stats_.skipped;
+    return;
+  }
+  GL_CHECK(glActiveTexture(unit));
+  activeTexture_ = unit;
+  ++stats_.issued;
+}
+
+void GLStateCache::bindTexture2D(GLuint texture) {
+  auto unit = activeTexture_ - GL_TEXTURE0;
+  if (activeTexture_ != UNKNOWN && unit < MAX_TEXTURE_UNITS &&
+      textures_[unit] == texture) {
+    ++stats_.skipped;
+    return;
+  }
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  if (activeTexture_ != UNKNOWN && unit < MAX_TEXTURE_UNITS) {
+    textures_[unit] = texture;
+  }
+  ++stats_.issued;
+}
+
+void GLStateCache::uniform1i(GLint location, GLint value) {
+  auto key = (uint64_t(program_) << 32) | uint32_t(location);
+  auto iterator = uniforms1i_.find(key);
+  if (program_ != UNKNOWN && iterator != uniforms1i_.end() &&
+      iterator->second == value) {
+    ++stats_.skipped;
+    return;
+  }
+  GL_CHECK(glUniform1i(location, value));
+  if (program_ != UNKNOWN) {
+    uniforms1i_[key] = value;
+  }
+  ++stats_.issued;
+}
+
+const GLStateCacheStats &GLStateCache::getStats() { return stats_; }
+
+} // namespace triangle
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <unordered_map>
+
+namespace triangle {
+
+struct GLStateCacheStats {
+  unsigned int issued = 0;
+  unsigned int skipped = 0;
+};
+
+// Shadows the GL binding state touched by the draw path so that redundant
+// binds are skipped instead of being sent to the driver.
+class GLStateCache {
+
+public:
+  GLStateCache();
+  void reset();
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vao);
+  void activeTexture(GLenum unit);
+  void bindTexture2D(GLuint texture);
+  void uniform1i(GLint location, GLint value);
+  const GLStateCacheStats &getStats();
+
+private:
+  static const int MAX_TEXTURE_UNITS = 16;
+  static const GLuint UNKNOWN = 0xFFFFFFFF;
+  GLuint program_ = UNKNOWN;
+  GLuint vao_ = UNKNOWN;
+  GLenum activeTexture_ = UNKNOWN;
+  GLuint textures_[MAX_TEXTURE_UNITS];
+  std::unordered_map<uint64_t, GLint> uniforms1i_;
+  GLStateCacheStats stats_;
+};
+
+} // namespace triangle
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLTFLoader.h"
+#include "KTX2.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <json.hpp>
+#include <thread>
+
+namespace triangle {
+
+static const std::string MAPPED_BUFFER_URI =
+    "data:application/octet-stream;base64,AA==";
+static const std::string MAPPED_IMAGE_URI = "triangle-mapped-image-";
+static const uint32_t GLB_MAGIC = 0x46546C67;
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+static std::string decodeURI(const std::string &uri) {
+  std::string decoded;
+  for (auto i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size()) {
+      decoded += char(strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    } else {
+      decoded += uri[i];
+    }
+  }
+  return decoded;
+}
+
+void GLTFLoader::setImageDecodeThreads(unsigned int threadCount) {
+  imageDecodeThreads_ = threadCount;
+}
+
+bool GLTFLoader::load(const std::string &path, tinygltf::Model *model,
+                      std::string *err, std::string *warn) {
+  release();
+  auto file = mapFile(path);
+  if (file == nullptr) {
+    *err = "Failed to map file: " + path;
+    return false;
+  }
+  Span json{file->getData(), file->getSize()};
+  Span bin;
+  if (json.size >= 4 && *(const uint32_t *)json.data == GLB_MAGIC &&
+      !parseGLB(file, json, bin)) {
+    *err = "Invalid glTF binary: " + path;
+    return false;
+  }
+  auto document = nlohmann::json::parse(json.data, json.data + json.size,
+                                        nullptr, false);
+  if (document.is_discarded() || !document.is_object()) {
+    *err = "Invalid glTF JSON: " + path;
+    return false;
+  }
+
+  auto separator = path.find_last_of("/\\");
+  auto baseDir =
+      separator == std::string::npos ? "" : path.substr(0, separator + 1);
+  auto buffers = document.find("buffers");
+  if (buffers != document.end() && buffers->is_array()) {
+    buffers_.resize(buffers->size());
+    for (auto i = 0; i < buffers->size(); ++i) {
+      auto &buffer = (*buffers)[i];
+      auto uri = buffer.value("uri", std::string());
+      auto byteLength = buffer.value("byteLength", size_t(0));
+      Span span;
+      if (uri.empty()) {
+        span = bin;
+      } else if (uri.compare(0, 5, "data:") != 0) {
+        auto bufferFile = mapFile(baseDir + decodeURI(uri));
+        if (bufferFile != nullptr) {
+          span = {bufferFile->getData(), bufferFile->getSize()};
+        }
+      }
+      if (span.data == nullptr || span.size < byteLength) {
+        continue;
+      }
+      buffers_[i] = {span.data, byteLength};
+      buffer["uri"] = MAPPED_BUFFER_URI;
+      buffer["byteLength"] = 1;
+    }
+  }
+
+  std::vector<int> imageBufferViews;
+  auto images = document.find("images");
+  auto bufferViews = document.find("bufferViews");
+  if (images != document.end() && images->is_array() &&
+      bufferViews != document.end() && bufferViews->is_array()) {
+    images_.resize(images->size());
+    imageBufferViews.resize(images->size(), -1);
+    for (auto i = 0; i < images->size(); ++i) {
+      auto &image = (*images)[i];
+      auto bufferViewIndex = image.value("bufferView", -1);
+      if (bufferViewIndex < 0 || bufferViewIndex >= bufferViews->size()) {
+        continue;
+      }
+      const auto &bufferView = (*bufferViews)[bufferViewIndex];
+      auto bufferIndex = bufferView.value("buffer", -1);
+      if (bufferIndex < 0 || bufferIndex >= buffers_.size() ||
+          buffers_[bufferIndex].data == nullptr) {
+        continue;
+      }
+      auto byteOffset = bufferView.value("byteOffset", size_t(0));
+      auto byteLength = bufferView.value("byteLength", size_t(0));
+      if (byteLength > buffers_[bufferIndex].size ||
+          byteOffset > buffers_[bufferIndex].size - byteLength) {
+        *err = "Image " + std::to_string(i) + " exceeds its buffer: " + path;
+        return false;
+      }
+      images_[i] = {buffers_[bufferIndex].data + byteOffset, byteLength};
+      imageBufferViews[i] = bufferViewIndex;
+      image.erase("bufferView");
+      image["uri"] = MAPPED_IMAGE_URI + std::to_string(i);
+    }
+  }
+
+  tinygltf::TinyGLTF loader;
+  loader.SetFsCallbacks(
+      {&fileExists, &expandFilePath, &readWholeFile, &writeWholeFile, this});
+  loader.SetImageLoader(&deferImage, this);
+  auto text = document.dump();
+  if (!loader.LoadASCIIFromString(model, err, warn, text.c_str(),
+                                  text.size(), baseDir) ||
+      !decodeImages(model, err)) {
+    return false;
+  }
+  for (auto i = 0; i < imageBufferViews.size(); ++i) {
+    if (imageBufferViews[i] >= 0) {
+      model->images[i].uri.clear();
+      model->images[i].bufferView = imageBufferViews[i];
+    }
+  }
+  for (auto i = 0; i < buffers_.size(); ++i) {
+    if (buffers_[i].data != nullptr) {
+      model->buffers[i].uri.clear();
+      model->buffers[i].data.clear();
+    }
+  }
+  images_.clear();
+  return true;
+}
+
+bool GLTFLoader::parseGLB(const std::shared_ptr<MappedFile> &file, Span &json,
+                          Span &bin) {
+  const auto *data = file->getData();
+  auto size = file->getSize();
+  if (size < 20) {
+    return false;
+  }
+  uint32_t length;
+  memcpy(&length, data + 8, 4);
+  if (length > size) {
+    return false;
+  }
+  json = Span();
+  for (size_t offset = 12; offset + 8 <= length;) {
+    uint32_t chunkLength, chunkType;
+    memcpy(&chunkLength, data + offset, 4);
+    memcpy(&chunkType, data + offset + 4, 4);
+    if (offset + 8 + chunkLength > length) {
+      return false;
+    }
+    if (chunkType == GLB_CHUNK_JSON && json.data == nullptr) {
+      json = {data + offset + 8, chunkLength};
+    } else if (chunkType == GLB_CHUNK_BIN && bin.data == nullptr) {
+      bin = {data + offset + 8, chunkLength};
+    }
+    offset += 8 + ((chunkLength + 3) & ~3u);
+  }
+  return json.data != nullptr;
+}
+
+std::shared_ptr<MappedFile> GLTFLoader::mapFile(const std::string &path) {
+  auto file = std::make_shared<MappedFile>(path);
+  if (!file->isValid()) {
+    return nullptr;
+  }
+  files_.push_back(file);
+  return file;
+}
+
+// Decodes the images collected by deferImage, threads pull the next image
+// from a shared counter so large and small images balance out.
+bool GLTFLoader::decodeImages(tinygltf::Model *model, std::string *err) {
+  if (encodedImages_.empty()) {
+    return true;
+  }
+  decodeStart_ = ProfileClock::now();
+  std::atomic<size_t> next(0);
+  std::vector<std::string> errors(encodedImages_.size());
+  auto decode = [&]() {
+    for (auto i = next++; i < encodedImages_.size(); i = next++) {
+      const auto &encoded = encodedImages_[i];
+      auto mapped = encoded.span.data != nullptr;
+      const auto *data = mapped ? encoded.span.data : encoded.copy.data();
+      auto size = mapped ? encoded.span.size : encoded.copy.size();
+      tinygltf::LoadImageData(&model->images[encoded.index], encoded.index,
+                              &errors[i], nullptr, 0, 0, data, int(size),
+                              nullptr);
+    }
+  };
+  auto threadCount =
+      std::min<size_t>(imageDecodeThreads_, encodedImages_.size());
+  std::vector<std::thread> threads;
+  for (auto i = 1; i < threadCount; ++i) {
+    threads.emplace_back(decode);
+  }
+  decode();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  encodedImages_.clear();
+  decodeEnd_ = ProfileClock::now();
+  auto succeeded = true;
+  for (auto &error : errors) {
+    if (!error.empty()) {
+      *err += error;
+      succeeded = false;
+    }
+  }
+  return succeeded;
+}
+
+const unsigned char *GLTFLoader::getBufferData(const tinygltf::Model &model,
+                                               int bufferIndex) {
+  if (bufferIndex < buffers_.size() && buffers_[bufferIndex].data != nullptr) {
+    return buffers_[bufferIndex].data;
+  }
+  return model.buffers[bufferIndex].data.data();
+}
+
+size_t GLTFLoader::getBufferSize(const tinygltf::Model &model,
+                                 int bufferIndex) {
+  if (bufferIndex < buffers_.size() && buffers_[bufferIndex].data != nullptr) {
+    return buffers_[bufferIndex].size;
+  }
+  return model.buffers[bufferIndex].data.size();
+}
+
+void GLTFLoader::evict(const unsigned char *data, size_t size) {
+  for (auto &file : files_) {
+    if (file->contains(data)) {
+      file->evict(data, size);
+      return;
+    }
+  }
+}
+
+void GLTFLoader::release() {
+  buffers_.clear();
+  images_.clear();
+  encodedImages_.clear();
+  files_.clear();
+}
+
+// Both ends stay equal when no image went through the parallel decode.
+void GLTFLoader::getDecodeInterval(ProfileClock::time_point &start,
+                                   ProfileClock::time_point &end) {
+  start = decodeStart_;
+  end = decodeEnd_;
+}
+
+bool GLTFLoader::fileExists(const std::string &path, void *userData) {
+  return path.find(MAPPED_IMAGE_URI) != std::string::npos ||
+         tinygltf::FileExists(path, nullptr);
+}
+
+std::string GLTFLoader::expandFilePath(const std::string &path,
+                                       void *userData) {
+  return tinygltf::ExpandFilePath(path, nullptr);
+}
+
+bool GLTFLoader::readWholeFile(std::vector<unsigned char> *out,
+                               std::string *err, const std::string &path,
+                               void *userData) {
+  auto position = path.find(MAPPED_IMAGE_URI);
+  if (position == std::string::npos) {
+    return tinygltf::ReadWholeFile(out, err, path, nullptr);
+  }
+  auto loader = static_cast<GLTFLoader *>(userData);
+  auto index = std::stoul(path.substr(position + MAPPED_IMAGE_URI.size()));
+  if (index >= loader->images_.size() ||
+      loader->images_[index].data == nullptr) {
+    return false;
+  }
+  // deferImage reads mapped images straight from the mapping, tinygltf only
+  // needs a non-empty placeholder here.
+  out->assign(1, 0);
+  return true;
+}
+
+bool GLTFLoader::deferImage(tinygltf::Image *image, const int imageIndex,
+                            std::string *err, std::string *warn, int width,
+                            int height, const unsigned char *bytes, int size,
+                            void *userData) {
+  auto loader = static_cast<GLTFLoader *>(userData);
+  Span span{bytes, size_t(size)};
+  auto mapped = imageIndex < loader->images_.size() &&
+                loader->images_[imageIndex].data != nullptr;
+  if (mapped) {
+    span = loader->images_[imageIndex];
+  }
+  if (KTX2::isKTX2(span.data, span.size)) {
+    KTX2 ktx2;
+    if (!ktx2.parse(span.data, span.size)) {
+      *err += "Unsupported KTX2 image[" + std::to_string(imageIndex) + "]\n";
+      return false;
+    }
+    image->width = ktx2.getWidth();
+    image->height = ktx2.getHeight();
+    image->component = 4;
+    image->bits = 8;
+    image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image->mimeType = KTX2_MIME_TYPE;
+    image->image.assign(span.data, span.data + span.size);
+    return true;
+  }
+  if (loader->imageDecodeThreads_ == 0) {
+    return tinygltf::LoadImageData(image, imageIndex, err, warn, width,
+                                   height, span.data, int(span.size), nullptr);
+  }
+  EncodedImage encoded;
+  encoded.index = imageIndex;
+  if (mapped) {
+    encoded.span = span;
+  } else {
+    encoded.copy.assign(bytes, bytes + size);
+  }
+  loader->encodedImages_.push_back(std::move(encoded));
+  return true;
+}
+
+bool GLTFLoader::writeWholeFile(std::string *err, const std::string &path,
+                                const std::vector<unsigned char> &contents,
+                                void *userData) {
+  return tinygltf::WriteWholeFile(err, path, contents, nullptr);
+}
+
+} // namespace triangle
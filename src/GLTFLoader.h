@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+#include "Profiler.h"
+#include <memory>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+namespace triangle {
+
+// Loads .gltf and .glb files with their .bin buffers memory mapped instead of
+// copied. tinygltf only sees the JSON, so buffer bytes stay in the mappings
+// until release() and can be uploaded to GL straight from there.
+// With image decode threads set, tinygltf only collects the encoded images
+// and they are decoded in parallel once the document is parsed. KTX2 images
+// are kept encoded, with mimeType set to KTX2_MIME_TYPE.
+class GLTFLoader {
+
+public:
+  void setImageDecodeThreads(unsigned int threadCount);
+  bool load(const std::string &path, tinygltf::Model *model, std::string *err,
+            std::string *warn);
+  const unsigned char *getBufferData(const tinygltf::Model &model,
+                                     int bufferIndex);
+  size_t getBufferSize(const tinygltf::Model &model, int bufferIndex);
+  void evict(const unsigned char *data, size_t size);
+  void release();
+  void getDecodeInterval(ProfileClock::time_point &start,
+                         ProfileClock::time_point &end);
+
+private:
+  struct Span {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+  };
+  struct EncodedImage {
+    int index = -1;
+    Span span;
+    std::vector<unsigned char> copy;
+  };
+  bool parseGLB(const std::shared_ptr<MappedFile> &file, Span &json,
+                Span &bin);
+  std::shared_ptr<MappedFile> mapFile(const std::string &path);
+  bool decodeImages(tinygltf::Model *model, std::string *err);
+  static bool deferImage(tinygltf::Image *image, const int imageIndex,
+                         std::string *err, std::string *warn, int width,
+                         int height, const unsigned char *bytes, int size,
+                         void *userData);
+  static bool fileExists(const std::string &path, void *userData);
+  static std::string expandFilePath(const std::string &path, void *userData);
+  static bool readWholeFile(std::vector<unsigned char> *out, std::string *err,
+                            const std::string &path, void *userData);
+  static bool writeWholeFile(std::string *err, const std::string &path,
+                             const std::vector<unsigned char> &contents,
+                             void *userData);
+  std::vector<std::shared_ptr<MappedFile>> files_;
+  std::vector<Span> buffers_;
+  std::vector<Span> images_;
+  std::vector<EncodedImage> encodedImages_;
+  unsigned int imageDecodeThreads_ = 0;
+  ProfileClock::time_point decodeStart_;
+  ProfileClock::time_point decodeEnd_;
+};
+
+} // namespace triangle
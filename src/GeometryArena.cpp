@@ -0,0 +1,179 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GeometryArena.h"
+#include "Common.h"
+#include <algorithm>
+
+namespace triangle {
+
+static const size_t ALLOCATION_ALIGNMENT = 16;
+
+GeometryArena::GeometryArena(size_t pageSize) : pageSize_(pageSize) {}
+
+GeometryArena::~GeometryArena() {
+  for (auto &page : pages_) {
+    GL_CHECK(glDeleteBuffers(1, &page.buffer));
+  }
+}
+
+// First fit over the existing pages, a new page when none has room. Sizes are
+// rounded up so that every allocation starts aligned for any attribute type.
+uint32_t GeometryArena::allocate(size_t size) {
+  size = (size + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1);
+  Allocation allocation{0, 0, size};
+  while (allocation.page < pages_.size() &&
+         !takeBlock(pages_[allocation.page], size, allocation.offset)) {
+    ++allocation.page;
+  }
+  if (allocation.page == pages_.size()) {
+    pages_.push_back(createPage(std::max(pageSize_, size)));
+    takeBlock(pages_.back(), size, allocation.offset);
+    ++stats_.pages;
+    stats_.capacityBytes += pages_.back().size;
+  }
+  ++stats_.allocations;
+  stats_.usedBytes += size;
+  if (!freeHandles_.empty()) {
+    auto handle = freeHandles_.back();
+    freeHandles_.pop_back();
+    allocations_[handle] = allocation;
+    return handle;
+  }
+  allocations_.push_back(allocation);
+  return allocations_.size() - 1;
+}
+
+// Returns the range to its page, merged with the free neighbours. Pages are
+// kept until compact() so that the next load can reuse them.
+void GeometryArena::free(uint32_t allocation) {
+  auto &freed = allocations_[allocation];
+  auto &blocks = pages_[freed.page].freeBlocks;
+  auto next = std::lower_bound(
+      blocks.begin(), blocks.end(), freed.offset,
+      [](const Block &block, size_t offset) { return block.offset < offset; });
+  next = blocks.insert(next, {freed.offset, freed.size});
+  if (next + 1 != blocks.end() &&
+      next->offset + next->size == (next + 1)->offset) {
+    next->size += (next + 1)->size;
+    blocks.erase(next + 1);
+  }
+  if (next != blocks.begin() &&
+      (next - 1)->offset + (next - 1)->size == next->offset) {
+    (next - 1)->size += next->size;
+    blocks.erase(next);
+  }
+  --stats_.allocations;
+  stats_.usedBytes -= freed.size;
+  freed.size = 0;
+  freeHandles_.push_back(allocation);
+}
+
+void GeometryArena::upload(uint32_t allocation, size_t offset,
+                           const void *data, size_t size) {
+  const auto &target = allocations_[allocation];
+  GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, pages_[target.page].buffer));
+  GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, target.offset + offset, size,
+                           data));
+  GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+GLuint GeometryArena::getBuffer(uint32_t allocation) {
+  return pages_[allocations_[allocation].page].buffer;
+}
+
+size_t GeometryArena::getOffset(uint32_t allocation) {
+  return allocations_[allocation].offset;
+}
+
+// Copies the live allocations front to back into fresh pages and deletes the
+// old ones, which closes the holes left by free() and releases empty pages.
+// Skipped, returning false, while less than a page could be reclaimed.
+bool GeometryArena::compact() {
+  if (stats_.capacityBytes - stats_.usedBytes < pageSize_) {
+    return false;
+  }
+  std::vector<uint32_t> live;
+  for (auto i = 0u; i < allocations_.size(); ++i) {
+    if (allocations_[i].size > 0) {
+      live.push_back(i);
+    }
+  }
+  std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) {
+    const auto &first = allocations_[a], &second = allocations_[b];
+    return first.page != second.page ? first.page < second.page
+                                     : first.offset < second.offset;
+  });
+  std::vector<Page> pages;
+  stats_.capacityBytes = 0;
+  for (auto handle : live) {
+    auto &allocation = allocations_[handle];
+    size_t offset = 0;
+    if (pages.empty() ||
+        !takeBlock(pages.back(), allocation.size, offset)) {
+      pages.push_back(createPage(std::max(pageSize_, allocation.size)));
+      takeBlock(pages.back(), allocation.size, offset);
+      stats_.capacityBytes += pages.back().size;
+    }
+    GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER,
+                          pages_[allocation.page].buffer));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, pages.back().buffer));
+    GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                 allocation.offset, offset, allocation.size));
+    allocation.page = pages.size() - 1;
+    allocation.offset = offset;
+  }
+  GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+  GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+  for (auto &page : pages_) {
+    GL_CHECK(glDeleteBuffers(1, &page.buffer));
+  }
+  pages_ = std::move(pages);
+  stats_.pages = pages_.size();
+  ++stats_.compactions;
+  return true;
+}
+
+const GeometryArenaStats &GeometryArena::getStats() { return stats_; }
+
+GeometryArena::Page GeometryArena::createPage(size_t size) {
+  Page page{0, size, {{0, size}}};
+  GL_CHECK(glGenBuffers(1, &page.buffer));
+  GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer));
+  GL_CHECK(
+      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW));
+  GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+  return page;
+}
+
+bool GeometryArena::takeBlock(Page &page, size_t size, size_t &offset) {
+  for (auto block = page.freeBlocks.begin(); block != page.freeBlocks.end();
+       ++block) {
+    if (block->size < size) {
+      continue;
+    }
+    offset = block->offset;
+    block->offset += size;
+    block->size -= size;
+    if (block->size == 0) {
+      page.freeBlocks.erase(block);
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace triangle
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triangle {
+
+struct GeometryArenaStats {
+  unsigned int pages = 0;
+  unsigned int allocations = 0;
+  size_t capacityBytes = 0;
+  size_t usedBytes = 0;
+  unsigned int compactions = 0;
+};
+
+// Sub-allocates byte ranges of a few large GL buffers so that geometry of
+// many assets shares buffer objects. Allocations are referred to by handle
+// because compact() moves them: after a compaction the owners re-read
+// getBuffer() and getOffset() and re-point their vertex arrays.
+class GeometryArena {
+
+public:
+  static const uint32_t NO_ALLOCATION = 0xFFFFFFFF;
+  explicit GeometryArena(size_t pageSize);
+  ~GeometryArena();
+  uint32_t allocate(size_t size);
+  void free(uint32_t allocation);
+  void upload(uint32_t allocation, size_t offset, const void *data,
+              size_t size);
+  GLuint getBuffer(uint32_t allocation);
+  size_t getOffset(uint32_t allocation);
+  bool compact();
+  const GeometryArenaStats &getStats();
+
+private:
+  struct Block {
+    size_t offset;
+    size_t size;
+  };
+  struct Page {
+    GLuint buffer;
+    size_t size;
+    std::vector<Block> freeBlocks;
+  };
+  struct Allocation {
+    unsigned int page;
+    size_t offset;
+    size_t size;
+  };
+  Page createPage(size_t size);
+  static bool takeBlock(Page &page, size_t size, size_t &offset);
+  size_t pageSize_;
+  std::vector<Page> pages_;
+  std::vector<Allocation> allocations_;
+  std::vector<uint32_t> freeHandles_;
+  GeometryArenaStats stats_;
+};
+
+} // namespace triangle
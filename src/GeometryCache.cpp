@@ -0,0 +1,196 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GeometryCache.h"
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace triangle {
+
+static const uint32_t GEOMETRY_CACHE_MAGIC = 0x4F454754;
+static const uint32_t GEOMETRY_CACHE_VERSION = 4;
+
+static uint64_t hashString(const std::string &text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (auto c : text) {
+    hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+template <typename T> static void writeValue(std::ofstream &out, T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> static T readValue(std::ifstream &in) {
+  T value{};
+  in.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return value;
+}
+
+static void writeBytes(std::ofstream &out,
+                       const std::vector<unsigned char> &bytes) {
+  writeValue<uint64_t>(out, bytes.size());
+  out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+static bool readBytes(std::ifstream &in, std::vector<unsigned char> &bytes) {
+  auto size = readValue<uint64_t>(in);
+  if (!in || size > (uint64_t(1) << 32)) {
+    return false;
+  }
+  bytes.resize(size);
+  in.read(reinterpret_cast<char *>(bytes.data()), size);
+  return bool(in);
+}
+
+GeometryCache::GeometryCache(const std::string &directory,
+                             const std::string &assetPath,
+                             uint64_t bufferBytes, uint64_t options) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.tgeo",
+           (unsigned long long)hashString(assetPath));
+  path_ = directory + "/" + name;
+  struct stat status;
+  if (stat(assetPath.c_str(), &status) == 0) {
+    key_[0] = status.st_size;
+    key_[1] = uint64_t(status.st_mtim.tv_sec) * 1000000000ull +
+              status.st_mtim.tv_nsec;
+  }
+  key_[2] = bufferBytes;
+  key_[3] = options;
+}
+
+bool GeometryCache::read(std::vector<std::vector<int>> &primitiveGeometries,
+                         std::vector<OptimizedGeometry> &geometries) {
+  std::ifstream in(path_, std::ios::binary);
+  if (!in || readValue<uint32_t>(in) != GEOMETRY_CACHE_MAGIC ||
+      readValue<uint32_t>(in) != GEOMETRY_CACHE_VERSION) {
+    return false;
+  }
+  for (auto key : key_) {
+    if (readValue<uint64_t>(in) != key) {
+      return false;
+    }
+  }
+  primitiveGeometries.resize(readValue<uint32_t>(in));
+  for (auto &mesh : primitiveGeometries) {
+    mesh.resize(readValue<uint32_t>(in));
+    for (auto &geometry : mesh) {
+      geometry = readValue<int32_t>(in);
+    }
+  }
+  geometries.resize(readValue<uint32_t>(in));
+  for (auto &geometry : geometries) {
+    geometry.stride = readValue<uint32_t>(in);
+    geometry.indexType = readValue<uint32_t>(in);
+    geometry.indexCount = readValue<uint32_t>(in);
+    geometry.positionTransform = readValue<glm::mat4>(in);
+    geometry.attributes.resize(readValue<uint32_t>(in));
+    for (auto &attribute : geometry.attributes) {
+      attribute.location = readValue<uint32_t>(in);
+      attribute.size = readValue<int32_t>(in);
+      attribute.type = readValue<uint32_t>(in);
+      attribute.normalized = readValue<uint8_t>(in);
+      attribute.offset = readValue<uint32_t>(in);
+    }
+    geometry.lods.resize(readValue<uint32_t>(in));
+    for (auto &lod : geometry.lods) {
+      lod.indexOffset = readValue<uint64_t>(in);
+      lod.indexCount = readValue<uint32_t>(in);
+      lod.error = readValue<float>(in);
+    }
+    if (!readBytes(in, geometry.vertices) ||
+        !readBytes(in, geometry.indices)) {
+      return false;
+    }
+    const auto indexSize =
+        geometry.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                                : sizeof(uint32_t);
+    for (auto &lod : geometry.lods) {
+      if (lod.indexOffset + uint64_t(lod.indexCount) * indexSize >
+          geometry.indices.size()) {
+        return false;
+      }
+    }
+  }
+  for (auto &mesh : primitiveGeometries) {
+    for (auto geometry : mesh) {
+      if (geometry < -1 || geometry >= int(geometries.size())) {
+        return false;
+      }
+    }
+  }
+  return bool(in);
+}
+
+// Written to a temporary file and renamed, so that a reader never sees a
+// partial entry.
+bool GeometryCache::write(
+    const std::vector<std::vector<int>> &primitiveGeometries,
+    const std::vector<OptimizedGeometry> &geometries) {
+  auto temporaryPath = path_ + ".tmp";
+  std::ofstream out(temporaryPath, std::ios::binary);
+  if (!out) {
+    return false;
+  }
+  writeValue(out, GEOMETRY_CACHE_MAGIC);
+  writeValue(out, GEOMETRY_CACHE_VERSION);
+  for (auto key : key_) {
+    writeValue(out, key);
+  }
+  writeValue<uint32_t>(out, primitiveGeometries.size());
+  for (auto &mesh : primitiveGeometries) {
+    writeValue<uint32_t>(out, mesh.size());
+    for (auto geometry : mesh) {
+      writeValue<int32_t>(out, geometry);
+    }
+  }
+  writeValue<uint32_t>(out, geometries.size());
+  for (auto &geometry : geometries) {
+    writeValue<uint32_t>(out, geometry.stride);
+    writeValue<uint32_t>(out, geometry.indexType);
+    writeValue<uint32_t>(out, geometry.indexCount);
+    writeValue(out, geometry.positionTransform);
+    writeValue<uint32_t>(out, geometry.attributes.size());
+    for (auto &attribute : geometry.attributes) {
+      writeValue<uint32_t>(out, attribute.location);
+      writeValue<int32_t>(out, attribute.size);
+      writeValue<uint32_t>(out, attribute.type);
+      writeValue<uint8_t>(out, attribute.normalized);
+      writeValue<uint32_t>(out, attribute.offset);
+    }
+    writeValue<uint32_t>(out, geometry.lods.size());
+    for (auto &lod : geometry.lods) {
+      writeValue<uint64_t>(out, lod.indexOffset);
+      writeValue<uint32_t>(out, lod.indexCount);
+      writeValue<float>(out, lod.error);
+    }
+    writeBytes(out, geometry.vertices);
+    writeBytes(out, geometry.indices);
+  }
+  out.close();
+  if (!out) {
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+  return std::rename(temporaryPath.c_str(), path_.c_str()) == 0;
+}
+
+const std::string &GeometryCache::getPath() { return path_; }
+
+} // namespace triangle
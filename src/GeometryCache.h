@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "GeometryOptimizer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace triangle {
+
+// Optimized geometry of one asset kept on disk so that loading it again skips
+// the import-time passes. The file is named after a hash of the asset path
+// and is ignored once the asset's size, modification time or total buffer
+// length, or the options it was optimized with, no longer match what it was
+// written from.
+class GeometryCache {
+
+public:
+  GeometryCache(const std::string &directory, const std::string &assetPath,
+                uint64_t bufferBytes, uint64_t options);
+  bool read(std::vector<std::vector<int>> &primitiveGeometries,
+            std::vector<OptimizedGeometry> &geometries);
+  bool write(const std::vector<std::vector<int>> &primitiveGeometries,
+             const std::vector<OptimizedGeometry> &geometries);
+  const std::string &getPath();
+
+private:
+  std::string path_;
+  uint64_t key_[4] = {0, 0, 0, 0};
+};
+
+} // namespace triangle
@@ -0,0 +1,471 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GeometryOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <limits>
+
+namespace triangle {
+
+static const int FORSYTH_CACHE_SIZE = 32;
+static const unsigned int FORSYTH_VALENCE_TABLE_SIZE = 64;
+
+struct ForsythScores {
+  float cache[FORSYTH_CACHE_SIZE];
+  float valence[FORSYTH_VALENCE_TABLE_SIZE];
+  ForsythScores() {
+    for (auto i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+      cache[i] = i < 3 ? 0.75f
+                       : std::pow(1.0f - float(i - 3) /
+                                             (FORSYTH_CACHE_SIZE - 3),
+                                  1.5f);
+    }
+    for (auto i = 1u; i < FORSYTH_VALENCE_TABLE_SIZE; ++i) {
+      valence[i] = 2.0f / std::sqrt(float(i));
+    }
+    valence[0] = 0.0f;
+  }
+};
+
+// Favours vertices near the front of the cache and those with few triangles
+// left, so that stragglers get finished instead of left for later.
+static float getVertexScore(int cachePosition, uint32_t remaining) {
+  static const ForsythScores scores;
+  if (remaining == 0) {
+    return -1.0f;
+  }
+  auto score = cachePosition >= 0 ? scores.cache[cachePosition] : 0.0f;
+  return score + (remaining < FORSYTH_VALENCE_TABLE_SIZE
+                      ? scores.valence[remaining]
+                      : 2.0f / std::sqrt(float(remaining)));
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+  const auto triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  std::vector<uint32_t> offsets(vertexCount + 1, 0), remaining(vertexCount, 0);
+  for (auto index : indices) {
+    ++remaining[index];
+  }
+  for (auto i = 0u; i < vertexCount; ++i) {
+    offsets[i + 1] = offsets[i] + remaining[i];
+  }
+  std::vector<uint32_t> triangles(indices.size());
+  std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+  for (auto i = 0u; i < indices.size(); ++i) {
+    triangles[cursors[indices[i]]++] = i / 3;
+  }
+  std::vector<int> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (auto i = 0u; i < vertexCount; ++i) {
+    vertexScores[i] = getVertexScore(-1, remaining[i]);
+  }
+  std::vector<float> triangleScores(triangleCount, 0.0f);
+  for (auto i = 0u; i < indices.size(); ++i) {
+    triangleScores[i / 3] += vertexScores[indices[i]];
+  }
+  std::vector<uint8_t> emitted(triangleCount, 0);
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+  auto cacheSize = 0;
+  auto best = int(std::max_element(triangleScores.begin(),
+                                   triangleScores.end()) -
+                  triangleScores.begin());
+  size_t nextUnemitted = 0;
+  for (auto emittedCount = 0u; emittedCount < triangleCount;
+       ++emittedCount) {
+    // Nothing left around the cache: continue with the next triangle in the
+    // input order.
+    if (best < 0) {
+      while (emitted[nextUnemitted]) {
+        ++nextUnemitted;
+      }
+      best = nextUnemitted;
+    }
+    const auto *triangle = &indices[best * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[best] = 1;
+    for (auto k = 0; k < 3; ++k) {
+      auto *first = &triangles[offsets[triangle[k]]];
+      auto &count = remaining[triangle[k]];
+      auto *found = std::find(first, first + count, uint32_t(best));
+      *found = first[count - 1];
+      --count;
+    }
+    uint32_t updated[FORSYTH_CACHE_SIZE + 3];
+    auto updatedSize = 0;
+    for (auto k = 0; k < 3; ++k) {
+      if (std::find(updated, updated + updatedSize, triangle[k]) ==
+          updated + updatedSize) {
+        updated[updatedSize++] = triangle[k];
+      }
+    }
+    for (auto i = 0; i < cacheSize; ++i) {
+      if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3) {
+        updated[updatedSize++] = cache[i];
+      }
+    }
+    for (auto i = 0; i < updatedSize; ++i) {
+      auto vertex = updated[i];
+      cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? i : -1;
+      auto score = getVertexScore(cachePositions[vertex], remaining[vertex]);
+      auto delta = score - vertexScores[vertex];
+      vertexScores[vertex] = score;
+      const auto *first = &triangles[offsets[vertex]];
+      for (auto j = 0u; j < remaining[vertex]; ++j) {
+        triangleScores[first[j]] += delta;
+      }
+    }
+    cacheSize = std::min(updatedSize, FORSYTH_CACHE_SIZE);
+    std::copy(updated, updated + cacheSize, cache);
+    best = -1;
+    auto bestScore = -1.0f;
+    for (auto i = 0; i < cacheSize; ++i) {
+      const auto *first = &triangles[offsets[cache[i]]];
+      for (auto j = 0u; j < remaining[cache[i]]; ++j) {
+        if (triangleScores[first[j]] > bestScore) {
+          bestScore = triangleScores[first[j]];
+          best = first[j];
+        }
+      }
+    }
+  }
+  indices.swap(result);
+}
+
+// FIFO cache simulation over timestamps, a vertex is cached while fewer than
+// cacheSize misses happened since it was last loaded.
+static unsigned int countMisses(const uint32_t *triangle,
+                                std::vector<uint32_t> &timestamps,
+                                uint32_t &time, unsigned int cacheSize) {
+  auto misses = 0u;
+  for (auto k = 0; k < 3; ++k) {
+    if (time - timestamps[triangle[k]] > cacheSize) {
+      timestamps[triangle[k]] = time++;
+      ++misses;
+    }
+  }
+  return misses;
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<glm::vec3> &positions,
+                      float threshold) {
+  const auto triangleCount = indices.size() / 3;
+  const auto cacheSize = 16u;
+  if (triangleCount == 0) {
+    return;
+  }
+  // Hard boundaries where a triangle misses on all three vertices, the
+  // cache-optimized order restarting somewhere else.
+  std::vector<uint32_t> timestamps(positions.size(), 0);
+  auto time = cacheSize + 1;
+  std::vector<size_t> hardClusters;
+  for (auto i = 0u; i < triangleCount; ++i) {
+    if (countMisses(&indices[i * 3], timestamps, time, cacheSize) == 3 ||
+        i == 0) {
+      hardClusters.push_back(i);
+    }
+  }
+  hardClusters.push_back(triangleCount);
+  // Soft boundaries inside each: a new cluster starts, with a cold cache,
+  // as soon as the current one has an ACMR under the threshold.
+  std::vector<size_t> clusters;
+  for (auto c = 0u; c + 1 < hardClusters.size(); ++c) {
+    const auto start = hardClusters[c], end = hardClusters[c + 1];
+    time += cacheSize + 1;
+    auto misses = 0u;
+    for (auto i = start; i < end; ++i) {
+      misses += countMisses(&indices[i * 3], timestamps, time, cacheSize);
+    }
+    const auto limit = threshold * misses / (end - start);
+    clusters.push_back(start);
+    time += cacheSize + 1;
+    misses = 0;
+    auto clusterStart = start;
+    for (auto i = start; i < end; ++i) {
+      misses += countMisses(&indices[i * 3], timestamps, time, cacheSize);
+      if (i + 1 < end && misses <= limit * (i + 1 - clusterStart)) {
+        clusters.push_back(i + 1);
+        clusterStart = i + 1;
+        time += cacheSize + 1;
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+  glm::vec3 meshCentroid(0.0f);
+  for (auto &position : positions) {
+    meshCentroid += position / float(positions.size());
+  }
+  std::vector<float> sortKeys(clusters.size() - 1);
+  for (auto c = 0u; c + 1 < clusters.size(); ++c) {
+    glm::vec3 centroid(0.0f), normal(0.0f);
+    auto area = 0.0f;
+    for (auto i = clusters[c]; i < clusters[c + 1]; ++i) {
+      const auto &p0 = positions[indices[i * 3]];
+      const auto &p1 = positions[indices[i * 3 + 1]];
+      const auto &p2 = positions[indices[i * 3 + 2]];
+      auto triangleNormal = glm::cross(p1 - p0, p2 - p0);
+      auto triangleArea = glm::length(triangleNormal);
+      centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+      normal += triangleNormal;
+      area += triangleArea;
+    }
+    auto normalLength = glm::length(normal);
+    sortKeys[c] = area > 0.0f && normalLength > 0.0f
+                      ? glm::dot(centroid / area - meshCentroid,
+                                 normal / normalLength)
+                      : 0.0f;
+  }
+  std::vector<uint32_t> order(sortKeys.size());
+  for (auto c = 0u; c < order.size(); ++c) {
+    order[c] = c;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (auto c : order) {
+    result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                  indices.begin() + clusters[c + 1] * 3);
+  }
+  indices.swap(result);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices,
+                                          size_t vertexCount) {
+  std::vector<uint32_t> remap(vertexCount, 0xFFFFFFFF), sources;
+  for (auto &index : indices) {
+    if (remap[index] == 0xFFFFFFFF) {
+      remap[index] = sources.size();
+      sources.push_back(index);
+    }
+    index = remap[index];
+  }
+  return sources;
+}
+
+float computeACMR(const std::vector<uint32_t> &indices, size_t vertexCount,
+                  unsigned int cacheSize) {
+  const auto triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return 0.0f;
+  }
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  auto time = cacheSize + 1;
+  auto misses = 0u;
+  for (auto i = 0u; i < triangleCount; ++i) {
+    misses += countMisses(&indices[i * 3], timestamps, time, cacheSize);
+  }
+  return float(misses) / triangleCount;
+}
+
+static uint16_t packHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const int exponent = int((bits >> 23) & 0xFF) - 127 + 15;
+  const uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent >= 31) {
+    return sign | 0x7C00 | (exponent == 128 + 15 && mantissa ? 0x200 : 0);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign;
+    }
+    const auto shifted = (mantissa | 0x800000) >> (1 - exponent);
+    return sign | ((shifted + 0x1000) >> 13);
+  }
+  return sign + ((uint32_t(exponent) << 10) | (mantissa >> 13)) +
+         ((mantissa >> 12) & 1);
+}
+
+static uint32_t packSnorm10(float value) {
+  return uint32_t(int(std::round(glm::clamp(value, -1.0f, 1.0f) * 511.0f))) &
+         0x3FF;
+}
+
+// Picks the stored format of an encoded stream over the vertices it keeps.
+static void prepareEncoding(const VertexStream &stream,
+                            const std::vector<uint32_t> &sources,
+                            InterleavedAttribute &attribute,
+                            size_t &elementSize, glm::vec3 &center,
+                            glm::vec3 &extent) {
+  switch (stream.encoding) {
+  case VertexEncoding::POSITION: {
+    glm::vec3 min(std::numeric_limits<float>::max()), max(-min);
+    for (auto source : sources) {
+      glm::vec3 position;
+      memcpy(&position, stream.data + source * stream.stride,
+             sizeof(position));
+      min = glm::min(min, position);
+      max = glm::max(max, position);
+    }
+    center = (min + max) * 0.5f;
+    extent = glm::max((max - min) * 0.5f, glm::vec3(1e-20f));
+    attribute.type = GL_SHORT;
+    attribute.normalized = GL_TRUE;
+    elementSize = 3 * sizeof(int16_t);
+    break;
+  }
+  case VertexEncoding::NORMAL:
+    attribute.size = 4;
+    attribute.type = GL_INT_2_10_10_10_REV;
+    attribute.normalized = GL_TRUE;
+    elementSize = sizeof(uint32_t);
+    break;
+  case VertexEncoding::TEXCOORD: {
+    auto unit = true;
+    for (auto i = 0u; i < sources.size() && unit; ++i) {
+      glm::vec2 texCoord;
+      memcpy(&texCoord, stream.data + sources[i] * stream.stride,
+             sizeof(texCoord));
+      unit = texCoord.x >= 0.0f && texCoord.x <= 1.0f && texCoord.y >= 0.0f &&
+             texCoord.y <= 1.0f;
+    }
+    attribute.type = unit ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT;
+    attribute.normalized = unit;
+    elementSize = 2 * sizeof(uint16_t);
+    break;
+  }
+  case VertexEncoding::COPY:
+    break;
+  }
+}
+
+static void encodeElement(const VertexStream &stream,
+                          const InterleavedAttribute &attribute,
+                          const unsigned char *source, unsigned char *target,
+                          const glm::vec3 &center, const glm::vec3 &extent) {
+  switch (stream.encoding) {
+  case VertexEncoding::POSITION: {
+    glm::vec3 position;
+    memcpy(&position, source, sizeof(position));
+    auto quantized = glm::round(
+        glm::clamp((position - center) / extent, -1.0f, 1.0f) * 32767.0f);
+    int16_t values[] = {int16_t(quantized.x), int16_t(quantized.y),
+                        int16_t(quantized.z)};
+    memcpy(target, values, sizeof(values));
+    break;
+  }
+  case VertexEncoding::NORMAL: {
+    glm::vec3 normal;
+    memcpy(&normal, source, sizeof(normal));
+    uint32_t packed = packSnorm10(normal.x) | packSnorm10(normal.y) << 10 |
+                      packSnorm10(normal.z) << 20;
+    memcpy(target, &packed, sizeof(packed));
+    break;
+  }
+  case VertexEncoding::TEXCOORD: {
+    glm::vec2 texCoord;
+    memcpy(&texCoord, source, sizeof(texCoord));
+    uint16_t values[2];
+    for (auto i = 0; i < 2; ++i) {
+      values[i] = attribute.type == GL_HALF_FLOAT
+                      ? packHalf(texCoord[i])
+                      : uint16_t(std::round(texCoord[i] * 65535.0f));
+    }
+    memcpy(target, values, sizeof(values));
+    break;
+  }
+  case VertexEncoding::COPY:
+    memcpy(target, source, stream.elementSize);
+    break;
+  }
+}
+
+OptimizedGeometry optimizeGeometry(std::vector<uint32_t> indices,
+                                   const std::vector<glm::vec3> &positions,
+                                   const std::vector<VertexStream> &streams,
+                                   bool reorder,
+                                   std::vector<SimplifiedMesh> lods) {
+  if (reorder) {
+    optimizeVertexCache(indices, positions.size());
+    optimizeOverdraw(indices, positions);
+  }
+  auto sources = optimizeVertexFetch(indices, positions.size());
+  OptimizedGeometry geometry;
+  glm::vec3 center(0.0f), extent(1.0f);
+  size_t offset = 0;
+  for (auto &stream : streams) {
+    InterleavedAttribute attribute{stream.location, stream.size, stream.type,
+                                   stream.normalized, offset};
+    auto elementSize = stream.elementSize;
+    prepareEncoding(stream, sources, attribute, elementSize, center, extent);
+    if (stream.encoding == VertexEncoding::POSITION) {
+      geometry.positionTransform =
+          glm::scale(glm::translate(glm::mat4(1.0f), center), extent);
+    }
+    geometry.attributes.push_back(attribute);
+    offset += (elementSize + 3) & ~size_t(3);
+  }
+  geometry.stride = offset;
+  geometry.vertices.resize(sources.size() * offset);
+  for (auto i = 0u; i < sources.size(); ++i) {
+    auto *vertex = geometry.vertices.data() + i * offset;
+    for (auto s = 0u; s < streams.size(); ++s) {
+      encodeElement(streams[s], geometry.attributes[s],
+                    streams[s].data + sources[i] * streams[s].stride,
+                    vertex + geometry.attributes[s].offset, center, extent);
+    }
+  }
+  // Simplification only drops vertices, so every one a level uses is kept.
+  std::vector<uint32_t> newIndices(positions.size(), 0);
+  for (auto i = 0u; i < sources.size(); ++i) {
+    newIndices[sources[i]] = i;
+  }
+  geometry.indexCount = indices.size();
+  for (auto &lod : lods) {
+    for (auto &index : lod.indices) {
+      index = newIndices[index];
+    }
+    if (reorder) {
+      optimizeVertexCache(lod.indices, sources.size());
+    }
+    indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+  }
+  const auto indexSize =
+      sources.size() <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+  auto indexOffset = geometry.indexCount * indexSize;
+  for (auto &lod : lods) {
+    geometry.lods.push_back(
+        {indexOffset, (unsigned int)lod.indices.size(), lod.error});
+    indexOffset += lod.indices.size() * indexSize;
+  }
+  if (indexSize == sizeof(uint16_t)) {
+    geometry.indexType = GL_UNSIGNED_SHORT;
+    geometry.indices.resize(indices.size() * sizeof(uint16_t));
+    auto *shortIndices = (uint16_t *)geometry.indices.data();
+    for (auto i = 0u; i < indices.size(); ++i) {
+      shortIndices[i] = indices[i];
+    }
+  } else {
+    geometry.indexType = GL_UNSIGNED_INT;
+    geometry.indices.resize(indices.size() * sizeof(uint32_t));
+    memcpy(geometry.indices.data(), indices.data(), geometry.indices.size());
+  }
+  return geometry;
+}
+
+} // namespace triangle
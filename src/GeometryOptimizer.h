@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MeshSimplifier.h"
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// How a float stream is stored in the interleaved vertex. Positions become
+// normalized int16 within their bounding box, normals signed normalized
+// 10_10_10_2 and texture coordinates normalized uint16 when they lie in
+// [0, 1], half floats otherwise.
+enum class VertexEncoding { COPY, POSITION, NORMAL, TEXCOORD };
+
+// One attribute of the source vertices, element i at data + i * stride.
+struct VertexStream {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  size_t elementSize;
+  const unsigned char *data;
+  size_t stride;
+  VertexEncoding encoding = VertexEncoding::COPY;
+};
+
+struct InterleavedAttribute {
+  GLuint location;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  size_t offset;
+};
+
+// A coarser level of detail over the same vertices, indexCount indices at
+// indexOffset bytes into OptimizedGeometry::indices.
+struct GeometryLod {
+  size_t indexOffset;
+  unsigned int indexCount;
+  float error;
+};
+
+// A triangle list rewritten for the GPU: the streams interleaved into one
+// vertex buffer in order of first use, and 16 or 32-bit indices ordered for
+// the post-transform cache and then for overdraw. Quantized positions are
+// mapped back to the source space by positionTransform. The levels of detail
+// follow the full index list.
+struct OptimizedGeometry {
+  std::vector<unsigned char> vertices;
+  std::vector<unsigned char> indices;
+  std::vector<InterleavedAttribute> attributes;
+  GLsizei stride = 0;
+  GLenum indexType = GL_UNSIGNED_SHORT;
+  unsigned int indexCount = 0;
+  glm::mat4 positionTransform{1.0f};
+  std::vector<GeometryLod> lods;
+};
+
+// Reorders triangles for a post-transform vertex cache, following Tom
+// Forsyth's linear-speed vertex cache optimisation.
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// Splits the cache-optimized order into clusters and sorts them so that the
+// ones facing away from the centre of the mesh are drawn first, which lets
+// the depth test reject more of the mesh behind them. Clusters are only cut
+// where their ACMR stays within threshold times that of the input.
+void optimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<glm::vec3> &positions,
+                      float threshold = 1.05f);
+
+// Renumbers the vertices in order of first use, dropping unused ones, and
+// returns the source vertex of each new one.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &indices,
+                                          size_t vertexCount);
+
+// Average misses per triangle of a FIFO cache with cacheSize entries.
+float computeACMR(const std::vector<uint32_t> &indices, size_t vertexCount,
+                  unsigned int cacheSize = 16);
+
+// Runs the three passes above, or only the vertex fetch one unless reorder is
+// set, and interleaves the streams in their encodings. lods, simplified from
+// indices, are renumbered along and cache-ordered when reordering.
+OptimizedGeometry optimizeGeometry(std::vector<uint32_t> indices,
+                                   const std::vector<glm::vec3> &positions,
+                                   const std::vector<VertexStream> &streams,
+                                   bool reorder = true,
+                                   std::vector<SimplifiedMesh> lods = {});
+
+} // namespace triangle
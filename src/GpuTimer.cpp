@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GpuTimer.h"
+#include "Common.h"
+#include <GLES2/gl2ext.h>
+#include <cstring>
+
+namespace triangle {
+
+GpuTimer::GpuTimer(unsigned int ringSize) : queries_(ringSize) {
+  for (auto &query : queries_) {
+    GL_CHECK(glGenQueries(1, &query.query));
+  }
+}
+
+GpuTimer::~GpuTimer() {
+  for (auto &query : queries_) {
+    GL_CHECK(glDeleteQueries(1, &query.query));
+  }
+}
+
+bool GpuTimer::isSupported() {
+  GLint extensionCount = 0;
+  GL_CHECK(glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount));
+  for (auto i = 0; i < extensionCount; ++i) {
+    auto extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (std::strcmp(extension, "GL_EXT_disjoint_timer_query") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Skips the frame rather than waiting when its query is still in flight.
+void GpuTimer::begin(uint64_t frameIndex) {
+  auto &query = queries_[next_];
+  if (query.pending) {
+    return;
+  }
+  GL_CHECK(glBeginQuery(GL_TIME_ELAPSED_EXT, query.query));
+  query.frameIndex = frameIndex;
+  active_ = true;
+}
+
+void GpuTimer::end() {
+  if (!active_) {
+    return;
+  }
+  GL_CHECK(glEndQuery(GL_TIME_ELAPSED_EXT));
+  queries_[next_].pending = true;
+  next_ = (next_ + 1) % queries_.size();
+  active_ = false;
+}
+
+// Reads every finished query in issue order into the newest result, which is
+// only valid when true is returned: a result was found and no disjoint
+// operation made the timings meaningless.
+bool GpuTimer::poll(double &milliseconds, uint64_t &frameIndex) {
+  auto found = false;
+  for (auto i = 0; i < queries_.size(); ++i) {
+    auto &query = queries_[(next_ + i) % queries_.size()];
+    if (!query.pending) {
+      continue;
+    }
+    GLuint available = 0;
+    GL_CHECK(glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE,
+                                 &available));
+    if (!available) {
+      break;
+    }
+    GLuint nanoseconds = 0;
+    GL_CHECK(glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &nanoseconds));
+    query.pending = false;
+    // The 32-bit result covers 2 s, anything above that has wrapped.
+    if (nanoseconds < 0x80000000u) {
+      milliseconds = nanoseconds * 1e-6;
+      frameIndex = query.frameIndex;
+      found = true;
+    }
+  }
+  GLint disjoint = 0;
+  GL_CHECK(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+  return found && !disjoint;
+}
+
+} // namespace triangle
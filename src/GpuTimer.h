@@ -0,0 +1,50 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <vector>
+
+namespace triangle {
+
+// Times the GL work between begin() and end() with EXT_disjoint_timer_query.
+// Queries rotate through a ring and are read once available, so results
+// arrive a few frames late without stalling. Results from a period in which
+// the driver reports a disjoint event are dropped.
+class GpuTimer {
+
+public:
+  explicit GpuTimer(unsigned int ringSize);
+  ~GpuTimer();
+  static bool isSupported();
+  void begin(uint64_t frameIndex);
+  void end();
+  bool poll(double &milliseconds, uint64_t &frameIndex);
+
+private:
+  struct Query {
+    GLuint query = 0;
+    uint64_t frameIndex = 0;
+    bool pending = false;
+  };
+  std::vector<Query> queries_;
+  unsigned int next_ = 0;
+  bool active_ = false;
+};
+
+} // namespace triangle
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InstanceBuffer.h"
+#include "Common.h"
+
+namespace triangle {
+
+InstanceBuffer::InstanceBuffer() {
+  GL_CHECK(glGenBuffers(1, &buffer_));
+  GL_CHECK(glGenBuffers(1, &jointOffsetBuffer_));
+}
+
+InstanceBuffer::~InstanceBuffer() {
+  GL_CHECK(glDeleteBuffers(1, &buffer_));
+  GL_CHECK(glDeleteBuffers(1, &jointOffsetBuffer_));
+}
+
+// jointOffsets is either empty or has one entry per matrix.
+void InstanceBuffer::upload(const std::vector<glm::mat4> &matrices,
+                            const std::vector<float> &jointOffsets) {
+  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer_));
+  GL_CHECK(glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4),
+                        matrices.data(), GL_STREAM_DRAW));
+  hasJointOffsets_ = !jointOffsets.empty();
+  if (hasJointOffsets_) {
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, jointOffsetBuffer_));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER,
+                          jointOffsets.size() * sizeof(float),
+                          jointOffsets.data(), GL_STREAM_DRAW));
+  }
+}
+
+void InstanceBuffer::bindRange(unsigned int firstInstance) {
+  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer_));
+  for (auto i = 0; i < 4; ++i) {
+    auto offset = firstInstance * sizeof(glm::mat4) + i * sizeof(glm::vec4);
+    GL_CHECK(glVertexAttribPointer(ATTRIBUTE_MODEL_MATRIX + i, 4, GL_FLOAT,
+                                   GL_FALSE, sizeof(glm::mat4),
+                                   (const GLvoid *)offset));
+  }
+  if (hasJointOffsets_) {
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, jointOffsetBuffer_));
+    GL_CHECK(glVertexAttribPointer(
+        ATTRIBUTE_JOINT_OFFSET, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+        (const GLvoid *)(firstInstance * sizeof(float))));
+  }
+}
+
+// Vertex arrays of skinned primitives also take a joint offset per instance.
+void InstanceBuffer::enableAttributes(bool jointOffsets) {
+  for (auto i = 0; i < 4; ++i) {
+    GL_CHECK(glEnableVertexAttribArray(ATTRIBUTE_MODEL_MATRIX + i));
+    GL_CHECK(glVertexAttribDivisor(ATTRIBUTE_MODEL_MATRIX + i, 1));
+  }
+  if (jointOffsets) {
+    GL_CHECK(glEnableVertexAttribArray(ATTRIBUTE_JOINT_OFFSET));
+    GL_CHECK(glVertexAttribDivisor(ATTRIBUTE_JOINT_OFFSET, 1));
+  }
+}
+
+} // namespace triangle
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// Streams the per-instance world matrices of a frame into a single vertex
+// buffer that is read through the ATTRIBUTE_MODEL_MATRIX columns, and the
+// joint palette offsets of skinned instances, when there are any, into a
+// second one read through ATTRIBUTE_JOINT_OFFSET.
+class InstanceBuffer {
+
+public:
+  InstanceBuffer();
+  ~InstanceBuffer();
+  void upload(const std::vector<glm::mat4> &matrices,
+              const std::vector<float> &jointOffsets);
+  void bindRange(unsigned int firstInstance);
+  static void enableAttributes(bool jointOffsets);
+
+private:
+  GLuint buffer_ = 0;
+  GLuint jointOffsetBuffer_ = 0;
+  bool hasJointOffsets_ = false;
+};
+
+} // namespace triangle
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JobSystem.h"
+#include <algorithm>
+#include <iterator>
+
+namespace triangle {
+
+// The system and deque of the calling thread, when it is a worker.
+static thread_local const JobSystem *currentSystem = nullptr;
+static thread_local unsigned int currentDeque = 0;
+// The group of the job running on the calling thread, else the thread's own.
+static std::atomic<unsigned int> nextGroup(1);
+static thread_local unsigned int currentGroup = 0;
+
+static unsigned int getCurrentGroup() {
+  if (currentGroup == 0) {
+    currentGroup = nextGroup++;
+  }
+  return currentGroup;
+}
+
+bool Job::isFinished() const { return finished_; }
+
+// threadCount counts the thread that waits on the jobs as well, so it starts
+// one worker less. Deque 0 is the one shared by outside threads.
+JobSystem::JobSystem(unsigned int threadCount) {
+  threadCount = std::max(threadCount, 1u);
+  for (auto i = 0; i < threadCount; ++i) {
+    deques_.emplace_back(new Deque());
+  }
+  for (auto i = 1; i < threadCount; ++i) {
+    threads_.emplace_back(&JobSystem::run, this, i);
+  }
+}
+
+// Jobs still queued are dropped, running ones are joined.
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stopping_ = true;
+  }
+  wakeCondition_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+// The job is queued right away when all its dependencies have finished,
+// otherwise by the last of them to finish.
+std::shared_ptr<Job>
+JobSystem::schedule(std::function<void()> function,
+                    const std::vector<std::shared_ptr<Job>> &dependencies) {
+  auto job = std::make_shared<Job>();
+  job->function_ = std::move(function);
+  job->group_ = getCurrentGroup();
+  for (auto &dependency : dependencies) {
+    std::lock_guard<std::mutex> lock(dependency->mutex_);
+    if (!dependency->finished_) {
+      dependency->continuations_.push_back(job);
+      ++job->pending_;
+    }
+  }
+  if (--job->pending_ == 0) {
+    push(job);
+  }
+  return job;
+}
+
+void JobSystem::wait(const std::shared_ptr<Job> &job) {
+  helpUntil([&job] { return job->finished_.load(); });
+}
+
+// Runs queued jobs of the calling thread's group until done, sleeping while
+// there are none. Every push and finished job counts as an event, so one that
+// happens between the check and the sleep is not missed.
+void JobSystem::helpUntil(const std::function<bool()> &done) {
+  const auto group = getCurrentGroup();
+  while (true) {
+    uint64_t events;
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      events = events_;
+    }
+    if (done()) {
+      return;
+    }
+    if (runQueuedJob(group)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    ++waiters_;
+    waitCondition_.wait(lock, [&] { return events_ != events; });
+    --waiters_;
+  }
+}
+
+// Runs body over [0, count) in ranges of at most grainSize. A range is split
+// in halves, the upper one queued, until it fits, so idle threads steal the
+// largest pieces left. The calling thread takes part and returns once every
+// range has run.
+void JobSystem::parallelFor(
+    unsigned int count, unsigned int grainSize,
+    const std::function<void(unsigned int, unsigned int)> &body) {
+  grainSize = std::max(grainSize, 1u);
+  if (count <= grainSize || threads_.empty()) {
+    if (count > 0) {
+      body(0, count);
+    }
+    return;
+  }
+  std::atomic<unsigned int> remaining{count};
+  std::function<void(unsigned int, unsigned int)> split =
+      [&](unsigned int begin, unsigned int end) {
+        while (end - begin > grainSize) {
+          const auto middle = begin + (end - begin) / 2;
+          schedule([&split, middle, end] { split(middle, end); });
+          end = middle;
+        }
+        body(begin, end);
+        remaining -= end - begin;
+      };
+  split(0, count);
+  helpUntil([&remaining] { return remaining == 0; });
+}
+
+unsigned int JobSystem::getThreadCount() const { return deques_.size(); }
+
+void JobSystem::run(unsigned int dequeIndex) {
+  currentSystem = this;
+  currentDeque = dequeIndex;
+  while (true) {
+    if (runQueuedJob(0)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wakeCondition_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+void JobSystem::push(std::shared_ptr<Job> job) {
+  auto &deque = *deques_[getDequeIndex()];
+  {
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    deque.jobs.push_back(std::move(job));
+  }
+  ++queued_;
+  // Taking the lock after the count orders it before a worker's sleep check.
+  notifyWaiters();
+  wakeCondition_.notify_one();
+}
+
+void JobSystem::notifyWaiters() {
+  std::lock_guard<std::mutex> lock(sleepMutex_);
+  ++events_;
+  if (waiters_ > 0) {
+    waitCondition_.notify_all();
+  }
+}
+
+// The newest job of the thread's own deque, else the oldest of the next
+// deque that has one. With a group other than 0 only that group's jobs are
+// taken.
+std::shared_ptr<Job> JobSystem::take(unsigned int group) {
+  std::shared_ptr<Job> job;
+  const auto own = getDequeIndex();
+  for (auto i = 0; i < deques_.size() && job == nullptr; ++i) {
+    auto &deque = *deques_[(own + i) % deques_.size()];
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    auto &jobs = deque.jobs;
+    auto matches = [group](const std::shared_ptr<Job> &queued) {
+      return group == 0 || queued->group_ == group;
+    };
+    if (i == 0) {
+      auto iterator = std::find_if(jobs.rbegin(), jobs.rend(), matches);
+      if (iterator != jobs.rend()) {
+        job = std::move(*iterator);
+        jobs.erase(std::next(iterator).base());
+      }
+    } else {
+      auto iterator = std::find_if(jobs.begin(), jobs.end(), matches);
+      if (iterator != jobs.end()) {
+        job = std::move(*iterator);
+        jobs.erase(iterator);
+      }
+    }
+  }
+  if (job != nullptr) {
+    --queued_;
+  }
+  return job;
+}
+
+void JobSystem::execute(const std::shared_ptr<Job> &job) {
+  const auto group = currentGroup;
+  currentGroup = job->group_;
+  job->function_();
+  job->function_ = nullptr;
+  currentGroup = group;
+  std::vector<std::shared_ptr<Job>> continuations;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex_);
+    job->finished_ = true;
+    continuations.swap(job->continuations_);
+  }
+  for (auto &continuation : continuations) {
+    if (--continuation->pending_ == 0) {
+      push(continuation);
+    }
+  }
+  notifyWaiters();
+}
+
+bool JobSystem::runQueuedJob(unsigned int group) {
+  auto job = take(group);
+  if (job == nullptr) {
+    return false;
+  }
+  execute(job);
+  return true;
+}
+
+unsigned int JobSystem::getDequeIndex() const {
+  return currentSystem == this ? currentDeque : 0;
+}
+
+} // namespace triangle
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace triangle {
+
+// A function scheduled on a JobSystem, queued once every job it was
+// scheduled after has finished.
+class Job {
+
+public:
+  bool isFinished() const;
+
+private:
+  friend class JobSystem;
+  std::function<void()> function_;
+  unsigned int group_ = 0;
+  std::atomic<unsigned int> pending_{1};
+  std::atomic<bool> finished_{false};
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Job>> continuations_;
+};
+
+// Work-stealing scheduler for the short CPU jobs of a frame or a load. Each
+// worker pushes and pops its own jobs at the back of its deque, LIFO for
+// locality, and once that is empty steals the oldest, largest, job from the
+// front of another one. Threads outside the system share one more deque.
+// A job belongs to the group of the outside thread whose work it is part of,
+// and a waiting thread only runs queued jobs of its own group meanwhile, so
+// jobs may wait on jobs without a frame picking up a load's work. Long
+// blocking work such as file parsing belongs on a ThreadPool.
+class JobSystem {
+
+public:
+  explicit JobSystem(unsigned int threadCount);
+  ~JobSystem();
+  std::shared_ptr<Job>
+  schedule(std::function<void()> function,
+           const std::vector<std::shared_ptr<Job>> &dependencies = {});
+  void wait(const std::shared_ptr<Job> &job);
+  void parallelFor(unsigned int count, unsigned int grainSize,
+                   const std::function<void(unsigned int, unsigned int)> &body);
+  unsigned int getThreadCount() const;
+
+private:
+  struct Deque {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<Job>> jobs;
+  };
+  void run(unsigned int dequeIndex);
+  void push(std::shared_ptr<Job> job);
+  std::shared_ptr<Job> take(unsigned int group);
+  void execute(const std::shared_ptr<Job> &job);
+  bool runQueuedJob(unsigned int group);
+  void helpUntil(const std::function<bool()> &done);
+  void notifyWaiters();
+  unsigned int getDequeIndex() const;
+  std::vector<std::unique_ptr<Deque>> deques_;
+  std::vector<std::thread> threads_;
+  std::atomic<int> queued_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wakeCondition_;
+  std::condition_variable waitCondition_;
+  uint64_t events_ = 0;
+  unsigned int waiters_ = 0;
+  bool stopping_ = false;
+};
+
+} // namespace triangle
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JointPalette.h"
+#include "Common.h"
+#include <algorithm>
+
+namespace triangle {
+
+static const unsigned int TEXTURE_WIDTH = JOINT_PALETTE_ROW_JOINTS * 3;
+
+JointPalette::JointPalette() { GL_CHECK(glGenTextures(1, &texture_)); }
+
+JointPalette::~JointPalette() { GL_CHECK(glDeleteTextures(1, &texture_)); }
+
+// rows holds whole texture rows, three per joint.
+void JointPalette::upload(GLStateCache &stateCache,
+                          const std::vector<glm::vec4> &rows) {
+  const unsigned int height = rows.size() / TEXTURE_WIDTH;
+  if (height == 0) {
+    return;
+  }
+  bind(stateCache);
+  if (height > height_) {
+    height_ = std::max(height, height_ * 2);
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, TEXTURE_WIDTH,
+                          height_, 0, GL_RGBA, GL_FLOAT, nullptr));
+    GL_CHECK(
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL_CHECK(
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  }
+  GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_WIDTH, height,
+                           GL_RGBA, GL_FLOAT, rows.data()));
+}
+
+void JointPalette::bind(GLStateCache &stateCache) {
+  stateCache.activeTexture(GL_TEXTURE0 + JOINT_PALETTE_TEXTURE_UNIT);
+  stateCache.bindTexture2D(texture_);
+}
+
+// Points the program's palette sampler at JOINT_PALETTE_TEXTURE_UNIT, for
+// programs built with SHADER_FEATURE_SKINNING.
+void JointPalette::bindSampler(GLuint program) {
+  auto location =
+      GL_CHECK(glGetUniformLocation(program, UNIFORM_JOINT_PALETTE));
+  if (location < 0) {
+    return;
+  }
+  GLint currentProgram = 0;
+  GL_CHECK(glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram));
+  GL_CHECK(glUseProgram(program));
+  GL_CHECK(glUniform1i(location, JOINT_PALETTE_TEXTURE_UNIT));
+  GL_CHECK(glUseProgram(currentProgram));
+}
+
+} // namespace triangle
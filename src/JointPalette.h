@@ -0,0 +1,44 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "GLStateCache.h"
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// The joint matrices of every skinned node of a frame in one RGBA32F texture
+// that the skinning shader reads with texelFetch. A joint is three texels,
+// the rows of its affine matrix, JOINT_PALETTE_ROW_JOINTS joints to a texture
+// row. The texture only grows.
+class JointPalette {
+
+public:
+  JointPalette();
+  ~JointPalette();
+  void upload(GLStateCache &stateCache, const std::vector<glm::vec4> &rows);
+  void bind(GLStateCache &stateCache);
+  static void bindSampler(GLuint program);
+
+private:
+  GLuint texture_ = 0;
+  unsigned int height_ = 0;
+};
+
+} // namespace triangle
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KTX2.h"
+#include <GLES2/gl2ext.h>
+#include <cstring>
+
+namespace triangle {
+
+static const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58,
+                                                  0x20, 0x32, 0x30, 0xBB,
+                                                  0x0D, 0x0A, 0x1A, 0x0A};
+static const size_t KTX2_HEADER_SIZE = 80;
+static const size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+static const uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+static const uint32_t VK_FORMAT_R8G8B8A8_SRGB = 43;
+static const uint32_t VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147;
+static const uint32_t VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK = 152;
+static const uint32_t VK_FORMAT_ASTC_4x4_UNORM_BLOCK = 157;
+static const uint32_t VK_FORMAT_ASTC_12x12_SRGB_BLOCK = 184;
+
+bool KTX2::isKTX2(const unsigned char *data, size_t size) {
+  return size >= sizeof(KTX2_IDENTIFIER) &&
+         memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+bool KTX2::parse(const unsigned char *data, size_t size) {
+  levels_.clear();
+  if (size < KTX2_HEADER_SIZE || !isKTX2(data, size)) {
+    return false;
+  }
+  uint32_t header[9];
+  memcpy(header, data + 12, sizeof(header));
+  vkFormat_ = header[0];
+  width_ = header[2];
+  height_ = header[3];
+  auto pixelDepth = header[4], layerCount = header[5], faceCount = header[6];
+  auto levelCount = header[7] == 0 ? 1 : header[7];
+  auto supercompressionScheme = header[8];
+  if (width_ == 0 || height_ == 0 || pixelDepth > 1 || layerCount > 1 ||
+      faceCount != 1 || supercompressionScheme != 0 ||
+      getInternalFormat() == 0 ||
+      KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE > size) {
+    return false;
+  }
+  levels_.resize(levelCount);
+  for (auto i = 0; i < levelCount; ++i) {
+    uint64_t entry[2];
+    memcpy(entry, data + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE,
+           sizeof(entry));
+    if (entry[0] > size || entry[1] > size - entry[0]) {
+      levels_.clear();
+      return false;
+    }
+    levels_[i] = {data + entry[0], size_t(entry[1])};
+  }
+  return true;
+}
+
+uint32_t KTX2::getVkFormat() const { return vkFormat_; }
+
+uint32_t KTX2::getWidth() const { return width_; }
+
+uint32_t KTX2::getHeight() const { return height_; }
+
+unsigned int KTX2::getLevelCount() const { return levels_.size(); }
+
+const KTX2::Level &KTX2::getLevel(unsigned int level) const {
+  return levels_[level];
+}
+
+// Vulkan lists each format as UNORM followed by SRGB, GL keeps the ETC2 pairs
+// the same way and the ASTC ones in two separate runs.
+GLenum KTX2::getInternalFormat() const {
+  if (vkFormat_ == VK_FORMAT_R8G8B8A8_UNORM) {
+    return GL_RGBA8;
+  }
+  if (vkFormat_ == VK_FORMAT_R8G8B8A8_SRGB) {
+    return GL_SRGB8_ALPHA8;
+  }
+  if (vkFormat_ >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK &&
+      vkFormat_ <= VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK) {
+    return GL_COMPRESSED_RGB8_ETC2 +
+           (vkFormat_ - VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK);
+  }
+  if (vkFormat_ >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK &&
+      vkFormat_ <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+    auto index = vkFormat_ - VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+    return (index % 2 == 0 ? GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+                           : GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR) +
+           index / 2;
+  }
+  return 0;
+}
+
+bool KTX2::isCompressed() const {
+  return vkFormat_ != VK_FORMAT_R8G8B8A8_UNORM &&
+         vkFormat_ != VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+bool KTX2::isETC2() const {
+  return vkFormat_ >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK &&
+         vkFormat_ <= VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK;
+}
+
+} // namespace triangle
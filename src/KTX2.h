@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define KTX2_MIME_TYPE "image/ktx2"
+
+namespace triangle {
+
+// Read-only view of a KTX2 container holding a single 2D image with its mip
+// chain. Only payloads without supercompression are accepted, level data is
+// referenced in place.
+class KTX2 {
+
+public:
+  struct Level {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+  };
+  static bool isKTX2(const unsigned char *data, size_t size);
+  bool parse(const unsigned char *data, size_t size);
+  uint32_t getVkFormat() const;
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+  unsigned int getLevelCount() const;
+  const Level &getLevel(unsigned int level) const;
+  GLenum getInternalFormat() const;
+  bool isCompressed() const;
+  bool isETC2() const;
+
+private:
+  uint32_t vkFormat_ = 0;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::vector<Level> levels_;
+};
+
+} // namespace triangle
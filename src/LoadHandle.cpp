@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LoadHandle.h"
+
+namespace triangle {
+
+LoadState LoadHandle::getState() const { return state_; }
+
+bool LoadHandle::isDone() const {
+  auto state = getState();
+  return state == LoadState::READY || state == LoadState::FAILED;
+}
+
+float LoadHandle::getProgress() const { return progress_; }
+
+// Only valid once the state is FAILED, the error is written before it.
+const std::string &LoadHandle::getError() const { return error_; }
+
+void LoadHandle::setState(LoadState state) { state_ = state; }
+
+void LoadHandle::setProgress(float progress) { progress_ = progress; }
+
+void LoadHandle::setError(const std::string &error) { error_ = error; }
+
+} // namespace triangle
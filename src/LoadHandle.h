@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace triangle {
+
+enum class LoadState { PARSING, UPLOADING, READY, FAILED };
+
+// Progress of an asset requested through Engine::loadGLTFAsync. The state is
+// advanced by the engine and may be polled from any thread.
+class LoadHandle {
+
+public:
+  LoadState getState() const;
+  bool isDone() const;
+  float getProgress() const;
+  const std::string &getError() const;
+  void setState(LoadState state);
+  void setProgress(float progress);
+  void setError(const std::string &error);
+
+private:
+  std::atomic<LoadState> state_{LoadState::PARSING};
+  std::atomic<float> progress_{0.0f};
+  std::string error_;
+};
+
+} // namespace triangle
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace triangle {
+
+MappedFile::MappedFile(const std::string &path) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat status;
+  if (fstat(fd, &status) == 0 && status.st_size > 0) {
+    auto data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      data_ = data;
+      size_ = status.st_size;
+      madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+bool MappedFile::isValid() { return data_ != nullptr; }
+
+const unsigned char *MappedFile::getData() {
+  return static_cast<const unsigned char *>(data_);
+}
+
+size_t MappedFile::getSize() { return size_; }
+
+bool MappedFile::contains(const unsigned char *data) {
+  return data >= getData() && data < getData() + size_;
+}
+
+void MappedFile::evict(const unsigned char *data, size_t size) {
+  auto pageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+  auto begin = (uintptr_t(data) + pageSize - 1) & ~(pageSize - 1);
+  auto end = std::min(uintptr_t(data) + size, uintptr_t(getData() + size_)) &
+             ~(pageSize - 1);
+  if (begin < end) {
+    madvise((void *)begin, end - begin, MADV_DONTNEED);
+  }
+}
+
+} // namespace triangle
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace triangle {
+
+// Read-only memory mapping of a whole file. The pages are backed by the file
+// itself, so they do not count as anonymous memory and can be dropped by the
+// kernel at any time.
+class MappedFile {
+
+public:
+  MappedFile(const std::string &path);
+  ~MappedFile();
+  bool isValid();
+  const unsigned char *getData();
+  size_t getSize();
+  bool contains(const unsigned char *data);
+  void evict(const unsigned char *data, size_t size);
+
+private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // namespace triangle
@@ -16,16 +16,25 @@
 
 #include "Material.h"
 #include "Common.h"
+#include <atomic>
 
 namespace triangle {
 
-Material::Material(GLuint baseColorTexture, int baseColorTextureLocation)
-    : baseColorTexture_(baseColorTexture),
+static std::atomic<unsigned int> nextMaterialId(0);
+
+Material::Material(GLuint program, GLuint baseColorTexture,
+                   int baseColorTextureLocation)
+    : id_(nextMaterialId++), program_(program),
+      baseColorTexture_(baseColorTexture),
       baseColorTextureLocation_(baseColorTextureLocation) {}
-void Material::bind() {
-  GL_CHECK(glActiveTexture(GL_TEXTURE0));
-  GL_CHECK(glBindTexture(GL_TEXTURE_2D, baseColorTexture_));
-  GL_CHECK(glUniform1i(baseColorTextureLocation_, 0));
+void Material::bind(GLStateCache &stateCache) {
+  stateCache.activeTexture(GL_TEXTURE0);
+  stateCache.bindTexture2D(baseColorTexture_);
+  stateCache.uniform1i(baseColorTextureLocation_, 0);
 }
 
+unsigned int Material::getId() { return id_; }
+
+GLuint Material::getProgram() { return program_; }
+
 } // namespace triangle
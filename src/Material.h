@@ -16,16 +16,22 @@
 
 #pragma once
 
+#include "GLStateCache.h"
 #include <GLES3/gl3.h>
 
 namespace triangle {
 
 class Material {
 public:
-  Material(GLuint baseColorTexture, int baseColorTextureLocation);
-  void bind();
+  Material(GLuint program, GLuint baseColorTexture,
+           int baseColorTextureLocation);
+  void bind(GLStateCache &stateCache);
+  unsigned int getId();
+  GLuint getProgram();
 
 private:
+  unsigned int id_;
+  GLuint program_;
   GLuint baseColorTexture_;
   int baseColorTextureLocation_;
 };
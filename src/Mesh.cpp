@@ -15,17 +15,37 @@
  */
 
 #include "Mesh.h"
+#include <algorithm>
 #include <utility>
 
 namespace triangle {
 
 Mesh::Mesh(std::shared_ptr<std::vector<std::shared_ptr<Primitive>>> primitives)
-    : primitives_(std::move(primitives)) {}
-
-void Mesh::draw() {
+    : primitives_(std::move(primitives)) {
+  lodErrors_.assign(1, 0.0f);
+  for (auto &primitive : *primitives_) {
+    if (primitive->getLodCount() > lodErrors_.size()) {
+      lodErrors_.resize(primitive->getLodCount(), 0.0f);
+    }
+  }
   for (auto &primitive : *primitives_) {
-    primitive->draw();
+    for (auto lod = 0u; lod < lodErrors_.size(); ++lod) {
+      lodErrors_[lod] = std::max(
+          lodErrors_[lod],
+          primitive->getLodError(
+              std::min(lod, primitive->getLodCount() - 1)));
+    }
   }
 }
 
+const std::vector<std::shared_ptr<Primitive>> &Mesh::getPrimitives() {
+  return *primitives_;
+}
+
+unsigned int Mesh::getLodCount() { return lodErrors_.size(); }
+
+float Mesh::getLodError(unsigned int lod) {
+  return lodErrors_[std::min<size_t>(lod, lodErrors_.size() - 1)];
+}
+
 } // namespace triangle
\ No newline at end of file
@@ -23,14 +23,19 @@
 
 namespace triangle {
 
+// The error of a level of detail of the mesh is the largest of its
+// primitives', those with fewer levels staying at their coarsest one.
 class Mesh {
 
 public:
   Mesh(std::shared_ptr<std::vector<std::shared_ptr<Primitive>>> primitives);
-  void draw();
+  const std::vector<std::shared_ptr<Primitive>> &getPrimitives();
+  unsigned int getLodCount();
+  float getLodError(unsigned int lod);
 
 private:
   std::shared_ptr<std::vector<std::shared_ptr<Primitive>>> primitives_;
+  std::vector<float> lodErrors_;
 };
 
 } // namespace triangle
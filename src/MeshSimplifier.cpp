@@ -0,0 +1,307 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace triangle {
+
+namespace {
+
+// Sum of area weighted squared distances to the planes of a vertex's
+// triangles, as the symmetric 4x4 matrix of Garland and Heckbert.
+struct Quadric {
+  double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+  double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+  double weight = 0.0;
+
+  void addPlane(const glm::vec3 &normal, float distance, double area) {
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    a2 += a * a * area, b2 += b * b * area, c2 += c * c * area;
+    d2 += d * d * area;
+    ab += a * b * area, ac += a * c * area, ad += a * d * area;
+    bc += b * c * area, bd += b * d * area, cd += c * d * area;
+    weight += area;
+  }
+
+  void add(const Quadric &other) {
+    a2 += other.a2, b2 += other.b2, c2 += other.c2, d2 += other.d2;
+    ab += other.ab, ac += other.ac, ad += other.ad;
+    bc += other.bc, bd += other.bd, cd += other.cd;
+    weight += other.weight;
+  }
+
+  double evaluate(const glm::vec3 &position) const {
+    double x = position.x, y = position.y, z = position.z;
+    return a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+           2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+           2.0 * (ad * x + bd * y + cd * z);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+} // namespace
+
+// Squared distance moving from onto to adds, averaged over both quadrics.
+static double collapseCost(const std::vector<Quadric> &quadrics,
+                           const std::vector<glm::vec3> &positions,
+                           uint32_t from, uint32_t to) {
+  const auto &a = quadrics[from], &b = quadrics[to];
+  const auto weight = a.weight + b.weight;
+  if (weight <= 0.0) {
+    return 0.0;
+  }
+  return std::fabs(a.evaluate(positions[to]) + b.evaluate(positions[to])) /
+         weight;
+}
+
+// Vertices that share their position with another one, or sit on an edge
+// used by one triangle or more than two.
+static std::vector<uint8_t> findLockedVertices(
+    const std::vector<uint32_t> &indices,
+    const std::vector<glm::vec3> &positions) {
+  std::vector<uint8_t> locked(positions.size(), 0);
+  std::vector<uint8_t> used(positions.size(), 0);
+  for (auto index : indices) {
+    used[index] = 1;
+  }
+  std::unordered_map<uint64_t, uint32_t> firstAtPosition;
+  for (uint32_t vertex = 0; vertex < positions.size(); ++vertex) {
+    if (!used[vertex]) {
+      continue;
+    }
+    uint32_t bits[3];
+    memcpy(bits, &positions[vertex], sizeof(bits));
+    auto key = (uint64_t(bits[0]) * 73856093u) ^
+               (uint64_t(bits[1]) * 19349663u << 21) ^
+               (uint64_t(bits[2]) * 83492791u << 42);
+    auto inserted = firstAtPosition.emplace(key, vertex);
+    if (!inserted.second) {
+      auto other = inserted.first->second;
+      if (positions[other] == positions[vertex]) {
+        locked[other] = locked[vertex] = 1;
+      } else {
+        // A hash collision only costs a locked vertex.
+        locked[vertex] = 1;
+      }
+    }
+  }
+  std::unordered_map<uint64_t, uint32_t> edgeUses;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for (auto e = 0; e < 3; ++e) {
+      auto a = indices[i + e], b = indices[i + (e + 1) % 3];
+      ++edgeUses[uint64_t(std::min(a, b)) << 32 | std::max(a, b)];
+    }
+  }
+  for (auto &edge : edgeUses) {
+    if (edge.second != 2) {
+      locked[edge.first >> 32] = 1;
+      locked[edge.first & 0xFFFFFFFF] = 1;
+    }
+  }
+  return locked;
+}
+
+// Whether moving from onto to keeps every other triangle around from facing
+// roughly the same way.
+static bool keepsOrientation(const std::vector<uint32_t> &indices,
+                             const std::vector<glm::vec3> &positions,
+                             const uint32_t *triangles, uint32_t count,
+                             uint32_t from, uint32_t to) {
+  for (auto t = 0u; t < count; ++t) {
+    const auto *triangle = &indices[triangles[t] * 3];
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      continue;
+    }
+    glm::vec3 before[3], after[3];
+    for (auto c = 0; c < 3; ++c) {
+      before[c] = positions[triangle[c]];
+      after[c] = positions[triangle[c] == from ? to : triangle[c]];
+    }
+    auto normalBefore =
+        glm::cross(before[1] - before[0], before[2] - before[0]);
+    auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+    auto lengths = glm::length(normalBefore) * glm::length(normalAfter);
+    if (lengths > 0.0f &&
+        glm::dot(normalBefore, normalAfter) < 0.25f * lengths) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// One pass of collapses, cheapest first, each leaving the triangles around
+// it alone for the rest of the pass. Returns false when none was possible.
+static bool collapseEdges(std::vector<uint32_t> &indices,
+                          const std::vector<glm::vec3> &positions,
+                          const std::vector<uint8_t> &locked,
+                          size_t targetIndexCount, double maxCost,
+                          std::vector<Quadric> &quadrics, double &error) {
+  const auto vertexCount = positions.size();
+  const auto triangleCount = uint32_t(indices.size() / 3);
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (auto index : indices) {
+    ++offsets[index + 1];
+  }
+  for (auto v = 0u; v < vertexCount; ++v) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> triangles(indices.size());
+  {
+    auto fill = offsets;
+    for (auto i = 0u; i < indices.size(); ++i) {
+      triangles[fill[indices[i]]++] = i / 3;
+    }
+  }
+  std::vector<Collapse> collapses;
+  for (auto t = 0u; t < triangleCount; ++t) {
+    for (auto e = 0; e < 3; ++e) {
+      auto a = indices[t * 3 + e], b = indices[t * 3 + (e + 1) % 3];
+      if (!locked[a]) {
+        collapses.push_back({a, b, collapseCost(quadrics, positions, a, b)});
+      }
+      if (!locked[b]) {
+        collapses.push_back({b, a, collapseCost(quadrics, positions, b, a)});
+      }
+    }
+  }
+  std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse &a, const Collapse &b) {
+              return a.cost < b.cost;
+            });
+  std::vector<uint8_t> touched(vertexCount, 0);
+  std::vector<uint32_t> remap(vertexCount);
+  for (auto v = 0u; v < vertexCount; ++v) {
+    remap[v] = v;
+  }
+  const auto trianglesToRemove =
+      std::max<size_t>((indices.size() - targetIndexCount) / 3, 1);
+  size_t removed = 0;
+  auto collapsed = false;
+  for (auto &collapse : collapses) {
+    if (collapse.cost > maxCost || removed >= trianglesToRemove) {
+      break;
+    }
+    const auto from = collapse.from, to = collapse.to;
+    if (touched[from] || touched[to]) {
+      continue;
+    }
+    const auto *fromTriangles = &triangles[offsets[from]];
+    const auto fromCount = offsets[from + 1] - offsets[from];
+    if (!keepsOrientation(indices, positions, fromTriangles, fromCount, from,
+                          to)) {
+      continue;
+    }
+    for (auto t = 0u; t < fromCount; ++t) {
+      const auto *triangle = &indices[fromTriangles[t] * 3];
+      removed += triangle[0] == to || triangle[1] == to || triangle[2] == to;
+      touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+    }
+    remap[from] = to;
+    quadrics[to].add(quadrics[from]);
+    error = std::max(error, collapse.cost);
+    collapsed = true;
+  }
+  size_t write = 0;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    auto a = remap[indices[i]], b = remap[indices[i + 1]],
+         c = remap[indices[i + 2]];
+    if (a != b && b != c && c != a) {
+      indices[write++] = a;
+      indices[write++] = b;
+      indices[write++] = c;
+    }
+  }
+  indices.resize(write);
+  return collapsed;
+}
+
+// Simplifies down to each of the decreasing targets in turn, so that later
+// ones keep the quadrics and error of the collapses before, and returns the
+// mesh at each one reached. Ends early once no collapse is left within
+// maxError.
+static std::vector<SimplifiedMesh>
+simplify(const std::vector<uint32_t> &indices,
+         const std::vector<glm::vec3> &positions,
+         const std::vector<size_t> &targetIndexCounts, float maxError) {
+  std::vector<Quadric> quadrics(positions.size());
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const auto &p0 = positions[indices[i]], &p1 = positions[indices[i + 1]],
+               &p2 = positions[indices[i + 2]];
+    auto normal = glm::cross(p1 - p0, p2 - p0);
+    auto length = glm::length(normal);
+    if (length <= 0.0f) {
+      continue;
+    }
+    normal /= length;
+    for (auto c = 0; c < 3; ++c) {
+      quadrics[indices[i + c]].addPlane(normal, -glm::dot(normal, p0),
+                                        length * 0.5);
+    }
+  }
+  const auto locked = findLockedVertices(indices, positions);
+  const auto maxCost = double(maxError) * maxError;
+  double error = 0.0;
+  std::vector<SimplifiedMesh> meshes;
+  auto current = indices;
+  for (auto targetIndexCount : targetIndexCounts) {
+    while (current.size() > targetIndexCount &&
+           collapseEdges(current, positions, locked, targetIndexCount,
+                         maxCost, quadrics, error)) {
+    }
+    meshes.push_back({current, float(std::sqrt(error))});
+    if (current.size() > targetIndexCount) {
+      break;
+    }
+  }
+  return meshes;
+}
+
+SimplifiedMesh simplifyMesh(const std::vector<uint32_t> &indices,
+                            const std::vector<glm::vec3> &positions,
+                            size_t targetIndexCount, float maxError) {
+  return simplify(indices, positions, {targetIndexCount}, maxError).front();
+}
+
+std::vector<SimplifiedMesh>
+simplifyLods(const std::vector<uint32_t> &indices,
+             const std::vector<glm::vec3> &positions, unsigned int maxLevels) {
+  std::vector<size_t> targets;
+  for (auto level = 1u; level <= maxLevels; ++level) {
+    targets.push_back((indices.size() >> level) / 3 * 3);
+  }
+  auto meshes = simplify(indices, positions, targets, FLT_MAX);
+  auto previousCount = indices.size();
+  for (auto i = 0u; i < meshes.size(); ++i) {
+    if (meshes[i].indices.empty() ||
+        meshes[i].indices.size() * 5 > previousCount * 4) {
+      meshes.resize(i);
+      break;
+    }
+    previousCount = meshes[i].indices.size();
+  }
+  return meshes;
+}
+
+} // namespace triangle
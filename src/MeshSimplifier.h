@@ -0,0 +1,51 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+struct SimplifiedMesh {
+  std::vector<uint32_t> indices;
+  float error = 0.0f;
+};
+
+// Collapses edges of a triangle list, cheapest first by quadric error, until
+// it has at most targetIndexCount indices or the next collapse would move the
+// surface by more than maxError. Vertices only collapse onto other existing
+// vertices, so the result indexes the same vertex buffer. Vertices on open
+// borders or attribute seams, sharing their position with another vertex,
+// never move. error is the largest distance a collapse moved the surface by,
+// in mesh units.
+SimplifiedMesh simplifyMesh(const std::vector<uint32_t> &indices,
+                            const std::vector<glm::vec3> &positions,
+                            size_t targetIndexCount,
+                            float maxError = FLT_MAX);
+
+// Up to maxLevels successive simplifications, each aiming at half the
+// triangles of the one before and continuing from it, so errors accumulate.
+// Stops once a level saves less than a fifth.
+std::vector<SimplifiedMesh>
+simplifyLods(const std::vector<uint32_t> &indices,
+             const std::vector<glm::vec3> &positions, unsigned int maxLevels);
+
+} // namespace triangle
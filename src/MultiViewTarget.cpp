@@ -0,0 +1,157 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MultiViewTarget.h"
+#include "Common.h"
+#include <algorithm>
+#include <cmath>
+
+namespace triangle {
+
+MultiViewTarget::MultiViewTarget(unsigned int viewWidth,
+                                 unsigned int viewHeight,
+                                 unsigned int viewCount, ViewLayout layout)
+    : viewWidth_(viewWidth), viewHeight_(viewHeight),
+      viewCount_(std::max(viewCount, 1u)), layout_(layout) {
+  GLint maxSize = 0, maxLayers = 0;
+  GL_CHECK(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize));
+  GL_CHECK(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+  if (layout_ == ViewLayout::ATLAS) {
+    columns_ = unsigned(std::ceil(std::sqrt(float(viewCount_))));
+    rows_ = (viewCount_ + columns_ - 1) / columns_;
+  }
+  auto width = viewWidth_ * columns_, height = viewHeight_ * rows_;
+  if (width > unsigned(maxSize) || height > unsigned(maxSize) ||
+      (layout_ == ViewLayout::LAYERED && viewCount_ > unsigned(maxLayers))) {
+    std::cout << "Multi-view target exceeds the texture limits, size = "
+              << maxSize << ", layers = " << maxLayers << std::endl;
+    return;
+  }
+  GL_CHECK(glGenTextures(1, &colorTexture_));
+  auto target =
+      layout_ == ViewLayout::ATLAS ? GL_TEXTURE_2D : GL_TEXTURE_2D_ARRAY;
+  GL_CHECK(glBindTexture(target, colorTexture_));
+  if (layout_ == ViewLayout::ATLAS) {
+    GL_CHECK(glTexStorage2D(target, 1, GL_RGBA8, width, height));
+  } else {
+    GL_CHECK(
+        glTexStorage3D(target, 1, GL_RGBA8, width, height, viewCount_));
+  }
+  GL_CHECK(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  GL_CHECK(glBindTexture(target, 0));
+  GL_CHECK(glGenRenderbuffers(1, &depthRenderbuffer_));
+  GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer_));
+  GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width,
+                                 height));
+  GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+  GL_CHECK(glGenFramebuffers(1, &framebuffer_));
+  bind();
+  if (layout_ == ViewLayout::ATLAS) {
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                    GL_TEXTURE_2D, colorTexture_, 0));
+  } else {
+    GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       colorTexture_, 0, 0));
+  }
+  GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                     GL_RENDERBUFFER, depthRenderbuffer_));
+  auto status = GL_CHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER));
+  complete_ = status == GL_FRAMEBUFFER_COMPLETE;
+  unbind();
+}
+
+MultiViewTarget::~MultiViewTarget() {
+  GL_CHECK(glDeleteFramebuffers(1, &framebuffer_));
+  GL_CHECK(glDeleteRenderbuffers(1, &depthRenderbuffer_));
+  GL_CHECK(glDeleteTextures(1, &colorTexture_));
+}
+
+bool MultiViewTarget::isComplete() { return complete_; }
+
+// Remembers the current framebuffer for unbind(). An atlas is cleared here
+// in one go, layers are cleared as they are bound.
+void MultiViewTarget::bind() {
+  GL_CHECK(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer_));
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_));
+  if (complete_ && layout_ == ViewLayout::ATLAS) {
+    GL_CHECK(glViewport(0, 0, viewWidth_ * columns_, viewHeight_ * rows_));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+  }
+}
+
+void MultiViewTarget::bindView(unsigned int view) {
+  GLint x, y;
+  getViewOrigin(view, x, y);
+  GL_CHECK(glViewport(x, y, viewWidth_, viewHeight_));
+  if (layout_ == ViewLayout::LAYERED) {
+    GL_CHECK(glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       colorTexture_, 0, view));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+  } else if (view > 0) {
+    // Hands the previous view to the driver as a layer switch does, so that a
+    // binning rasterizer works through one view at a time instead of holding
+    // the triangles of the whole atlas.
+    GL_CHECK(glFlush());
+  }
+}
+
+void MultiViewTarget::unbind() {
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer_));
+}
+
+// Blocking read of one view, RGBA8 with the bottom row first.
+void MultiViewTarget::readView(unsigned int view,
+                               std::vector<unsigned char> &pixels) {
+  pixels.resize(viewWidth_ * viewHeight_ * 4);
+  GLint previousReadFramebuffer = 0;
+  GL_CHECK(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING,
+                         &previousReadFramebuffer));
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_));
+  if (layout_ == ViewLayout::LAYERED) {
+    GL_CHECK(glFramebufferTextureLayer(GL_READ_FRAMEBUFFER,
+                                       GL_COLOR_ATTACHMENT0, colorTexture_, 0,
+                                       view));
+  }
+  GLint x, y;
+  getViewOrigin(view, x, y);
+  GL_CHECK(glReadPixels(x, y, viewWidth_, viewHeight_, GL_RGBA,
+                        GL_UNSIGNED_BYTE, pixels.data()));
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFramebuffer));
+}
+
+GLuint MultiViewTarget::getColorTexture() { return colorTexture_; }
+
+ViewLayout MultiViewTarget::getLayout() { return layout_; }
+
+unsigned int MultiViewTarget::getViewCount() { return viewCount_; }
+
+unsigned int MultiViewTarget::getViewWidth() { return viewWidth_; }
+
+unsigned int MultiViewTarget::getViewHeight() { return viewHeight_; }
+
+unsigned int MultiViewTarget::getColumns() { return columns_; }
+
+void MultiViewTarget::getViewOrigin(unsigned int view, GLint &x, GLint &y) {
+  if (layout_ == ViewLayout::LAYERED) {
+    x = y = 0;
+    return;
+  }
+  x = (view % columns_) * viewWidth_;
+  y = (view / columns_) * viewHeight_;
+}
+
+} // namespace triangle
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <vector>
+
+namespace triangle {
+
+enum class ViewLayout { ATLAS, LAYERED };
+
+// Offscreen RGBA8 target with one viewWidth x viewHeight image per view,
+// either as tiles of a single texture (row major, bottom left first) or as
+// the layers of a 2D array texture. Depth is shared between the views.
+class MultiViewTarget {
+
+public:
+  MultiViewTarget(unsigned int viewWidth, unsigned int viewHeight,
+                  unsigned int viewCount, ViewLayout layout);
+  ~MultiViewTarget();
+  bool isComplete();
+  void bind();
+  void bindView(unsigned int view);
+  void unbind();
+  void readView(unsigned int view, std::vector<unsigned char> &pixels);
+  GLuint getColorTexture();
+  ViewLayout getLayout();
+  unsigned int getViewCount();
+  unsigned int getViewWidth();
+  unsigned int getViewHeight();
+  unsigned int getColumns();
+
+private:
+  void getViewOrigin(unsigned int view, GLint &x, GLint &y);
+  unsigned int viewWidth_;
+  unsigned int viewHeight_;
+  unsigned int viewCount_;
+  ViewLayout layout_;
+  unsigned int columns_ = 1;
+  unsigned int rows_ = 1;
+  GLuint framebuffer_ = 0;
+  GLuint colorTexture_ = 0;
+  GLuint depthRenderbuffer_ = 0;
+  GLint previousFramebuffer_ = 0;
+  bool complete_ = false;
+};
+
+} // namespace triangle
@@ -21,23 +21,27 @@
 
 namespace triangle {
 
-Node::Node(std::shared_ptr<Node> parent)
-    : parent_(std::move(parent)), matrix_(glm::mat4(1.0f)) {}
-
-void Node::draw() {
-  if (mesh_ != nullptr) {
-    mesh_->draw();
-  }
+Node::Node(std::shared_ptr<TransformStore> transformStore,
+           const std::shared_ptr<Node> &parent)
+    : transformStore_(std::move(transformStore)) {
+  transformIndex_ = transformStore_->add(
+      parent != nullptr ? int(parent->transformIndex_) : -1, glm::mat4(1.0f));
 }
 
-void Node::setMatrix(const glm::mat4 &mat) { this->matrix_ = mat; }
+void Node::setMatrix(const glm::mat4 &mat) {
+  transformStore_->setLocalMatrix(transformIndex_, mat);
+}
 
-const glm::mat4 &Node::getMatrix() { return matrix_; }
+const glm::mat4 &Node::getMatrix() {
+  return transformStore_->getLocalMatrix(transformIndex_);
+}
 
-glm::mat4 Node::getWorldMatrix() {
-  return parent_ != nullptr ? parent_->getWorldMatrix() * matrix_ : matrix_;
+const glm::mat4 &Node::getWorldMatrix() {
+  return transformStore_->getWorldMatrix(transformIndex_);
 }
 
+unsigned int Node::getTransformIndex() { return transformIndex_; }
+
 void Node::addChild(const std::shared_ptr<Node> &node) {
   children_.push_back(node);
 }
@@ -46,6 +50,37 @@ void Node::setMesh(std::shared_ptr<Mesh> mesh) {
   this->mesh_ = std::move(mesh);
 }
 
+const std::shared_ptr<Mesh> &Node::getMesh() { return mesh_; }
+
+// meshes starts with the node's own mesh.
+void Node::setLodMeshes(std::vector<std::shared_ptr<Mesh>> meshes,
+                        std::vector<float> screenCoverages) {
+  lodMeshes_ = std::move(meshes);
+  lodScreenCoverages_ = std::move(screenCoverages);
+}
+
+const std::vector<std::shared_ptr<Mesh>> &Node::getLodMeshes() {
+  return lodMeshes_;
+}
+
+const std::vector<float> &Node::getLodScreenCoverages() {
+  return lodScreenCoverages_;
+}
+
+unsigned int Node::getLod() { return lod_; }
+
+void Node::setLod(unsigned int lod) { lod_ = lod; }
+
+void Node::setSkin(std::shared_ptr<Skin> skin) { skin_ = std::move(skin); }
+
+const std::shared_ptr<Skin> &Node::getSkin() { return skin_; }
+
+void Node::setJointOffset(unsigned int jointOffset) {
+  jointOffset_ = jointOffset;
+}
+
+unsigned int Node::getJointOffset() { return jointOffset_; }
+
 const std::vector<std::shared_ptr<Node>> &Node::getChildren() {
   return children_;
 }
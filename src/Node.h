@@ -18,6 +18,8 @@
 
 #include "Camera.h"
 #include "Mesh.h"
+#include "Skin.h"
+#include "TransformStore.h"
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
@@ -26,23 +28,45 @@ namespace triangle {
 
 class Scene;
 
+// A scene graph node is a handle into a TransformStore entry plus the mesh
+// and children attached to it. Nodes using MSFT_lod also hold the meshes of
+// their coarser levels and the screen coverage each level starts below. The
+// level last drawn is kept for hysteresis. Skinned mesh nodes hold their skin
+// and where its joints start in the frame's joint palette.
 class Node {
 
 public:
-  Node(std::shared_ptr<Node> parent = nullptr);
+  Node(std::shared_ptr<TransformStore> transformStore,
+       const std::shared_ptr<Node> &parent = nullptr);
   void setMatrix(const glm::mat4 &mat);
   const glm::mat4 &getMatrix();
-  glm::mat4 getWorldMatrix();
+  const glm::mat4 &getWorldMatrix();
+  unsigned int getTransformIndex();
   void addChild(const std::shared_ptr<Node> &node);
   void setMesh(std::shared_ptr<Mesh> mesh);
+  const std::shared_ptr<Mesh> &getMesh();
+  void setLodMeshes(std::vector<std::shared_ptr<Mesh>> meshes,
+                    std::vector<float> screenCoverages);
+  const std::vector<std::shared_ptr<Mesh>> &getLodMeshes();
+  const std::vector<float> &getLodScreenCoverages();
+  unsigned int getLod();
+  void setLod(unsigned int lod);
+  void setSkin(std::shared_ptr<Skin> skin);
+  const std::shared_ptr<Skin> &getSkin();
+  void setJointOffset(unsigned int jointOffset);
+  unsigned int getJointOffset();
   const std::vector<std::shared_ptr<Node>> &getChildren();
-  void draw();
 
 private:
   std::vector<std::shared_ptr<Node>> children_;
-  std::shared_ptr<Node> parent_;
-  glm::mat4 matrix_;
+  std::shared_ptr<TransformStore> transformStore_;
+  unsigned int transformIndex_;
   std::shared_ptr<Mesh> mesh_;
+  std::vector<std::shared_ptr<Mesh>> lodMeshes_;
+  std::vector<float> lodScreenCoverages_;
+  unsigned int lod_ = 0;
+  std::shared_ptr<Skin> skin_;
+  unsigned int jointOffset_ = 0;
 };
 
 } // namespace triangle
\ No newline at end of file
@@ -16,6 +16,8 @@
 
 #include "Primitive.h"
 #include "Common.h"
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 namespace triangle {
@@ -28,15 +30,155 @@ void Primitive::setMaterial(std::shared_ptr<Material> material) {
   material_ = std::move(material);
 }
 
-void Primitive::draw() {
-  material_->bind();
-  GL_CHECK(glBindVertexArray(vao_));
-  if (offset_ >= 0) {
-    GL_CHECK(glDrawElements(mode_, count_, componentType_, (void *)offset_));
+void Primitive::bind(GLStateCache &stateCache) {
+  material_->bind(stateCache);
+  stateCache.bindVertexArray(vao_);
+}
+
+void Primitive::draw(int instanceCount, unsigned int lod) {
+  if (lod > 0 && lod <= lods_.size()) {
+    const auto &level = lods_[lod - 1];
+    GL_CHECK(glDrawElementsInstanced(mode_, level.count, componentType_,
+                                     (void *)intptr_t(level.offset),
+                                     instanceCount));
+  } else if (offset_ >= 0) {
+    GL_CHECK(glDrawElementsInstanced(mode_, count_, componentType_,
+                                     (void *)intptr_t(offset_), instanceCount));
   } else {
-    GL_CHECK(glDrawArrays(mode_, 0, count_));
+    GL_CHECK(glDrawArraysInstanced(mode_, 0, count_, instanceCount));
+  }
+}
+
+const std::shared_ptr<Material> &Primitive::getMaterial() { return material_; }
+
+GLuint Primitive::getVao() { return vao_; }
+
+void Primitive::setIndexOffset(int offset, unsigned int lod) {
+  if (lod == 0) {
+    offset_ = offset;
+  } else if (lod <= lods_.size()) {
+    lods_[lod - 1].offset = offset;
+  }
+}
+
+unsigned int Primitive::getTriangleCount(unsigned int lod) {
+  if (lod > 0 && lod <= lods_.size()) {
+    return lods_[lod - 1].count / 3;
+  }
+  if (mode_ == GL_TRIANGLES) {
+    return count_ / 3;
+  }
+  if (mode_ == GL_TRIANGLE_STRIP || mode_ == GL_TRIANGLE_FAN) {
+    return std::max(count_ - 2, 0);
+  }
+  return 0;
+}
+
+// Levels are added finest first, with the index type of level 0.
+void Primitive::addLod(int offset, int count, float error) {
+  lods_.push_back({offset, count, error});
+}
+
+unsigned int Primitive::getLodCount() { return lods_.size() + 1; }
+
+float Primitive::getLodError(unsigned int lod) {
+  return lod > 0 && lod <= lods_.size() ? lods_[lod - 1].error : 0.0f;
+}
+
+void Primitive::setBounds(const glm::vec3 &min, const glm::vec3 &max) {
+  boundsMin_ = min;
+  boundsMax_ = max;
+}
+
+const glm::vec3 &Primitive::getBoundsMin() { return boundsMin_; }
+
+const glm::vec3 &Primitive::getBoundsMax() { return boundsMax_; }
+
+// Maps quantized vertex positions back to the mesh space, applied to the
+// model matrix of each instance. Bounds stay in mesh space.
+void Primitive::setPositionTransform(const glm::mat4 &positionTransform) {
+  positionTransform_ = positionTransform;
+  hasPositionTransform_ = positionTransform != glm::mat4(1.0f);
+}
+
+bool Primitive::hasPositionTransform() { return hasPositionTransform_; }
+
+const glm::mat4 &Primitive::getPositionTransform() {
+  return positionTransform_;
+}
+
+void Primitive::setSkinned(bool skinned) { skinned_ = skinned; }
+
+bool Primitive::isSkinned() { return skinned_; }
+
+void Primitive::setCollisionGeometry(
+    std::shared_ptr<std::vector<glm::vec3>> positions,
+    std::shared_ptr<std::vector<uint32_t>> indices) {
+  positions_ = std::move(positions);
+  indices_ = std::move(indices);
+  // Checked once here so intersect() can index without bounds checks; a
+  // primitive with bad indices falls back to its bounds.
+  if (positions_ != nullptr &&
+      (indices_ == nullptr ||
+       std::any_of(indices_->begin(), indices_->end(), [&](uint32_t index) {
+         return index >= positions_->size();
+       }))) {
+    positions_ = nullptr;
+    indices_ = nullptr;
+  }
+}
+
+bool Primitive::intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                          float &distance) {
+  auto t0 = (boundsMin_ - origin) / direction;
+  auto t1 = (boundsMax_ - origin) / direction;
+  auto entries = glm::min(t0, t1);
+  auto exits = glm::max(t0, t1);
+  auto entry =
+      std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+  auto exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, distance));
+  if (entry > exit) {
+    return false;
+  }
+  if (positions_ == nullptr) {
+    distance = entry;
+    return true;
+  }
+  auto hit = false;
+  auto triangleCount =
+      (indices_->empty() ? positions_->size() : indices_->size()) / 3;
+  const auto &positions = *positions_;
+  const auto &indices = *indices_;
+  for (size_t i = 0; i < triangleCount; ++i) {
+    auto i0 = indices.empty() ? i * 3 : indices[i * 3];
+    auto i1 = indices.empty() ? i * 3 + 1 : indices[i * 3 + 1];
+    auto i2 = indices.empty() ? i * 3 + 2 : indices[i * 3 + 2];
+    const auto &p0 = positions[i0];
+    auto edge1 = positions[i1] - p0;
+    auto edge2 = positions[i2] - p0;
+    auto p = glm::cross(direction, edge2);
+    auto determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f) {
+      continue;
+    }
+    auto inverseDeterminant = 1.0f / determinant;
+    auto s = origin - p0;
+    auto u = glm::dot(s, p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f) {
+      continue;
+    }
+    auto q = glm::cross(s, edge1);
+    auto v = glm::dot(direction, q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f) {
+      continue;
+    }
+    auto t = glm::dot(edge2, q) * inverseDeterminant;
+    if (t >= 0.0f && t < distance) {
+      distance = t;
+      hit = true;
+    }
   }
-  GL_CHECK(glBindVertexArray(0));
+  return hit;
 }
 
 } // namespace triangle
@@ -18,17 +18,47 @@
 
 #include "Material.h"
 #include <GLES3/gl3.h>
+#include <glm/glm.hpp>
 #include <memory>
+#include <vector>
 
 namespace triangle {
 
+struct PrimitiveLod {
+  int offset;
+  int count;
+  float error;
+};
+
+// Level 0 is the full index list, coarser levels of detail draw other index
+// ranges over the same vertex array.
 class Primitive {
 
 public:
   Primitive(GLuint vao, int type, int count, int componentType,
             int offset = -1);
   void setMaterial(std::shared_ptr<Material> material);
-  void draw();
+  void bind(GLStateCache &stateCache);
+  void draw(int instanceCount, unsigned int lod = 0);
+  const std::shared_ptr<Material> &getMaterial();
+  GLuint getVao();
+  void setIndexOffset(int offset, unsigned int lod = 0);
+  unsigned int getTriangleCount(unsigned int lod = 0);
+  void addLod(int offset, int count, float error);
+  unsigned int getLodCount();
+  float getLodError(unsigned int lod);
+  void setBounds(const glm::vec3 &min, const glm::vec3 &max);
+  const glm::vec3 &getBoundsMin();
+  const glm::vec3 &getBoundsMax();
+  void setPositionTransform(const glm::mat4 &positionTransform);
+  bool hasPositionTransform();
+  const glm::mat4 &getPositionTransform();
+  void setSkinned(bool skinned);
+  bool isSkinned();
+  void setCollisionGeometry(std::shared_ptr<std::vector<glm::vec3>> positions,
+                            std::shared_ptr<std::vector<uint32_t>> indices);
+  bool intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float &distance);
 
 private:
   GLuint vao_;
@@ -36,7 +66,15 @@ private:
   int count_;
   int componentType_;
   int offset_;
+  std::vector<PrimitiveLod> lods_;
   std::shared_ptr<Material> material_;
+  glm::vec3 boundsMin_{-1e30f};
+  glm::vec3 boundsMax_{1e30f};
+  glm::mat4 positionTransform_{1.0f};
+  bool hasPositionTransform_ = false;
+  bool skinned_ = false;
+  std::shared_ptr<std::vector<glm::vec3>> positions_;
+  std::shared_ptr<std::vector<uint32_t>> indices_;
 };
 
 } // namespace triangle
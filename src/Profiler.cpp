@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+namespace triangle {
+
+Profiler::~Profiler() { stopTrace(); }
+
+void Profiler::beginFrame() {
+  openScopes_.clear();
+  timings_.clear();
+}
+
+void Profiler::beginScope(const char *name) {
+  openScopes_.push_back({name, ProfileClock::now()});
+}
+
+void Profiler::endScope() {
+  auto end = ProfileClock::now();
+  const auto &scope = openScopes_.back();
+  addTiming(scope.name,
+            std::chrono::duration<double, std::milli>(end - scope.start)
+                .count());
+  if (tracing_) {
+    writeEvent(scope.name, scope.start, end,
+               getThreadIndex(std::this_thread::get_id()));
+  }
+  openScopes_.pop_back();
+}
+
+void Profiler::addTiming(const char *name, double milliseconds) {
+  auto iterator = std::find_if(
+      timings_.begin(), timings_.end(), [&](const ProfileTiming &timing) {
+        return std::strcmp(timing.name, name) == 0;
+      });
+  if (iterator == timings_.end()) {
+    timings_.push_back({name, 1, milliseconds});
+  } else {
+    ++iterator->calls;
+    iterator->milliseconds += milliseconds;
+  }
+}
+
+void Profiler::addEvent(const char *name, ProfileClock::time_point start,
+                        ProfileClock::time_point end, std::thread::id thread) {
+  if (tracing_ && end >= traceStart_) {
+    writeEvent(name, start, end, getThreadIndex(thread));
+  }
+}
+
+void Profiler::addScope(const char *name, ProfileClock::time_point start,
+                        ProfileClock::time_point end, std::thread::id thread) {
+  addTiming(name,
+            std::chrono::duration<double, std::milli>(end - start).count());
+  addEvent(name, start, end, thread);
+}
+
+void Profiler::addCounter(const char *name, double value) {
+  if (tracing_) {
+    trace_ << ",\n{\"name\":\"" << name << "\",\"ph\":\"C\",\"ts\":"
+           << getTraceMicroseconds(ProfileClock::now())
+           << ",\"pid\":1,\"tid\":0,\"args\":{\"value\":" << value << "}}";
+  }
+}
+
+const std::vector<ProfileTiming> &Profiler::getTimings() { return timings_; }
+
+bool Profiler::startTrace(const std::string &path) {
+  stopTrace();
+  trace_.open(path);
+  if (!trace_) {
+    return false;
+  }
+  trace_ << std::fixed << std::setprecision(3);
+  tracing_ = true;
+  traceStart_ = ProfileClock::now();
+  threads_.assign(1, std::this_thread::get_id());
+  trace_ << "{\"traceEvents\":[\n{\"name\":\"thread_name\",\"ph\":\"M\","
+            "\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GL thread\"}}";
+  return true;
+}
+
+void Profiler::stopTrace() {
+  if (tracing_) {
+    trace_ << "\n]}\n";
+    trace_.close();
+    tracing_ = false;
+  }
+}
+
+void Profiler::writeEvent(const char *name, ProfileClock::time_point start,
+                          ProfileClock::time_point end,
+                          unsigned int threadIndex) {
+  trace_ << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"ts\":"
+         << getTraceMicroseconds(start) << ",\"dur\":"
+         << std::chrono::duration<double, std::micro>(end - start).count()
+         << ",\"pid\":1,\"tid\":" << threadIndex << "}";
+}
+
+unsigned int Profiler::getThreadIndex(std::thread::id thread) {
+  auto iterator = std::find(threads_.begin(), threads_.end(), thread);
+  if (iterator != threads_.end()) {
+    return iterator - threads_.begin();
+  }
+  threads_.push_back(thread);
+  auto threadIndex = threads_.size() - 1;
+  trace_ << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << threadIndex << ",\"args\":{\"name\":\"worker " << threadIndex
+         << "\"}}";
+  return threadIndex;
+}
+
+double Profiler::getTraceMicroseconds(ProfileClock::time_point time) {
+  return std::chrono::duration<double, std::micro>(time - traceStart_).count();
+}
+
+} // namespace triangle
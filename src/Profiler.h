@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace triangle {
+
+using ProfileClock = std::chrono::steady_clock;
+
+struct ProfileTiming {
+  const char *name;
+  unsigned int calls;
+  double milliseconds;
+};
+
+// CPU scope timings of the current frame summed per scope name, plus an
+// optional Chrome trace (chrome://tracing or Perfetto) written as scopes end.
+// Only used from one thread at a time, work timed on other threads is passed
+// in afterwards with addEvent(), or addScope() to count it as a scope too.
+class Profiler {
+
+public:
+  ~Profiler();
+  void beginFrame();
+  void beginScope(const char *name);
+  void endScope();
+  void addEvent(const char *name, ProfileClock::time_point start,
+                ProfileClock::time_point end, std::thread::id thread);
+  void addScope(const char *name, ProfileClock::time_point start,
+                ProfileClock::time_point end, std::thread::id thread);
+  void addCounter(const char *name, double value);
+  const std::vector<ProfileTiming> &getTimings();
+  bool startTrace(const std::string &path);
+  void stopTrace();
+
+private:
+  struct OpenScope {
+    const char *name;
+    ProfileClock::time_point start;
+  };
+  void addTiming(const char *name, double milliseconds);
+  void writeEvent(const char *name, ProfileClock::time_point start,
+                  ProfileClock::time_point end, unsigned int threadIndex);
+  unsigned int getThreadIndex(std::thread::id thread);
+  double getTraceMicroseconds(ProfileClock::time_point time);
+  std::vector<OpenScope> openScopes_;
+  std::vector<ProfileTiming> timings_;
+  std::vector<std::thread::id> threads_;
+  std::ofstream trace_;
+  ProfileClock::time_point traceStart_;
+  bool tracing_ = false;
+};
+
+class ProfileScope {
+
+public:
+  ProfileScope(Profiler &profiler, const char *name) : profiler_(profiler) {
+    profiler_.beginScope(name);
+  }
+  ~ProfileScope() { profiler_.endScope(); }
+
+private:
+  Profiler &profiler_;
+};
+
+// Builds without TRIANGLE_PROFILING drop the scopes and GPU queries entirely.
+#ifdef TRIANGLE_PROFILING
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+#define PROFILE_SCOPE(profiler, name)                                          \
+  ProfileScope PROFILE_JOIN(profileScope, __LINE__)(profiler, name)
+#else
+#define PROFILE_SCOPE(profiler, name)
+#endif
+
+} // namespace triangle
@@ -16,29 +16,89 @@
 
 #include "Program.h"
 #include "Common.h"
+#include <algorithm>
+#include <chrono>
 
 Program::Program(const std::string &vertexShaderCode,
-                 const std::string &fragmentShaderCode) {
+                 const std::string &fragmentShaderCode,
+                 triangle::ProgramBinaryCache *binaryCache) {
 
   program_ = GL_CHECK(glCreateProgram());
+  if (binaryCache != nullptr &&
+      binaryCache->load(program_, vertexShaderCode, fragmentShaderCode)) {
+    linked_ = true;
+    return;
+  }
+  auto compileStart = std::chrono::steady_clock::now();
 
-  auto vertexShader = GL_CHECK(glCreateShader(GL_VERTEX_SHADER));
-  auto fragmentShader = GL_CHECK(glCreateShader(GL_FRAGMENT_SHADER));
-
-  auto pVertexShader = vertexShaderCode.c_str();
-  GL_CHECK(glShaderSource(vertexShader, 1, &pVertexShader, nullptr));
-  auto pFragmentShader = fragmentShaderCode.c_str();
-  GL_CHECK(glShaderSource(fragmentShader, 1, &pFragmentShader, nullptr));
-
-  GL_CHECK(glCompileShader(vertexShader));
-  GL_CHECK(glCompileShader(fragmentShader));
+  auto vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode);
+  auto fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode);
 
   GL_CHECK(glAttachShader(program_, vertexShader));
   GL_CHECK(glAttachShader(program_, fragmentShader));
+  if (binaryCache != nullptr) {
+    GL_CHECK(glProgramParameteri(program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                 GL_TRUE));
+  }
 
   GL_CHECK(glLinkProgram(program_));
+  GL_CHECK(glDetachShader(program_, vertexShader));
+  GL_CHECK(glDetachShader(program_, fragmentShader));
+  GL_CHECK(glDeleteShader(vertexShader));
+  GL_CHECK(glDeleteShader(fragmentShader));
+
+  GLint linked = GL_FALSE;
+  GL_CHECK(glGetProgramiv(program_, GL_LINK_STATUS, &linked));
+  linked_ = linked == GL_TRUE;
+  if (!linked_) {
+    GLint length = 0;
+    GL_CHECK(glGetProgramiv(program_, GL_INFO_LOG_LENGTH, &length));
+    std::string log(std::max(length, 1), '\0');
+    GL_CHECK(glGetProgramInfoLog(program_, log.size(), nullptr, &log[0]));
+    std::cout << "Program link error = " << log.c_str() << std::endl;
+    return;
+  }
+  if (binaryCache != nullptr) {
+    binaryCache->addCompileTime(
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - compileStart)
+            .count());
+    binaryCache->store(program_, vertexShaderCode, fragmentShaderCode);
+  }
 }
 
+Program::~Program() { GL_CHECK(glDeleteProgram(program_)); }
+
 void Program::bind() { GL_CHECK(glUseProgram(program_)); }
 
 GLuint Program::getProgram() { return program_; }
+
+bool Program::isLinked() { return linked_; }
+
+// Compile errors are logged here, linking the shader then fails as well.
+GLuint Program::compileShader(GLenum type, const std::string &code) {
+  auto shader = GL_CHECK(glCreateShader(type));
+  auto pCode = code.c_str();
+  GL_CHECK(glShaderSource(shader, 1, &pCode, nullptr));
+  GL_CHECK(glCompileShader(shader));
+  GLint compiled = GL_FALSE;
+  GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+  if (compiled != GL_TRUE) {
+    GLint length = 0;
+    GL_CHECK(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length));
+    std::string log(std::max(length, 1), '\0');
+    GL_CHECK(glGetShaderInfoLog(shader, log.size(), nullptr, &log[0]));
+    std::cout << "Shader compile error = " << log.c_str() << std::endl;
+  }
+  return shader;
+}
+
+GLint Program::getUniformLocation(const std::string &name) {
+  auto iterator = uniformLocations_.find(name);
+  if (iterator != uniformLocations_.end()) {
+    return iterator->second;
+  }
+  auto location = GL_CHECK(glGetUniformLocation(program_, name.c_str()));
+  uniformLocations_[name] = location;
+  return location;
+}
@@ -16,17 +16,28 @@
 
 #pragma once
 
+#include "ProgramBinaryCache.h"
 #include <GLES3/gl3.h>
 #include <string>
+#include <unordered_map>
 
+// Compiled and linked on construction, or loaded from the binary cache when
+// one is given and holds it. Failures are logged and leave isLinked() false.
 class Program {
 
 public:
   Program(const std::string &vertexShaderCode,
-          const std::string &fragmentShaderCode);
+          const std::string &fragmentShaderCode,
+          triangle::ProgramBinaryCache *binaryCache = nullptr);
+  ~Program();
   void bind();
   GLuint getProgram();
+  bool isLinked();
+  GLint getUniformLocation(const std::string &name);
 
 private:
+  GLuint compileShader(GLenum type, const std::string &code);
   GLuint program_;
+  bool linked_ = false;
+  std::unordered_map<std::string, GLint> uniformLocations_;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProgramBinaryCache.h"
+#include "Common.h"
+#include "ResourceCache.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace triangle {
+
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x47525054;
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string &directory)
+    : directory_(directory) {}
+
+// The file name hash and, stored in the file, a second hash with another
+// seed, so that a file name collision reads as a miss.
+std::string ProgramBinaryCache::getPath(const std::string &vertexShaderCode,
+                                        const std::string &fragmentShaderCode,
+                                        uint64_t &key) {
+  std::call_once(driverQueried_, [this] {
+    GLint formatCount = 0;
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount));
+    supported_ = formatCount > 0;
+    for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+      auto value = (const char *)glGetString(name);
+      driver_ += std::string(value != nullptr ? value : "") + "\n";
+    }
+  });
+  uint64_t hashes[2];
+  for (auto i = 0; i < 2; ++i) {
+    hashes[i] = hashBytes(driver_.data(), driver_.size(), 1 + i);
+    hashes[i] =
+        hashBytes(vertexShaderCode.data(), vertexShaderCode.size(), hashes[i]);
+    hashes[i] = hashBytes(fragmentShaderCode.data(), fragmentShaderCode.size(),
+                          hashes[i]);
+  }
+  key = hashes[1];
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.tprg", (unsigned long long)hashes[0]);
+  return directory_ + "/" + name;
+}
+
+// Returns true when a stored binary linked, otherwise the program is left
+// for the caller to compile.
+bool ProgramBinaryCache::load(GLuint program,
+                              const std::string &vertexShaderCode,
+                              const std::string &fragmentShaderCode) {
+  uint64_t key;
+  auto path = getPath(vertexShaderCode, fragmentShaderCode, key);
+  if (!supported_) {
+    return false;
+  }
+  std::ifstream in(path, std::ios::binary);
+  uint32_t header[2] = {0, 0};
+  uint64_t storedKey = 0;
+  uint32_t format = 0, length = 0;
+  in.read(reinterpret_cast<char *>(header), sizeof(header));
+  in.read(reinterpret_cast<char *>(&storedKey), sizeof(storedKey));
+  in.read(reinterpret_cast<char *>(&format), sizeof(format));
+  in.read(reinterpret_cast<char *>(&length), sizeof(length));
+  if (!in || header[0] != PROGRAM_CACHE_MAGIC ||
+      header[1] != PROGRAM_CACHE_VERSION || storedKey != key ||
+      length > (1u << 28)) {
+    return false;
+  }
+  std::vector<char> binary(length);
+  in.read(binary.data(), length);
+  if (!in) {
+    return false;
+  }
+  GL_CHECK(glProgramBinary(program, format, binary.data(), length));
+  GLint linked = GL_FALSE;
+  GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+  if (linked == GL_TRUE) {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    ++stats_.loaded;
+  }
+  return linked == GL_TRUE;
+}
+
+// Written to a temporary file and renamed, so that a reader never sees a
+// partial entry.
+void ProgramBinaryCache::store(GLuint program,
+                               const std::string &vertexShaderCode,
+                               const std::string &fragmentShaderCode) {
+  uint64_t key;
+  auto path = getPath(vertexShaderCode, fragmentShaderCode, key);
+  GLint length = 0;
+  if (supported_) {
+    GL_CHECK(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+  }
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  GL_CHECK(glGetProgramBinary(program, length, &length, &format,
+                              binary.data()));
+  auto temporaryPath = path + ".tmp";
+  std::ofstream out(temporaryPath, std::ios::binary);
+  const uint32_t header[] = {PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION};
+  const uint32_t formatAndLength[] = {format, uint32_t(length)};
+  out.write(reinterpret_cast<const char *>(header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(&key), sizeof(key));
+  out.write(reinterpret_cast<const char *>(formatAndLength),
+            sizeof(formatAndLength));
+  out.write(binary.data(), length);
+  out.close();
+  if (!out || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+    std::remove(temporaryPath.c_str());
+    return;
+  }
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  ++stats_.stored;
+}
+
+void ProgramBinaryCache::addCompileTime(double milliseconds) {
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  ++stats_.compiled;
+  stats_.compileMilliseconds += milliseconds;
+}
+
+ProgramBinaryCacheStats ProgramBinaryCache::getStats() {
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  return stats_;
+}
+
+} // namespace triangle
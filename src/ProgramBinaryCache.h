@@ -0,0 +1,60 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace triangle {
+
+struct ProgramBinaryCacheStats {
+  unsigned int loaded = 0;
+  unsigned int compiled = 0;
+  unsigned int stored = 0;
+  double compileMilliseconds = 0.0;
+};
+
+// Linked program binaries kept on disk, one file per program named after a
+// hash of the driver's vendor, renderer and version strings and of the
+// shader sources. A binary the driver rejects, after an update for example,
+// is compiled again and overwritten. Usable from any thread with a context
+// of the same driver current.
+class ProgramBinaryCache {
+
+public:
+  explicit ProgramBinaryCache(const std::string &directory);
+  bool load(GLuint program, const std::string &vertexShaderCode,
+            const std::string &fragmentShaderCode);
+  void store(GLuint program, const std::string &vertexShaderCode,
+             const std::string &fragmentShaderCode);
+  void addCompileTime(double milliseconds);
+  ProgramBinaryCacheStats getStats();
+
+private:
+  std::string getPath(const std::string &vertexShaderCode,
+                      const std::string &fragmentShaderCode, uint64_t &key);
+  std::string directory_;
+  std::once_flag driverQueried_;
+  std::string driver_;
+  bool supported_ = false;
+  std::mutex statsMutex_;
+  ProgramBinaryCacheStats stats_;
+};
+
+} // namespace triangle
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderQueue.h"
+#include <algorithm>
+
+namespace triangle {
+
+static const int PROGRAM_BITS = 8;
+static const int MATERIAL_BITS = 20;
+static const int VAO_BITS = 20;
+static const int DEPTH_BITS = 16;
+static const uint32_t RECORD_GRAIN_SIZE = 4096;
+
+void RenderQueue::clear() {
+  items_.clear();
+  entries_.clear();
+  stats_ = RenderQueueStats();
+}
+
+uint64_t RenderQueue::buildKey(GLuint program, unsigned int material,
+                               GLuint vao, float depth) {
+  auto quantizedDepth = uint64_t(std::min(std::max(depth, 0.0f), 1.0f) *
+                                 ((1 << DEPTH_BITS) - 1));
+  return (uint64_t(program & ((1 << PROGRAM_BITS) - 1))
+          << (MATERIAL_BITS + VAO_BITS + DEPTH_BITS)) |
+         (uint64_t(material & ((1 << MATERIAL_BITS) - 1))
+          << (VAO_BITS + DEPTH_BITS)) |
+         (uint64_t(vao & ((1 << VAO_BITS) - 1)) << DEPTH_BITS) |
+         quantizedDepth;
+}
+
+void RenderQueue::push(Primitive *primitive, GLuint program,
+                       const glm::mat4 &worldMatrix, float depth,
+                       unsigned int lod, int jointOffset) {
+  setItem(allocate(1), primitive, program, worldMatrix, depth, lod,
+          jointOffset);
+}
+
+// Returns the index of the first of count items to set with setItem.
+unsigned int RenderQueue::allocate(unsigned int count) {
+  const auto first = items_.size();
+  items_.resize(first + count);
+  entries_.resize(first + count);
+  return first;
+}
+
+void RenderQueue::setItem(unsigned int index, Primitive *primitive,
+                          GLuint program, const glm::mat4 &worldMatrix,
+                          float depth, unsigned int lod, int jointOffset) {
+  entries_[index] = {buildKey(program, primitive->getMaterial()->getId(),
+                              primitive->getVao(), depth),
+                     index};
+  items_[index] = {primitive, program,
+                   primitive->hasPositionTransform()
+                       ? worldMatrix * primitive->getPositionTransform()
+                       : worldMatrix,
+                   lod, jointOffset};
+}
+
+void RenderQueue::sort() {
+  if (sortEnabled_) {
+    radixSort();
+  }
+}
+
+void RenderQueue::radixSort() {
+  scratch_.resize(entries_.size());
+  for (auto shift = 0; shift < 64; shift += 8) {
+    size_t counts[256] = {0};
+    for (auto &entry : entries_) {
+      ++counts[(entry.key >> shift) & 0xFF];
+    }
+    if (counts[(entries_.empty() ? 0 : entries_[0].key >> shift) & 0xFF] ==
+        entries_.size()) {
+      continue;
+    }
+    size_t offset = 0;
+    for (auto &count : counts) {
+      auto size = count;
+      count = offset;
+      offset += size;
+    }
+    for (auto &entry : entries_) {
+      scratch_[counts[(entry.key >> shift) & 0xFF]++] = entry;
+    }
+    entries_.swap(scratch_);
+  }
+}
+
+// visibility is indexed in push order, items without it are skipped.
+void RenderQueue::record(CommandBuffer &commands,
+                         const std::vector<uint8_t> *visibility,
+                         JobSystem *jobSystem) {
+  submitted_.clear();
+  appendVisible(visibility);
+  copyInstances(commands);
+  recordRange(commands, 0, submitted_.size(), jobSystem);
+}
+
+// Copies the instances of every view into the buffer at once, then records
+// the views in order, each after its BEGIN_VIEW.
+void RenderQueue::recordViews(
+    CommandBuffer &commands,
+    const std::vector<std::vector<uint8_t>> &visibilities,
+    JobSystem *jobSystem) {
+  submitted_.clear();
+  viewOffsets_.assign(1, 0);
+  for (auto &visibility : visibilities) {
+    appendVisible(&visibility);
+    viewOffsets_.push_back(submitted_.size());
+  }
+  copyInstances(commands);
+  for (auto view = 0; view < visibilities.size(); ++view) {
+    commands.beginView(view);
+    recordRange(commands, viewOffsets_[view], viewOffsets_[view + 1],
+                jobSystem);
+  }
+}
+
+void RenderQueue::appendVisible(const std::vector<uint8_t> *visibility) {
+  for (auto &entry : entries_) {
+    if (visibility == nullptr || (*visibility)[entry.index]) {
+      submitted_.push_back(entry.index);
+    }
+  }
+}
+
+void RenderQueue::copyInstances(CommandBuffer &commands) {
+  auto &matrices = commands.getInstanceMatrices();
+  matrices.resize(submitted_.size());
+  for (auto i = 0; i < submitted_.size(); ++i) {
+    matrices[i] = items_[submitted_[i]].worldMatrix;
+  }
+  auto &jointOffsets = commands.getInstanceJointOffsets();
+  jointOffsets.clear();
+  if (std::any_of(submitted_.begin(), submitted_.end(), [&](uint32_t index) {
+        return items_[index].jointOffset >= 0;
+      })) {
+    for (auto index : submitted_) {
+      jointOffsets.push_back(float(std::max(items_[index].jointOffset, 0)));
+    }
+  }
+}
+
+bool RenderQueue::isSameBatch(uint32_t first, uint32_t second) {
+  const auto &a = items_[submitted_[first]];
+  const auto &b = items_[submitted_[second]];
+  return a.primitive == b.primitive && a.program == b.program &&
+         a.lod == b.lod;
+}
+
+// The first batch boundary at or after index, so chunks never split a batch.
+uint32_t RenderQueue::findBatchStart(uint32_t index, uint32_t first,
+                                     uint32_t last) {
+  while (index > first && index < last && isSameBatch(index - 1, index)) {
+    ++index;
+  }
+  return index;
+}
+
+// Chunks are recorded into buffers of their own and appended in order. A
+// chunk's state changes count from the item before it, as a serial record
+// would.
+void RenderQueue::recordRange(CommandBuffer &commands, uint32_t first,
+                              uint32_t last, JobSystem *jobSystem) {
+  stats_.instances += last - first;
+  const auto chunkCount =
+      jobSystem == nullptr
+          ? 1
+          : (last - first + RECORD_GRAIN_SIZE - 1) / RECORD_GRAIN_SIZE;
+  if (chunkCount <= 1) {
+    recordBatches(commands, nullptr, first, last, stats_);
+    return;
+  }
+  chunks_.resize(chunkCount);
+  chunkStats_.assign(chunkCount, RenderQueueStats());
+  jobSystem->parallelFor(
+      chunkCount, 1, [&](unsigned int begin, unsigned int end) {
+        for (auto chunk = begin; chunk < end; ++chunk) {
+          auto chunkFirst =
+              findBatchStart(first + chunk * RECORD_GRAIN_SIZE, first, last);
+          auto chunkLast = findBatchStart(
+              std::min(first + (chunk + 1) * RECORD_GRAIN_SIZE, last), first,
+              last);
+          chunks_[chunk].reset();
+          recordBatches(chunks_[chunk],
+                        chunkFirst > first ? &items_[submitted_[chunkFirst - 1]]
+                                           : nullptr,
+                        chunkFirst, chunkLast, chunkStats_[chunk]);
+        }
+      });
+  for (auto chunk = 0; chunk < chunkCount; ++chunk) {
+    commands.append(chunks_[chunk]);
+    stats_.draws += chunkStats_[chunk].draws;
+    stats_.triangles += chunkStats_[chunk].triangles;
+    stats_.stateChanges += chunkStats_[chunk].stateChanges;
+  }
+}
+
+// The program and primitive are only rebound when they change within the
+// range, the instance range is set for every batch since it lives in the
+// vertex array.
+void RenderQueue::recordBatches(CommandBuffer &commands,
+                                const DrawItem *previous, uint32_t first,
+                                uint32_t last, RenderQueueStats &stats) {
+  const DrawItem *bound = nullptr;
+  for (auto begin = first; begin < last;) {
+    auto &item = items_[submitted_[begin]];
+    auto end = begin + 1;
+    while (end < last && isSameBatch(begin, end)) {
+      ++end;
+    }
+    if (bound == nullptr || bound->program != item.program) {
+      commands.useProgram(item.program);
+    }
+    if (bound == nullptr || bound->program != item.program ||
+        bound->primitive != item.primitive) {
+      commands.bindPrimitive(item.primitive);
+    }
+    commands.setInstances(begin);
+    commands.draw(item.primitive, end - begin, item.lod);
+    ++stats.draws;
+    stats.triangles +=
+        uint64_t(item.primitive->getTriangleCount(item.lod)) * (end - begin);
+    stats.stateChanges += countStateChanges(previous, item);
+    previous = bound = &item;
+    begin = end;
+  }
+}
+
+void RenderQueue::setSortEnabled(bool sortEnabled) {
+  sortEnabled_ = sortEnabled;
+}
+
+unsigned int RenderQueue::countStateChanges() {
+  unsigned int stateChanges = 0;
+  const DrawItem *previous = nullptr;
+  for (auto &entry : entries_) {
+    auto &item = items_[entry.index];
+    stateChanges += countStateChanges(previous, item);
+    previous = &item;
+  }
+  return stateChanges;
+}
+
+unsigned int RenderQueue::countStateChanges(const DrawItem *previous,
+                                            const DrawItem &item) {
+  if (previous == nullptr) {
+    return 3;
+  }
+  return (previous->program != item.program) +
+         (previous->primitive->getMaterial() !=
+          item.primitive->getMaterial()) +
+         (previous->primitive->getVao() != item.primitive->getVao());
+}
+
+const RenderQueueStats &RenderQueue::getStats() { return stats_; }
+
+} // namespace triangle
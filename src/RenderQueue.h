@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "Primitive.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+struct DrawItem {
+  Primitive *primitive;
+  GLuint program;
+  glm::mat4 worldMatrix;
+  unsigned int lod;
+  int jointOffset;
+};
+
+struct RenderQueueStats {
+  unsigned int draws = 0;
+  unsigned int instances = 0;
+  uint64_t triangles = 0;
+  unsigned int stateChanges = 0;
+};
+
+// Collects the primitives of a frame and records them into a command buffer
+// ordered by a 64-bit key (program | material | vao | depth) so that state
+// changes are minimal. Consecutive items sharing a primitive and level of
+// detail are drawn as one instanced batch. Stats accumulate over the records
+// since the last clear(). One sorted queue can be recorded for several views,
+// each with its own per-item visibility. Skinned items carry the offset of
+// their joints in the joint palette, -1 for the others. Items may also be
+// allocated up front and set from several threads, and long queues are
+// recorded in parallel chunks.
+class RenderQueue {
+
+public:
+  void clear();
+  void push(Primitive *primitive, GLuint program,
+            const glm::mat4 &worldMatrix, float depth, unsigned int lod = 0,
+            int jointOffset = -1);
+  unsigned int allocate(unsigned int count);
+  void setItem(unsigned int index, Primitive *primitive, GLuint program,
+               const glm::mat4 &worldMatrix, float depth,
+               unsigned int lod = 0, int jointOffset = -1);
+  void sort();
+  void record(CommandBuffer &commands,
+              const std::vector<uint8_t> *visibility = nullptr,
+              JobSystem *jobSystem = nullptr);
+  void recordViews(CommandBuffer &commands,
+                   const std::vector<std::vector<uint8_t>> &visibilities,
+                   JobSystem *jobSystem = nullptr);
+  void setSortEnabled(bool sortEnabled);
+  unsigned int countStateChanges();
+  const RenderQueueStats &getStats();
+
+private:
+  struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+  };
+  static uint64_t buildKey(GLuint program, unsigned int material, GLuint vao,
+                           float depth);
+  static unsigned int countStateChanges(const DrawItem *previous,
+                                        const DrawItem &item);
+  void radixSort();
+  void appendVisible(const std::vector<uint8_t> *visibility);
+  void copyInstances(CommandBuffer &commands);
+  bool isSameBatch(uint32_t first, uint32_t second);
+  uint32_t findBatchStart(uint32_t index, uint32_t first, uint32_t last);
+  void recordRange(CommandBuffer &commands, uint32_t first, uint32_t last,
+                   JobSystem *jobSystem);
+  void recordBatches(CommandBuffer &commands, const DrawItem *previous,
+                     uint32_t first, uint32_t last, RenderQueueStats &stats);
+  std::vector<DrawItem> items_;
+  std::vector<SortEntry> entries_;
+  std::vector<SortEntry> scratch_;
+  std::vector<uint32_t> submitted_;
+  std::vector<uint32_t> viewOffsets_;
+  std::vector<CommandBuffer> chunks_;
+  std::vector<RenderQueueStats> chunkStats_;
+  bool sortEnabled_ = true;
+  RenderQueueStats stats_;
+};
+
+} // namespace triangle
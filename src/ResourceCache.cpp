@@ -0,0 +1,267 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ResourceCache.h"
+#include "Common.h"
+#include <cstring>
+
+namespace triangle {
+
+static const size_t VERTEX_PAGE_SIZE = 8 * 1024 * 1024;
+static const size_t INDEX_PAGE_SIZE = 4 * 1024 * 1024;
+
+// FNV-1a over 64 bit words with a final byte tail, fast enough to run over
+// every texture and vertex buffer of an asset on the loading thread.
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash) {
+  const auto *bytes = (const unsigned char *)data;
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+    hash ^= hash >> 29;
+    bytes += sizeof(word);
+  }
+  for (; size > 0; --size) {
+    hash = (hash ^ *bytes++) * 1099511628211ull;
+  }
+  return hash;
+}
+
+ResourceCache::ResourceCache()
+    : vertexArena_(std::make_shared<GeometryArena>(VERTEX_PAGE_SIZE)),
+      indexArena_(std::make_shared<GeometryArena>(INDEX_PAGE_SIZE)) {}
+
+ResourceCache::~ResourceCache() {
+  for (auto &entry : textures_) {
+    GL_CHECK(glDeleteTextures(1, &entry.second.texture));
+  }
+  if (defaultTexture_ != 0) {
+    GL_CHECK(glDeleteTextures(1, &defaultTexture_));
+  }
+}
+
+// Returns 0 when no texture with this content is resident, the caller then
+// builds it and hands it over with addTexture.
+GLuint ResourceCache::acquireTexture(uint64_t key) {
+  auto iterator = textures_.find(key);
+  if (iterator == textures_.end()) {
+    ++stats_.misses;
+    return 0;
+  }
+  ++stats_.hits;
+  ++iterator->second.references;
+  stats_.savedTextureBytes += iterator->second.bytes;
+  return iterator->second.texture;
+}
+
+void ResourceCache::addTexture(uint64_t key, GLuint texture, size_t bytes) {
+  textures_[key] = {texture, bytes, 1};
+  textureKeys_[texture] = key;
+  ++stats_.textures;
+  stats_.textureBytes += bytes;
+}
+
+void ResourceCache::releaseTexture(GLuint texture) {
+  auto key = textureKeys_.find(texture);
+  if (key == textureKeys_.end()) {
+    return;
+  }
+  auto &entry = textures_[key->second];
+  if (--entry.references > 0) {
+    stats_.savedTextureBytes -= entry.bytes;
+    return;
+  }
+  GL_CHECK(glDeleteTextures(1, &entry.texture));
+  --stats_.textures;
+  stats_.textureBytes -= entry.bytes;
+  textures_.erase(key->second);
+  textureKeys_.erase(key);
+}
+
+// The 1x1 white texture of materials without a base color texture, made once
+// and kept until the cache goes away.
+GLuint ResourceCache::getDefaultTexture() {
+  if (defaultTexture_ != 0) {
+    return defaultTexture_;
+  }
+  float defaultBaseColorTextureColor[] = {1, 1, 1};
+  GL_CHECK(glGenTextures(1, &defaultTexture_));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, defaultTexture_));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_FLOAT,
+                        defaultBaseColorTextureColor));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  return defaultTexture_;
+}
+
+// Returns false when no geometry with this content is resident. A hit counts
+// a reference that releaseGeometry gives back.
+bool ResourceCache::acquireGeometry(uint64_t key, uint32_t &vertexAllocation,
+                                    uint32_t &indexAllocation) {
+  auto iterator = geometries_.find(key);
+  if (iterator == geometries_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+  ++stats_.hits;
+  ++iterator->second.references;
+  stats_.savedGeometryBytes += iterator->second.bytes;
+  vertexAllocation = iterator->second.vertexAllocation;
+  indexAllocation = iterator->second.indexAllocation;
+  return true;
+}
+
+// Takes over the arena allocations, uploaded in full, with one reference.
+// When a load of the same content finished first the allocations are freed
+// and replaced by the resident ones instead.
+void ResourceCache::addGeometry(uint64_t key, uint32_t &vertexAllocation,
+                                uint32_t &indexAllocation, size_t bytes) {
+  auto iterator = geometries_.find(key);
+  if (iterator == geometries_.end()) {
+    geometries_[key] = {vertexAllocation, indexAllocation, bytes, 1};
+    ++stats_.geometries;
+    stats_.geometryBytes += bytes;
+    return;
+  }
+  if (vertexAllocation != GeometryArena::NO_ALLOCATION) {
+    vertexArena_->free(vertexAllocation);
+  }
+  if (indexAllocation != GeometryArena::NO_ALLOCATION) {
+    indexArena_->free(indexAllocation);
+  }
+  ++iterator->second.references;
+  stats_.savedGeometryBytes += iterator->second.bytes;
+  vertexAllocation = iterator->second.vertexAllocation;
+  indexAllocation = iterator->second.indexAllocation;
+}
+
+void ResourceCache::releaseGeometry(uint64_t key) {
+  auto iterator = geometries_.find(key);
+  if (iterator == geometries_.end()) {
+    return;
+  }
+  auto &entry = iterator->second;
+  if (--entry.references > 0) {
+    stats_.savedGeometryBytes -= entry.bytes;
+    return;
+  }
+  if (entry.vertexAllocation != GeometryArena::NO_ALLOCATION) {
+    vertexArena_->free(entry.vertexAllocation);
+  }
+  if (entry.indexAllocation != GeometryArena::NO_ALLOCATION) {
+    indexArena_->free(entry.indexAllocation);
+  }
+  --stats_.geometries;
+  stats_.geometryBytes -= entry.bytes;
+  geometries_.erase(iterator);
+}
+
+// Returns true, and moves to a new geometry version, when anything moved.
+bool ResourceCache::compactGeometry() {
+  auto verticesMoved = vertexArena_->compact();
+  auto indicesMoved = indexArena_->compact();
+  if (!verticesMoved && !indicesMoved) {
+    return false;
+  }
+  ++geometryVersion_;
+  return true;
+}
+
+unsigned int ResourceCache::getGeometryVersion() { return geometryVersion_; }
+
+const std::shared_ptr<GeometryArena> &ResourceCache::getVertexArena() {
+  return vertexArena_;
+}
+
+const std::shared_ptr<GeometryArena> &ResourceCache::getIndexArena() {
+  return indexArena_;
+}
+
+// Programs and textures are already unique per content, so equal program,
+// texture and sampler location make equal materials, which lets the render
+// queue batch them.
+std::shared_ptr<Material>
+ResourceCache::getMaterial(GLuint program, GLuint baseColorTexture,
+                           int baseColorTextureLocation) {
+  auto &entry = materials_[std::make_tuple(program, baseColorTexture,
+                                           baseColorTextureLocation)];
+  auto material = entry.lock();
+  if (material != nullptr) {
+    ++stats_.hits;
+    return material;
+  }
+  ++stats_.misses;
+  material = std::make_shared<Material>(program, baseColorTexture,
+                                        baseColorTextureLocation);
+  entry = material;
+  return material;
+}
+
+static uint64_t hashProgram(const std::string &vertexShaderCode,
+                            const std::string &fragmentShaderCode) {
+  auto key = hashBytes(vertexShaderCode.data(), vertexShaderCode.size());
+  return hashBytes(fragmentShaderCode.data(), fragmentShaderCode.size(), key);
+}
+
+std::shared_ptr<Program>
+ResourceCache::getProgram(const std::string &vertexShaderCode,
+                          const std::string &fragmentShaderCode,
+                          ProgramBinaryCache *binaryCache) {
+  auto &entry = programs_[hashProgram(vertexShaderCode, fragmentShaderCode)];
+  auto program = entry.lock();
+  if (program != nullptr) {
+    ++stats_.hits;
+    return program;
+  }
+  ++stats_.misses;
+  program = std::make_shared<Program>(vertexShaderCode, fragmentShaderCode,
+                                      binaryCache);
+  entry = program;
+  return program;
+}
+
+// For programs built elsewhere, on a shared context, that later getProgram
+// calls with the same sources should find.
+void ResourceCache::addProgram(const std::string &vertexShaderCode,
+                               const std::string &fragmentShaderCode,
+                               const std::shared_ptr<Program> &program) {
+  auto &entry = programs_[hashProgram(vertexShaderCode, fragmentShaderCode)];
+  if (entry.expired()) {
+    entry = program;
+  }
+}
+
+// Expired materials and programs are dropped here rather than when their last
+// holder lets go.
+const ResourceCacheStats &ResourceCache::getStats() {
+  for (auto iterator = materials_.begin(); iterator != materials_.end();) {
+    iterator = iterator->second.expired() ? materials_.erase(iterator)
+                                          : std::next(iterator);
+  }
+  for (auto iterator = programs_.begin(); iterator != programs_.end();) {
+    iterator = iterator->second.expired() ? programs_.erase(iterator)
+                                          : std::next(iterator);
+  }
+  stats_.materials = materials_.size();
+  stats_.programs = programs_.size();
+  return stats_;
+}
+
+} // namespace triangle
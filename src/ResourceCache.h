@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "GeometryArena.h"
+#include "Material.h"
+#include "Program.h"
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+namespace triangle {
+
+// Resident entries and their bytes. Saved bytes are what the references past
+// the first of each entry would have uploaded again without the cache.
+struct ResourceCacheStats {
+  unsigned int textures = 0;
+  unsigned int geometries = 0;
+  unsigned int materials = 0;
+  unsigned int programs = 0;
+  size_t textureBytes = 0;
+  size_t geometryBytes = 0;
+  size_t savedTextureBytes = 0;
+  size_t savedGeometryBytes = 0;
+  unsigned int hits = 0;
+  unsigned int misses = 0;
+};
+
+uint64_t hashBytes(const void *data, size_t size,
+                   uint64_t hash = 14695981039346656037ull);
+
+// GL resources keyed by a hash of their content, shared by the assets of one
+// or more engines on the same GL context. Textures and geometry are counted
+// per acquire and deleted with their last release, materials and programs
+// live as long as someone holds them. The vertex and index arenas belong to
+// the cache so that shared geometry is one allocation; engines compare
+// getGeometryVersion() against the version they last bound to notice that
+// another engine compacted them.
+class ResourceCache {
+
+public:
+  ResourceCache();
+  ~ResourceCache();
+  GLuint acquireTexture(uint64_t key);
+  void addTexture(uint64_t key, GLuint texture, size_t bytes);
+  void releaseTexture(GLuint texture);
+  GLuint getDefaultTexture();
+  bool acquireGeometry(uint64_t key, uint32_t &vertexAllocation,
+                       uint32_t &indexAllocation);
+  void addGeometry(uint64_t key, uint32_t &vertexAllocation,
+                   uint32_t &indexAllocation, size_t bytes);
+  void releaseGeometry(uint64_t key);
+  bool compactGeometry();
+  unsigned int getGeometryVersion();
+  const std::shared_ptr<GeometryArena> &getVertexArena();
+  const std::shared_ptr<GeometryArena> &getIndexArena();
+  std::shared_ptr<Material> getMaterial(GLuint program,
+                                        GLuint baseColorTexture,
+                                        int baseColorTextureLocation);
+  std::shared_ptr<Program>
+  getProgram(const std::string &vertexShaderCode,
+             const std::string &fragmentShaderCode,
+             ProgramBinaryCache *binaryCache = nullptr);
+  void addProgram(const std::string &vertexShaderCode,
+                  const std::string &fragmentShaderCode,
+                  const std::shared_ptr<Program> &program);
+  const ResourceCacheStats &getStats();
+
+private:
+  struct TextureEntry {
+    GLuint texture;
+    size_t bytes;
+    unsigned int references;
+  };
+  struct GeometryEntry {
+    uint32_t vertexAllocation;
+    uint32_t indexAllocation;
+    size_t bytes;
+    unsigned int references;
+  };
+  std::unordered_map<uint64_t, TextureEntry> textures_;
+  std::unordered_map<GLuint, uint64_t> textureKeys_;
+  GLuint defaultTexture_ = 0;
+  std::unordered_map<uint64_t, GeometryEntry> geometries_;
+  std::shared_ptr<GeometryArena> vertexArena_;
+  std::shared_ptr<GeometryArena> indexArena_;
+  unsigned int geometryVersion_ = 0;
+  std::map<std::tuple<GLuint, GLuint, int>, std::weak_ptr<Material>>
+      materials_;
+  std::unordered_map<uint64_t, std::weak_ptr<Program>> programs_;
+  ResourceCacheStats stats_;
+};
+
+} // namespace triangle
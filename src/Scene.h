@@ -18,6 +18,7 @@
 
 #include "Camera.h"
 #include "Node.h"
+#include <functional>
 
 namespace triangle {
 
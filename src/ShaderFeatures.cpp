@@ -0,0 +1,40 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ShaderFeatures.h"
+
+namespace triangle {
+
+static const struct {
+  ShaderFeature feature;
+  const char *define;
+} SHADER_FEATURE_DEFINES[] = {
+    {SHADER_FEATURE_VERTEX_COLOR, "HAS_VERTEX_COLOR"},
+    {SHADER_FEATURE_SKINNING, "HAS_SKINNING"},
+};
+
+std::string buildShaderSource(const std::string &source, uint32_t features) {
+  auto versionEnd = source.find('\n') + 1;
+  auto permutation = source.substr(0, versionEnd);
+  for (auto &define : SHADER_FEATURE_DEFINES) {
+    if (features & define.feature) {
+      permutation += std::string("#define ") + define.define + "\n";
+    }
+  }
+  return permutation + source.substr(versionEnd);
+}
+
+} // namespace triangle
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace triangle {
+
+// Optional parts of the shaders in Common.h. A program is built for a
+// bitmask of them, every set bit becomes a #define after the #version line.
+enum ShaderFeature : uint32_t {
+  SHADER_FEATURE_VERTEX_COLOR = 1u << 0,
+  SHADER_FEATURE_SKINNING = 1u << 1,
+};
+
+std::string buildShaderSource(const std::string &source, uint32_t features);
+
+} // namespace triangle
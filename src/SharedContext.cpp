@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SharedContext.h"
+#include <cstring>
+
+namespace triangle {
+
+SharedContext::SharedContext() {
+  auto display = eglGetCurrentDisplay();
+  auto currentContext = eglGetCurrentContext();
+  if (display == EGL_NO_DISPLAY || currentContext == EGL_NO_CONTEXT) {
+    return;
+  }
+  EGLint configId = 0, clientVersion = 0;
+  eglQueryContext(display, currentContext, EGL_CONFIG_ID, &configId);
+  eglQueryContext(display, currentContext, EGL_CONTEXT_CLIENT_VERSION,
+                  &clientVersion);
+  const EGLint configAttributes[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+      configCount == 0) {
+    return;
+  }
+  const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION,
+                                      clientVersion, EGL_NONE};
+  context_ =
+      eglCreateContext(display, config, currentContext, contextAttributes);
+  if (context_ == EGL_NO_CONTEXT) {
+    return;
+  }
+  auto extensions = eglQueryString(display, EGL_EXTENSIONS);
+  if (extensions == nullptr ||
+      std::strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                        EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface_ == EGL_NO_SURFACE) {
+      eglDestroyContext(display, context_);
+      context_ = EGL_NO_CONTEXT;
+      return;
+    }
+  }
+  display_ = display;
+}
+
+SharedContext::~SharedContext() {
+  if (display_ == EGL_NO_DISPLAY) {
+    return;
+  }
+  if (surface_ != EGL_NO_SURFACE) {
+    eglDestroySurface(display_, surface_);
+  }
+  eglDestroyContext(display_, context_);
+}
+
+bool SharedContext::isValid() { return display_ != EGL_NO_DISPLAY; }
+
+// Makes the context current on the calling thread.
+bool SharedContext::bind() {
+  return isValid() &&
+         eglMakeCurrent(display_, surface_, surface_, context_) == EGL_TRUE;
+}
+
+void SharedContext::unbind() {
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+} // namespace triangle
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <EGL/egl.h>
+
+namespace triangle {
+
+// An EGL context in the share group of the one current on the constructing
+// thread, for GL work on another thread. It is made current without a
+// surface where EGL_KHR_surfaceless_context allows, with a 1x1 pbuffer
+// otherwise. Invalid when the constructing thread has no EGL context.
+class SharedContext {
+
+public:
+  SharedContext();
+  ~SharedContext();
+  bool isValid();
+  bool bind();
+  void unbind();
+
+private:
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLContext context_ = EGL_NO_CONTEXT;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+};
+
+} // namespace triangle
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TRIANGLE_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TRIANGLE_SIMD_NEON
+#endif
+
+namespace triangle {
+
+// 4x4 matrix helpers for the per-joint and per-node loops, on SSE or NEON
+// with a scalar fallback. glm's own simd_mat4 is not used because the
+// vendored version does not compile with current compilers. Products are
+// summed in the same order as glm's operator*, so results match it.
+
+// out = a * b, out may alias either operand.
+inline void multiplyMatrices(const glm::mat4 &a, const glm::mat4 &b,
+                             glm::mat4 &out) {
+#if defined(TRIANGLE_SIMD_SSE)
+  const auto a0 = _mm_loadu_ps(&a[0][0]);
+  const auto a1 = _mm_loadu_ps(&a[1][0]);
+  const auto a2 = _mm_loadu_ps(&a[2][0]);
+  const auto a3 = _mm_loadu_ps(&a[3][0]);
+  __m128 columns[4];
+  for (auto i = 0; i < 4; ++i) {
+    const auto column = _mm_loadu_ps(&b[i][0]);
+    auto result = _mm_mul_ps(
+        a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+    result = _mm_add_ps(
+        result, _mm_mul_ps(a1, _mm_shuffle_ps(column, column,
+                                              _MM_SHUFFLE(1, 1, 1, 1))));
+    result = _mm_add_ps(
+        result, _mm_mul_ps(a2, _mm_shuffle_ps(column, column,
+                                              _MM_SHUFFLE(2, 2, 2, 2))));
+    columns[i] = _mm_add_ps(
+        result, _mm_mul_ps(a3, _mm_shuffle_ps(column, column,
+                                              _MM_SHUFFLE(3, 3, 3, 3))));
+  }
+  for (auto i = 0; i < 4; ++i) {
+    _mm_storeu_ps(&out[i][0], columns[i]);
+  }
+#elif defined(TRIANGLE_SIMD_NEON)
+  const auto a0 = vld1q_f32(&a[0][0]);
+  const auto a1 = vld1q_f32(&a[1][0]);
+  const auto a2 = vld1q_f32(&a[2][0]);
+  const auto a3 = vld1q_f32(&a[3][0]);
+  float32x4_t columns[4];
+  for (auto i = 0; i < 4; ++i) {
+    const auto column = vld1q_f32(&b[i][0]);
+    auto result = vmulq_lane_f32(a0, vget_low_f32(column), 0);
+    result = vaddq_f32(result, vmulq_lane_f32(a1, vget_low_f32(column), 1));
+    result = vaddq_f32(result, vmulq_lane_f32(a2, vget_high_f32(column), 0));
+    columns[i] =
+        vaddq_f32(result, vmulq_lane_f32(a3, vget_high_f32(column), 1));
+  }
+  for (auto i = 0; i < 4; ++i) {
+    vst1q_f32(&out[i][0], columns[i]);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+// Writes the first three rows of an affine matrix to rows[0..11].
+inline void storeAffineRows(const glm::mat4 &m, float *rows) {
+#if defined(TRIANGLE_SIMD_SSE)
+  auto c0 = _mm_loadu_ps(&m[0][0]);
+  auto c1 = _mm_loadu_ps(&m[1][0]);
+  auto c2 = _mm_loadu_ps(&m[2][0]);
+  auto c3 = _mm_loadu_ps(&m[3][0]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_storeu_ps(rows, c0);
+  _mm_storeu_ps(rows + 4, c1);
+  _mm_storeu_ps(rows + 8, c2);
+#elif defined(TRIANGLE_SIMD_NEON)
+  const auto transposed = vld4q_f32(&m[0][0]);
+  vst1q_f32(rows, transposed.val[0]);
+  vst1q_f32(rows + 4, transposed.val[1]);
+  vst1q_f32(rows + 8, transposed.val[2]);
+#else
+  for (auto row = 0; row < 3; ++row) {
+    for (auto column = 0; column < 4; ++column) {
+      rows[row * 4 + column] = m[column][row];
+    }
+  }
+#endif
+}
+
+} // namespace triangle
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Skin.h"
+#include "SimdMatrix.h"
+#include <algorithm>
+#include <utility>
+
+namespace triangle {
+
+Skin::Skin(std::vector<unsigned int> joints,
+           std::vector<glm::mat4> inverseBindMatrices,
+           std::vector<float> jointRadii)
+    : joints_(std::move(joints)),
+      inverseBindMatrices_(std::move(inverseBindMatrices)),
+      jointRadii_(std::move(jointRadii)) {}
+
+unsigned int Skin::getJointCount() const { return joints_.size(); }
+
+// Writes the joint matrices relative to the mesh node, world joint times
+// inverse bind matrix seen from the mesh node, as three rows per joint, and
+// refits the world bounds. A vertex moved by a joint stays within that
+// joint's radius, scaled like the joint, of the joint's origin, so the box
+// around those spheres holds every blend of them.
+void Skin::update(TransformStore &transformStore,
+                  const glm::mat4 &meshMatrix, float *rows) {
+  const auto inverseMeshMatrix = glm::inverse(meshMatrix);
+  glm::vec3 min(1e30f), max(-1e30f);
+  const auto bounded = jointRadii_.size() == joints_.size();
+  for (auto i = 0; i < joints_.size(); ++i) {
+    const auto &jointMatrix = transformStore.getWorldMatrix(joints_[i]);
+    glm::mat4 matrix;
+    multiplyMatrices(jointMatrix, inverseBindMatrices_[i], matrix);
+    multiplyMatrices(inverseMeshMatrix, matrix, matrix);
+    storeAffineRows(matrix, rows + i * 12);
+    if (bounded && jointRadii_[i] >= 0.0f) {
+      const auto scale = std::max(
+          {glm::length(glm::vec3(jointMatrix[0])),
+           glm::length(glm::vec3(jointMatrix[1])),
+           glm::length(glm::vec3(jointMatrix[2]))});
+      const auto center = glm::vec3(jointMatrix[3]);
+      const auto radius = glm::vec3(jointRadii_[i] * scale);
+      min = glm::min(min, center - radius);
+      max = glm::max(max, center + radius);
+    }
+  }
+  if (bounded && min.x <= max.x) {
+    boundsMin_ = min;
+    boundsMax_ = max;
+  }
+}
+
+const glm::vec3 &Skin::getBoundsMin() const { return boundsMin_; }
+
+const glm::vec3 &Skin::getBoundsMax() const { return boundsMax_; }
+
+} // namespace triangle
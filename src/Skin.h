@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TransformStore.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace triangle {
+
+// The glTF skin of one skinned mesh node: its joints as transform store
+// indices with their inverse bind matrices, and how far the vertices of the
+// mesh reach from each joint, an empty list when that is unknown.
+class Skin {
+
+public:
+  Skin(std::vector<unsigned int> joints,
+       std::vector<glm::mat4> inverseBindMatrices,
+       std::vector<float> jointRadii);
+  unsigned int getJointCount() const;
+  void update(TransformStore &transformStore, const glm::mat4 &meshMatrix,
+              float *rows);
+  const glm::vec3 &getBoundsMin() const;
+  const glm::vec3 &getBoundsMax() const;
+
+private:
+  std::vector<unsigned int> joints_;
+  std::vector<glm::mat4> inverseBindMatrices_;
+  std::vector<float> jointRadii_;
+  glm::vec3 boundsMin_{-1e30f};
+  glm::vec3 boundsMax_{1e30f};
+};
+
+} // namespace triangle
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace triangle {
+
+// Fixed set of worker threads draining a FIFO of tasks. Tasks still queued
+// when the pool is destroyed are dropped; running ones are joined.
+class ThreadPool {
+
+public:
+  explicit ThreadPool(unsigned int threadCount);
+  ~ThreadPool();
+  std::future<void> submit(std::function<void()> task);
+  unsigned int getThreadCount() const;
+
+private:
+  void run();
+  std::vector<std::thread> threads_;
+  std::deque<std::packaged_task<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+};
+
+} // namespace triangle
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TransformStore.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iterator>
+
+namespace triangle {
+
+static const unsigned int SEGMENT_GRAIN_SIZE = 32;
+
+// Takes the first free entry after the parent, which keeps the topological
+// order, else appends one.
+unsigned int TransformStore::add(int parent, const glm::mat4 &localMatrix) {
+  assert(parent < int(parents_.size()));
+  auto freeEntry = parent < 0 ? freeEntries_.begin()
+                              : freeEntries_.upper_bound(parent);
+  unsigned int index;
+  if (freeEntry != freeEntries_.end()) {
+    index = *freeEntry;
+    freeEntries_.erase(freeEntry);
+    localMatrices_[index] = localMatrix;
+    parents_[index] = parent;
+    worldMatrices_[index] = localMatrix;
+    dirty_[index] = 1;
+    segmentsStale_ = true;
+  } else {
+    index = parents_.size();
+    localMatrices_.push_back(localMatrix);
+    parents_.push_back(parent);
+    worldMatrices_.push_back(localMatrix);
+    dirty_.push_back(1);
+    if (!segmentsStale_ && parent < 0) {
+      segments_.push_back(index);
+    } else if (!segmentsStale_) {
+      while (segments_.back() > (unsigned int)parent) {
+        segments_.pop_back();
+      }
+    }
+  }
+  firstDirty_ = hasDirty_ ? std::min(firstDirty_, index) : index;
+  hasDirty_ = true;
+  return index;
+}
+
+// The entry's children have to be removed as well.
+void TransformStore::remove(unsigned int index) {
+  parents_[index] = -1;
+  dirty_[index] = 0;
+  freeEntries_.insert(index);
+  while (!freeEntries_.empty() &&
+         *freeEntries_.rbegin() == parents_.size() - 1) {
+    freeEntries_.erase(std::prev(freeEntries_.end()));
+    localMatrices_.pop_back();
+    parents_.pop_back();
+    worldMatrices_.pop_back();
+    dirty_.pop_back();
+  }
+  segmentsStale_ = true;
+}
+
+void TransformStore::setLocalMatrix(unsigned int index,
+                                    const glm::mat4 &localMatrix) {
+  localMatrices_[index] = localMatrix;
+  dirty_[index] = 1;
+  firstDirty_ = hasDirty_ ? std::min(firstDirty_, index) : index;
+  hasDirty_ = true;
+}
+
+const glm::mat4 &TransformStore::getLocalMatrix(unsigned int index) {
+  return localMatrices_[index];
+}
+
+// As of the last update(), which is left to the owner so that reads from
+// several threads never race with it.
+const glm::mat4 &TransformStore::getWorldMatrix(unsigned int index) const {
+  return worldMatrices_[index];
+}
+
+int TransformStore::getParent(unsigned int index) { return parents_[index]; }
+
+unsigned int TransformStore::size() { return parents_.size(); }
+
+// Segments from the one holding the first dirty entry on are spread over the
+// job system when one is given.
+bool TransformStore::update(JobSystem *jobSystem) {
+  if (!hasDirty_) {
+    return false;
+  }
+  if (segmentsStale_) {
+    buildSegments();
+  }
+  hasDirty_ = false;
+  ++version_;
+  if (firstDirty_ >= parents_.size()) {
+    return true;
+  }
+  const auto firstSegment =
+      std::upper_bound(segments_.begin(), segments_.end(), firstDirty_) -
+      segments_.begin() - 1;
+  const auto segmentCount = segments_.size() - firstSegment;
+  if (jobSystem != nullptr && segmentCount > SEGMENT_GRAIN_SIZE) {
+    jobSystem->parallelFor(
+        segmentCount, SEGMENT_GRAIN_SIZE,
+        [&](unsigned int begin, unsigned int end) {
+          const auto last = firstSegment + end;
+          updateRange(std::max(segments_[firstSegment + begin], firstDirty_),
+                      last < segments_.size() ? segments_[last]
+                                              : parents_.size());
+        });
+  } else {
+    updateRange(firstDirty_, parents_.size());
+  }
+  std::fill(dirty_.begin() + firstDirty_, dirty_.end(), 0);
+  return true;
+}
+
+unsigned int TransformStore::getVersion() { return version_; }
+
+// A segment starts at every entry that no later entry has a parent before.
+void TransformStore::buildSegments() {
+  segments_.clear();
+  auto firstParent = INT_MAX;
+  for (auto i = int(parents_.size()) - 1; i >= 0; --i) {
+    if (parents_[i] >= 0) {
+      firstParent = std::min(firstParent, parents_[i]);
+    }
+    if (firstParent >= i) {
+      segments_.push_back(i);
+    }
+  }
+  std::reverse(segments_.begin(), segments_.end());
+  segmentsStale_ = false;
+}
+
+void TransformStore::updateRange(unsigned int begin, unsigned int end) {
+  for (auto i = begin; i < end; ++i) {
+    auto parent = parents_[i];
+    if (parent >= 0 && dirty_[parent]) {
+      dirty_[i] = 1;
+    }
+    if (dirty_[i]) {
+      worldMatrices_[i] = parent >= 0
+                              ? worldMatrices_[parent] * localMatrices_[i]
+                              : localMatrices_[i];
+    }
+  }
+}
+
+} // namespace triangle
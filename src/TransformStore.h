@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "JobSystem.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <set>
+#include <vector>
+
+namespace triangle {
+
+// Structure-of-arrays transform hierarchy. Entries are stored in topological
+// order (a parent always precedes its children), so world matrices of all
+// dirty subtrees are refreshed by a single linear pass. Entries are also
+// split into segments, runs that start at a root and hold no child of an
+// earlier run, which that pass can cover in parallel. Removed entries are
+// reused by later adds whose parent precedes them, and dropped when they end
+// the store.
+class TransformStore {
+
+public:
+  unsigned int add(int parent, const glm::mat4 &localMatrix);
+  void remove(unsigned int index);
+  void setLocalMatrix(unsigned int index, const glm::mat4 &localMatrix);
+  const glm::mat4 &getLocalMatrix(unsigned int index);
+  const glm::mat4 &getWorldMatrix(unsigned int index) const;
+  int getParent(unsigned int index);
+  unsigned int size();
+  bool update(JobSystem *jobSystem = nullptr);
+  unsigned int getVersion();
+
+private:
+  void updateRange(unsigned int begin, unsigned int end);
+  void buildSegments();
+  std::vector<glm::mat4> localMatrices_;
+  std::vector<int> parents_;
+  std::vector<glm::mat4> worldMatrices_;
+  std::vector<uint8_t> dirty_;
+  std::vector<unsigned int> segments_;
+  std::set<unsigned int> freeEntries_;
+  bool segmentsStale_ = false;
+  unsigned int firstDirty_ = 0;
+  bool hasDirty_ = false;
+  unsigned int version_ = 0;
+};
+
+} // namespace triangle
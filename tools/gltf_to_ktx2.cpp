@@ -0,0 +1,731 @@
+/*
+ * Copyright 2021 kenney
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts the images of a glTF asset into KTX2 files with a full mip chain,
+// ETC2 compressed by default. The output .gltf references the .ktx2 files
+// and copies of the binary buffers, all written next to it.
+// Usage: gltf_to_ktx2 input.gltf|input.glb output.gltf [--rgba8] [--no-mips]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <json.hpp>
+#include <limits>
+#include <stb_image.h>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+struct Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<unsigned char> rgba;
+};
+
+static const int ETC_MODIFIERS[8][2] = {{2, 8},   {5, 17},  {9, 29},
+                                        {13, 42}, {18, 60}, {24, 80},
+                                        {33, 106}, {47, 183}};
+static const int ETC_DISTANCES[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+static const int EAC_MODIFIERS[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},  {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},  {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},  {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},   {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+static const uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+static const uint32_t VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147;
+static const uint32_t VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK = 151;
+
+static int clamp255(int value) { return std::min(255, std::max(0, value)); }
+
+static bool readFile(const std::string &path,
+                     std::vector<unsigned char> &data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool writeFile(const std::string &path, const unsigned char *data,
+                      size_t size) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(data), size);
+  return bool(file);
+}
+
+static std::string decodeURI(const std::string &uri) {
+  std::string decoded;
+  for (auto i = 0; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size()) {
+      decoded += char(strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+      i += 2;
+    } else {
+      decoded += uri[i];
+    }
+  }
+  return decoded;
+}
+
+static Image downsample(const Image &image) {
+  Image half;
+  half.width = std::max(1u, image.width / 2);
+  half.height = std::max(1u, image.height / 2);
+  half.rgba.resize(half.width * half.height * 4);
+  for (auto y = 0u; y < half.height; ++y) {
+    for (auto x = 0u; x < half.width; ++x) {
+      auto x0 = std::min(x * 2, image.width - 1);
+      auto x1 = std::min(x * 2 + 1, image.width - 1);
+      auto y0 = std::min(y * 2, image.height - 1);
+      auto y1 = std::min(y * 2 + 1, image.height - 1);
+      for (auto c = 0; c < 4; ++c) {
+        auto sum = image.rgba[(y0 * image.width + x0) * 4 + c] +
+                   image.rgba[(y0 * image.width + x1) * 4 + c] +
+                   image.rgba[(y1 * image.width + x0) * 4 + c] +
+                   image.rgba[(y1 * image.width + x1) * 4 + c];
+        half.rgba[(y * half.width + x) * 4 + c] = (sum + 2) / 4;
+      }
+    }
+  }
+  return half;
+}
+
+static void writeBigEndian(uint64_t bits, unsigned char *out) {
+  for (auto i = 0; i < 8; ++i) {
+    out[i] = (bits >> (56 - i * 8)) & 0xFF;
+  }
+}
+
+// Picks the best modifier table and per-pixel indices for one ETC1 sub-block
+// around the given base colour, returns the squared error.
+static int fitSubBlock(const int (*pixels)[4], const int *pixelIndices,
+                       int count, const int *base, int &bestTable,
+                       int *selectors) {
+  auto bestError = std::numeric_limits<int>::max();
+  int tableSelectors[8];
+  for (auto table = 0; table < 8; ++table) {
+    auto error = 0;
+    for (auto i = 0; i < count; ++i) {
+      const auto *pixel = pixels[pixelIndices[i]];
+      auto bestPixelError = std::numeric_limits<int>::max();
+      for (auto selector = 0; selector < 4; ++selector) {
+        auto modifier = ETC_MODIFIERS[table][selector & 1];
+        if (selector & 2) {
+          modifier = -modifier;
+        }
+        auto pixelError = 0;
+        for (auto c = 0; c < 3; ++c) {
+          auto difference = clamp255(base[c] + modifier) - pixel[c];
+          pixelError += difference * difference;
+        }
+        if (pixelError < bestPixelError) {
+          bestPixelError = pixelError;
+          tableSelectors[i] = selector;
+        }
+      }
+      error += bestPixelError;
+    }
+    if (error < bestError) {
+      bestError = error;
+      bestTable = table;
+      std::copy(tableSelectors, tableSelectors + count, selectors);
+    }
+  }
+  return bestError;
+}
+
+// Assigns each pixel the closest of four paint colours, returns the squared
+// error and the 2 bit indices in ETC layout.
+static int fitPaintColors(const int (*pixels)[4], const int (*paint)[3],
+                          uint64_t &indices) {
+  auto error = 0;
+  indices = 0;
+  for (auto i = 0; i < 16; ++i) {
+    auto bestPixelError = std::numeric_limits<int>::max();
+    auto bestIndex = 0;
+    for (auto index = 0; index < 4; ++index) {
+      auto pixelError = 0;
+      for (auto c = 0; c < 3; ++c) {
+        auto difference = clamp255(paint[index][c]) - pixels[i][c];
+        pixelError += difference * difference;
+      }
+      if (pixelError < bestPixelError) {
+        bestPixelError = pixelError;
+        bestIndex = index;
+      }
+    }
+    error += bestPixelError;
+    auto position = (i % 4) * 4 + i / 4;
+    indices |= uint64_t(bestIndex >> 1) << (16 + position);
+    indices |= uint64_t(bestIndex & 1) << position;
+  }
+  return error;
+}
+
+// Splits the block into two colour clusters and tries the ETC2 T and H modes
+// on them, which suit blocks with two distinct hues. The unused bits are set
+// so that the red (T) or green (H) differential overflows.
+static int encodeTwoColorBlock(const int (*pixels)[4], uint64_t &bestBits) {
+  float centers[2][3];
+  auto darkest = 0, brightest = 0;
+  for (auto i = 1; i < 16; ++i) {
+    auto luma = pixels[i][0] + pixels[i][1] + pixels[i][2];
+    if (luma < pixels[darkest][0] + pixels[darkest][1] + pixels[darkest][2]) {
+      darkest = i;
+    }
+    if (luma >
+        pixels[brightest][0] + pixels[brightest][1] + pixels[brightest][2]) {
+      brightest = i;
+    }
+  }
+  for (auto c = 0; c < 3; ++c) {
+    centers[0][c] = pixels[darkest][c];
+    centers[1][c] = pixels[brightest][c];
+  }
+  for (auto iteration = 0; iteration < 4; ++iteration) {
+    float sums[2][3] = {};
+    int counts[2] = {0, 0};
+    for (auto i = 0; i < 16; ++i) {
+      float distances[2] = {0.0f, 0.0f};
+      for (auto k = 0; k < 2; ++k) {
+        for (auto c = 0; c < 3; ++c) {
+          auto difference = pixels[i][c] - centers[k][c];
+          distances[k] += difference * difference;
+        }
+      }
+      auto k = distances[1] < distances[0];
+      for (auto c = 0; c < 3; ++c) {
+        sums[k][c] += pixels[i][c];
+      }
+      ++counts[k];
+    }
+    for (auto k = 0; k < 2; ++k) {
+      for (auto c = 0; c < 3 && counts[k] > 0; ++c) {
+        centers[k][c] = sums[k][c] / counts[k];
+      }
+    }
+  }
+  int colors[2][3];
+  for (auto k = 0; k < 2; ++k) {
+    for (auto c = 0; c < 3; ++c) {
+      colors[k][c] = clamp255(int(std::lround(centers[k][c] / 17.0f)));
+      colors[k][c] = std::min(15, colors[k][c]);
+    }
+  }
+  auto bestError = std::numeric_limits<int>::max();
+  int paint[4][3];
+  uint64_t indices;
+  for (auto first = 0; first < 2; ++first) {
+    const auto *c1 = colors[first], *c2 = colors[1 - first];
+    for (auto distanceIndex = 0; distanceIndex < 8; ++distanceIndex) {
+      auto distance = ETC_DISTANCES[distanceIndex];
+      for (auto c = 0; c < 3; ++c) {
+        paint[0][c] = c1[c] * 17;
+        paint[1][c] = c2[c] * 17 + distance;
+        paint[2][c] = c2[c] * 17;
+        paint[3][c] = c2[c] * 17 - distance;
+      }
+      auto error = fitPaintColors(pixels, paint, indices);
+      if (error >= bestError) {
+        continue;
+      }
+      bestError = error;
+      int r1a = c1[0] >> 2, r1b = c1[0] & 3;
+      uint64_t bits = r1a + r1b >= 4 ? uint64_t(7) << 61 : uint64_t(1) << 58;
+      bits |= uint64_t(r1a) << 59 | uint64_t(r1b) << 56;
+      bits |= uint64_t(c1[1]) << 52 | uint64_t(c1[2]) << 48;
+      bits |= uint64_t(c2[0]) << 44 | uint64_t(c2[1]) << 40;
+      bits |= uint64_t(c2[2]) << 36 | uint64_t(distanceIndex >> 1) << 34;
+      bits |= uint64_t(1) << 33 | uint64_t(distanceIndex & 1) << 32;
+      bestBits = bits | indices;
+    }
+    auto order = (c1[0] << 8 | c1[1] << 4 | c1[2]) >=
+                 (c2[0] << 8 | c2[1] << 4 | c2[2]);
+    for (auto distanceIndex = int(order); distanceIndex < 8;
+         distanceIndex += 2) {
+      auto distance = ETC_DISTANCES[distanceIndex];
+      for (auto c = 0; c < 3; ++c) {
+        paint[0][c] = c1[c] * 17 + distance;
+        paint[1][c] = c1[c] * 17 - distance;
+        paint[2][c] = c2[c] * 17 + distance;
+        paint[3][c] = c2[c] * 17 - distance;
+      }
+      auto error = fitPaintColors(pixels, paint, indices);
+      if (error >= bestError) {
+        continue;
+      }
+      bestError = error;
+      int g1a = c1[1] >> 1, g1b = c1[1] & 1;
+      int b1a = c1[2] >> 3, b1b = c1[2] & 7;
+      uint64_t bits = g1a >= 4 ? uint64_t(1) << 63 : 0;
+      bits |= (g1b << 1 | b1a) + (b1b >> 1) >= 4 ? uint64_t(7) << 53
+                                                 : uint64_t(1) << 50;
+      bits |= uint64_t(c1[0]) << 59 | uint64_t(g1a) << 56;
+      bits |= uint64_t(g1b) << 52 | uint64_t(b1a) << 51 | uint64_t(b1b) << 47;
+      bits |= uint64_t(c2[0]) << 43 | uint64_t(c2[1]) << 39;
+      bits |= uint64_t(c2[2]) << 35 | uint64_t(distanceIndex >> 2) << 34;
+      bits |= uint64_t(1) << 33 | uint64_t((distanceIndex >> 1) & 1) << 32;
+      bestBits = bits | indices;
+    }
+  }
+  return bestError;
+}
+
+// Encodes the colour of a 4x4 block, trying ETC1 individual and differential
+// mode with both flips, then the T and H modes.
+static uint64_t encodeColorBlock(const int (*pixels)[4]) {
+  auto bestError = std::numeric_limits<int>::max();
+  uint64_t bestBits = 0;
+  for (auto flip = 0; flip < 2; ++flip) {
+    int subBlockPixels[2][8];
+    int counts[2] = {0, 0};
+    for (auto y = 0; y < 4; ++y) {
+      for (auto x = 0; x < 4; ++x) {
+        auto subBlock = flip ? y >= 2 : x >= 2;
+        subBlockPixels[subBlock][counts[subBlock]++] = y * 4 + x;
+      }
+    }
+    float averages[2][3] = {};
+    for (auto s = 0; s < 2; ++s) {
+      for (auto i = 0; i < 8; ++i) {
+        for (auto c = 0; c < 3; ++c) {
+          averages[s][c] += pixels[subBlockPixels[s][i]][c] / 8.0f;
+        }
+      }
+    }
+    for (auto differential = 0; differential < 2; ++differential) {
+      int quantized[2][3], bases[2][3];
+      auto valid = true;
+      for (auto s = 0; s < 2; ++s) {
+        for (auto c = 0; c < 3; ++c) {
+          if (differential) {
+            quantized[s][c] = clamp255(int(std::lround(averages[s][c]))) >> 3;
+            bases[s][c] = quantized[s][c] << 3 | quantized[s][c] >> 2;
+          } else {
+            quantized[s][c] = int(std::lround(averages[s][c] / 17.0f));
+            bases[s][c] = quantized[s][c] * 17;
+          }
+        }
+      }
+      int deltas[3];
+      for (auto c = 0; c < 3 && differential; ++c) {
+        deltas[c] = quantized[1][c] - quantized[0][c];
+        valid = valid && deltas[c] >= -4 && deltas[c] <= 3;
+      }
+      if (!valid) {
+        continue;
+      }
+      int tables[2], selectors[2][8];
+      auto error = 0;
+      for (auto s = 0; s < 2; ++s) {
+        error += fitSubBlock(pixels, subBlockPixels[s], 8, bases[s],
+                             tables[s], selectors[s]);
+      }
+      if (error >= bestError) {
+        continue;
+      }
+      bestError = error;
+      uint64_t bits = 0;
+      for (auto c = 0; c < 3; ++c) {
+        auto shift = 56 - c * 8;
+        if (differential) {
+          bits |= uint64_t(quantized[0][c]) << (shift + 3);
+          bits |= uint64_t(deltas[c] & 7) << shift;
+        } else {
+          bits |= uint64_t(quantized[0][c]) << (shift + 4);
+          bits |= uint64_t(quantized[1][c]) << shift;
+        }
+      }
+      bits |= uint64_t(tables[0]) << 37 | uint64_t(tables[1]) << 34;
+      bits |= uint64_t(differential) << 33 | uint64_t(flip) << 32;
+      for (auto s = 0; s < 2; ++s) {
+        for (auto i = 0; i < 8; ++i) {
+          auto pixel = subBlockPixels[s][i];
+          auto index = (pixel % 4) * 4 + pixel / 4;
+          bits |= uint64_t(selectors[s][i] >> 1) << (16 + index);
+          bits |= uint64_t(selectors[s][i] & 1) << index;
+        }
+      }
+      bestBits = bits;
+    }
+  }
+  uint64_t twoColorBits;
+  if (encodeTwoColorBlock(pixels, twoColorBits) < bestError) {
+    bestBits = twoColorBits;
+  }
+  return bestBits;
+}
+
+// Searches EAC tables and multipliers around the alpha range of the block.
+static uint64_t encodeAlphaBlock(const int (*pixels)[4]) {
+  auto minAlpha = 255, maxAlpha = 0;
+  for (auto i = 0; i < 16; ++i) {
+    minAlpha = std::min(minAlpha, pixels[i][3]);
+    maxAlpha = std::max(maxAlpha, pixels[i][3]);
+  }
+  auto bestError = std::numeric_limits<int>::max();
+  uint64_t bestBits = 0;
+  for (auto table = 0; table < 16; ++table) {
+    const auto *modifiers = EAC_MODIFIERS[table];
+    auto span = modifiers[7] - modifiers[3];
+    auto estimate = std::max(1, (maxAlpha - minAlpha + span / 2) / span);
+    for (auto multiplier = std::max(1, estimate - 1);
+         multiplier <= std::min(15, estimate + 1); ++multiplier) {
+      auto center = minAlpha - modifiers[3] * multiplier;
+      for (auto base = std::max(0, center - 2);
+           base <= std::min(255, center + 2); ++base) {
+        auto error = 0;
+        uint64_t indices = 0;
+        for (auto i = 0; i < 16; ++i) {
+          auto alpha = pixels[(i % 4) * 4 + i / 4][3];
+          auto bestPixelError = std::numeric_limits<int>::max();
+          auto bestIndex = 0;
+          for (auto index = 0; index < 8; ++index) {
+            auto difference =
+                clamp255(base + modifiers[index] * multiplier) - alpha;
+            if (difference * difference < bestPixelError) {
+              bestPixelError = difference * difference;
+              bestIndex = index;
+            }
+          }
+          error += bestPixelError;
+          indices |= uint64_t(bestIndex) << (45 - i * 3);
+        }
+        if (error < bestError) {
+          bestError = error;
+          bestBits = uint64_t(base) << 56 | uint64_t(multiplier) << 52 |
+                     uint64_t(table) << 48 | indices;
+        }
+      }
+    }
+  }
+  return bestBits;
+}
+
+static std::vector<unsigned char> encodeETC2(const Image &image, bool alpha) {
+  auto blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+  auto blockSize = alpha ? 16 : 8;
+  std::vector<unsigned char> data(blocksX * blocksY * blockSize);
+  int pixels[16][4];
+  for (auto blockY = 0u; blockY < blocksY; ++blockY) {
+    for (auto blockX = 0u; blockX < blocksX; ++blockX) {
+      for (auto y = 0; y < 4; ++y) {
+        for (auto x = 0; x < 4; ++x) {
+          auto sourceX = std::min(blockX * 4 + x, image.width - 1);
+          auto sourceY = std::min(blockY * 4 + y, image.height - 1);
+          for (auto c = 0; c < 4; ++c) {
+            pixels[y * 4 + x][c] =
+                image.rgba[(sourceY * image.width + sourceX) * 4 + c];
+          }
+        }
+      }
+      auto *block = data.data() + (blockY * blocksX + blockX) * blockSize;
+      if (alpha) {
+        writeBigEndian(encodeAlphaBlock(pixels), block);
+        block += 8;
+      }
+      writeBigEndian(encodeColorBlock(pixels), block);
+    }
+  }
+  return data;
+}
+
+static void appendUint8(std::vector<unsigned char> &out, uint8_t value) {
+  out.push_back(value);
+}
+
+static void appendUint16(std::vector<unsigned char> &out, uint16_t value) {
+  out.insert(out.end(), reinterpret_cast<unsigned char *>(&value),
+             reinterpret_cast<unsigned char *>(&value) + 2);
+}
+
+static void appendUint32(std::vector<unsigned char> &out, uint32_t value) {
+  out.insert(out.end(), reinterpret_cast<unsigned char *>(&value),
+             reinterpret_cast<unsigned char *>(&value) + 4);
+}
+
+static void appendUint64(std::vector<unsigned char> &out, uint64_t value) {
+  out.insert(out.end(), reinterpret_cast<unsigned char *>(&value),
+             reinterpret_cast<unsigned char *>(&value) + 8);
+}
+
+// Basic data format descriptor for the three formats written here.
+static std::vector<unsigned char> buildDataFormatDescriptor(uint32_t format) {
+  struct Sample {
+    uint16_t bitOffset;
+    uint8_t bitLength;
+    uint8_t channelType;
+    uint32_t upper;
+  };
+  std::vector<Sample> samples;
+  uint8_t colorModel, blockDimension, bytesPlane;
+  if (format == VK_FORMAT_R8G8B8A8_UNORM) {
+    colorModel = 1;
+    blockDimension = 0;
+    bytesPlane = 4;
+    samples = {{0, 7, 0, 255}, {8, 7, 1, 255}, {16, 7, 2, 255},
+               {24, 7, 15, 255}};
+  } else if (format == VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK) {
+    colorModel = 161;
+    blockDimension = 3;
+    bytesPlane = 8;
+    samples = {{0, 63, 2, 0xFFFFFFFF}};
+  } else {
+    colorModel = 161;
+    blockDimension = 3;
+    bytesPlane = 16;
+    samples = {{0, 63, 15, 0xFFFFFFFF}, {64, 63, 2, 0xFFFFFFFF}};
+  }
+  std::vector<unsigned char> descriptor;
+  auto blockSize = 24 + 16 * samples.size();
+  appendUint32(descriptor, 4 + blockSize);
+  appendUint32(descriptor, 0);
+  appendUint16(descriptor, 2);
+  appendUint16(descriptor, blockSize);
+  appendUint8(descriptor, colorModel);
+  appendUint8(descriptor, 1);
+  appendUint8(descriptor, 1);
+  appendUint8(descriptor, 0);
+  appendUint8(descriptor, blockDimension);
+  appendUint8(descriptor, blockDimension);
+  appendUint8(descriptor, 0);
+  appendUint8(descriptor, 0);
+  appendUint8(descriptor, bytesPlane);
+  for (auto i = 0; i < 7; ++i) {
+    appendUint8(descriptor, 0);
+  }
+  for (auto &sample : samples) {
+    appendUint16(descriptor, sample.bitOffset);
+    appendUint8(descriptor, sample.bitLength);
+    appendUint8(descriptor, sample.channelType);
+    appendUint32(descriptor, 0);
+    appendUint32(descriptor, 0);
+    appendUint32(descriptor, sample.upper);
+  }
+  return descriptor;
+}
+
+// Levels are stored smallest first, each aligned to the block size.
+static std::vector<unsigned char>
+buildKTX2(uint32_t format, const std::vector<Image> &mips,
+          const std::vector<std::vector<unsigned char>> &levels,
+          size_t alignment) {
+  static const unsigned char identifier[12] = {0xAB, 0x4B, 0x54, 0x58,
+                                               0x20, 0x32, 0x30, 0xBB,
+                                               0x0D, 0x0A, 0x1A, 0x0A};
+  auto descriptor = buildDataFormatDescriptor(format);
+  auto levelIndexSize = 24 * levels.size();
+  auto descriptorOffset = 80 + levelIndexSize;
+  std::vector<uint64_t> offsets(levels.size());
+  auto offset = descriptorOffset + descriptor.size();
+  for (auto i = int(levels.size()) - 1; i >= 0; --i) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    offsets[i] = offset;
+    offset += levels[i].size();
+  }
+  std::vector<unsigned char> out(identifier, identifier + 12);
+  appendUint32(out, format);
+  appendUint32(out, 1);
+  appendUint32(out, mips[0].width);
+  appendUint32(out, mips[0].height);
+  appendUint32(out, 0);
+  appendUint32(out, 0);
+  appendUint32(out, 1);
+  appendUint32(out, levels.size());
+  appendUint32(out, 0);
+  appendUint32(out, descriptorOffset);
+  appendUint32(out, descriptor.size());
+  appendUint32(out, 0);
+  appendUint32(out, 0);
+  appendUint64(out, 0);
+  appendUint64(out, 0);
+  for (auto i = 0; i < levels.size(); ++i) {
+    appendUint64(out, offsets[i]);
+    appendUint64(out, levels[i].size());
+    appendUint64(out, levels[i].size());
+  }
+  out.insert(out.end(), descriptor.begin(), descriptor.end());
+  for (auto i = int(levels.size()) - 1; i >= 0; --i) {
+    out.resize(offsets[i], 0);
+    out.insert(out.end(), levels[i].begin(), levels[i].end());
+  }
+  return out;
+}
+
+static std::vector<unsigned char> convertImage(const Image &image, bool rgba8,
+                                               bool mips) {
+  std::vector<Image> chain = {image};
+  while (mips && (chain.back().width > 1 || chain.back().height > 1)) {
+    chain.push_back(downsample(chain.back()));
+  }
+  auto opaque = true;
+  for (auto i = 3; i < image.rgba.size(); i += 4) {
+    opaque = opaque && image.rgba[i] == 255;
+  }
+  uint32_t format = rgba8    ? VK_FORMAT_R8G8B8A8_UNORM
+                    : opaque ? VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+                             : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+  std::vector<std::vector<unsigned char>> levels;
+  for (auto &level : chain) {
+    levels.push_back(rgba8 ? level.rgba : encodeETC2(level, !opaque));
+  }
+  auto alignment = rgba8 ? 4 : opaque ? 8 : 16;
+  return buildKTX2(format, chain, levels, alignment);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cout << "Usage: gltf_to_ktx2 input.gltf|input.glb output.gltf "
+                 "[--rgba8] [--no-mips]"
+              << std::endl;
+    return 1;
+  }
+  std::string inputPath = argv[1], outputPath = argv[2];
+  auto rgba8 = false, mips = true;
+  for (auto i = 3; i < argc; ++i) {
+    rgba8 = rgba8 || std::strcmp(argv[i], "--rgba8") == 0;
+    mips = mips && std::strcmp(argv[i], "--no-mips") != 0;
+  }
+  std::vector<unsigned char> input;
+  if (!readFile(inputPath, input)) {
+    std::cout << "Failed to read " << inputPath << std::endl;
+    return 1;
+  }
+  std::string jsonText;
+  std::vector<unsigned char> bin;
+  uint32_t magic = 0;
+  if (input.size() >= 20) {
+    memcpy(&magic, input.data(), 4);
+  }
+  if (magic == 0x46546C67) {
+    for (size_t offset = 12; offset + 8 <= input.size();) {
+      uint32_t chunkLength, chunkType;
+      memcpy(&chunkLength, input.data() + offset, 4);
+      memcpy(&chunkType, input.data() + offset + 4, 4);
+      if (offset + 8 + chunkLength > input.size()) {
+        break;
+      }
+      const auto *chunk = input.data() + offset + 8;
+      if (chunkType == 0x4E4F534A) {
+        jsonText.assign(chunk, chunk + chunkLength);
+      } else if (chunkType == 0x004E4942) {
+        bin.assign(chunk, chunk + chunkLength);
+      }
+      offset += 8 + ((chunkLength + 3) & ~3u);
+    }
+  } else {
+    jsonText.assign(input.begin(), input.end());
+  }
+  auto document = nlohmann::json::parse(jsonText, nullptr, false);
+  if (document.is_discarded() || !document.is_object()) {
+    std::cout << "Invalid glTF: " << inputPath << std::endl;
+    return 1;
+  }
+  auto inputSeparator = inputPath.find_last_of("/\\");
+  auto inputDir = inputSeparator == std::string::npos
+                      ? ""
+                      : inputPath.substr(0, inputSeparator + 1);
+  auto outputSeparator = outputPath.find_last_of("/\\");
+  auto outputDir = outputSeparator == std::string::npos
+                       ? ""
+                       : outputPath.substr(0, outputSeparator + 1);
+  auto outputName = outputPath.substr(outputDir.size());
+  outputName = outputName.substr(0, outputName.find_last_of('.'));
+
+  std::vector<std::vector<unsigned char>> buffers;
+  auto &jsonBuffers = document["buffers"];
+  for (auto i = 0; i < jsonBuffers.size(); ++i) {
+    auto &buffer = jsonBuffers[i];
+    auto uri = buffer.value("uri", std::string());
+    std::vector<unsigned char> data;
+    if (uri.empty()) {
+      data = bin;
+    } else if (tinygltf::IsDataURI(uri)) {
+      std::string mimeType;
+      tinygltf::DecodeDataURI(&data, mimeType, uri, 0, false);
+      buffers.push_back(data);
+      continue;
+    } else if (!readFile(inputDir + decodeURI(uri), data)) {
+      std::cout << "Failed to read buffer " << uri << std::endl;
+      return 1;
+    }
+    auto bufferName = outputName + "_buffer" + std::to_string(i) + ".bin";
+    writeFile(outputDir + bufferName, data.data(), data.size());
+    buffer["uri"] = bufferName;
+    buffers.push_back(data);
+  }
+
+  auto &jsonImages = document["images"];
+  for (auto i = 0; i < jsonImages.size(); ++i) {
+    auto &jsonImage = jsonImages[i];
+    std::vector<unsigned char> encoded;
+    auto uri = jsonImage.value("uri", std::string());
+    if (jsonImage.find("bufferView") != jsonImage.end()) {
+      const auto &bufferView = document["bufferViews"][int(
+          jsonImage["bufferView"])];
+      const auto &buffer = buffers[int(bufferView["buffer"])];
+      auto offset = bufferView.value("byteOffset", size_t(0));
+      auto length = bufferView.value("byteLength", size_t(0));
+      encoded.assign(buffer.begin() + offset, buffer.begin() + offset + length);
+    } else if (tinygltf::IsDataURI(uri)) {
+      std::string mimeType;
+      tinygltf::DecodeDataURI(&encoded, mimeType, uri, 0, false);
+    } else {
+      readFile(inputDir + decodeURI(uri), encoded);
+    }
+    int width, height, components;
+    auto *pixels = stbi_load_from_memory(encoded.data(), encoded.size(),
+                                         &width, &height, &components, 4);
+    if (pixels == nullptr) {
+      std::cout << "Skipping image " << i << ", it can not be decoded"
+                << std::endl;
+      continue;
+    }
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgba.assign(pixels, pixels + width * height * 4);
+    stbi_image_free(pixels);
+    auto ktx2 = convertImage(image, rgba8, mips);
+    auto imageName = outputName + "_image" + std::to_string(i) + ".ktx2";
+    writeFile(outputDir + imageName, ktx2.data(), ktx2.size());
+    jsonImage.erase("bufferView");
+    jsonImage["uri"] = imageName;
+    jsonImage["mimeType"] = "image/ktx2";
+    std::cout << "image " << i << ": " << width << "x" << height << " "
+              << image.rgba.size() << " -> " << ktx2.size() << " bytes"
+              << std::endl;
+  }
+
+  auto text = document.dump(2);
+  if (!writeFile(outputPath, reinterpret_cast<const unsigned char *>(
+                                 text.data()),
+                 text.size())) {
+    std::cout << "Failed to write " << outputPath << std::endl;
+    return 1;
+  }
+  return 0;
+}